@@ -28,6 +28,8 @@ public class CustomSessions : ModuleRules
 				"Core",
 				"OnlineSubsystem",
 				"OnlineSubsystemSteam",
+				"Networking",
+				"Sockets",
 				"UMG",
 				"Slate",
 				"SlateCore"
@@ -40,6 +42,8 @@ public class CustomSessions : ModuleRules
 			{
 				"CoreUObject",
 				"Engine",
+				"EngineSettings",
+				"Json",
 				"Slate",
 				"SlateCore",
 				// ... add private dependencies that you statically link with here ...	
@@ -0,0 +1,188 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionAsyncAction.h"
+
+#include "CustomSessionSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+
+namespace
+{
+	UCustomSessionSubsystem* GetSessionSubsystem(const UObject* WorldContextObject)
+	{
+		const UWorld* World = GEngine->GetWorldFromContextObject(WorldContextObject, EGetWorldErrorMode::LogAndReturnNull);
+		const UGameInstance* GameInstance = World != nullptr ? World->GetGameInstance() : nullptr;
+
+		return GameInstance != nullptr ? GameInstance->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+	}
+}
+
+UCustomSessionOperationAsyncAction* UCustomSessionOperationAsyncAction::CreateCustomSession(UObject* WorldContextObject, FName SessionName,
+	int32 NumPublicConnections, const FString& MatchType)
+{
+	UCustomSessionOperationAsyncAction* Action = MakeAction(WorldContextObject, ECustomSessionOperation::Create, SessionName);
+	Action->NumPublicConnections = NumPublicConnections;
+	Action->MatchType = MatchType;
+
+	return Action;
+}
+
+UCustomSessionOperationAsyncAction* UCustomSessionOperationAsyncAction::StartCustomSession(UObject* WorldContextObject, FName SessionName)
+{
+	return MakeAction(WorldContextObject, ECustomSessionOperation::Start, SessionName);
+}
+
+UCustomSessionOperationAsyncAction* UCustomSessionOperationAsyncAction::EndCustomSession(UObject* WorldContextObject, FName SessionName)
+{
+	return MakeAction(WorldContextObject, ECustomSessionOperation::End, SessionName);
+}
+
+UCustomSessionOperationAsyncAction* UCustomSessionOperationAsyncAction::DestroyCustomSession(UObject* WorldContextObject, FName SessionName)
+{
+	return MakeAction(WorldContextObject, ECustomSessionOperation::Destroy, SessionName);
+}
+
+UCustomSessionOperationAsyncAction* UCustomSessionOperationAsyncAction::MakeAction(UObject* WorldContextObject, ECustomSessionOperation Operation, FName SessionName)
+{
+	UCustomSessionOperationAsyncAction* Action = NewObject<UCustomSessionOperationAsyncAction>();
+	Action->Subsystem = GetSessionSubsystem(WorldContextObject);
+	Action->Operation = Operation;
+	Action->SessionName = SessionName;
+	Action->RegisterWithGameInstance(WorldContextObject);
+
+	return Action;
+}
+
+void UCustomSessionOperationAsyncAction::Activate()
+{
+	if (!IsValid(Subsystem))
+	{
+		Completed(false);
+
+		return;
+	}
+
+	TFuture<bool> Future;
+	switch (Operation)
+	{
+		case ECustomSessionOperation::Create:
+		{
+			Future = Subsystem->CreateSessionAsync(SessionName, NumPublicConnections, MatchType);
+		}
+		break;
+
+		case ECustomSessionOperation::Start:
+		{
+			Future = Subsystem->StartSessionAsync(SessionName);
+		}
+		break;
+
+		case ECustomSessionOperation::End:
+		{
+			Future = Subsystem->EndSessionAsync(SessionName);
+		}
+		break;
+
+		case ECustomSessionOperation::Destroy:
+		{
+			Future = Subsystem->DestroySessionAsync(SessionName);
+		}
+		break;
+
+		default:
+		{
+			Completed(false);
+
+			return;
+		}
+	}
+
+	Future.Next([WeakThis = TWeakObjectPtr<ThisClass>(this)](bool bWasSuccessful)
+	{
+		if (ThisClass* This = WeakThis.Get())
+		{
+			This->Completed(bWasSuccessful);
+		}
+	});
+}
+
+void UCustomSessionOperationAsyncAction::Completed(bool bWasSuccessful)
+{
+	if (bWasSuccessful)
+	{
+		OnSuccess.Broadcast();
+	}
+	else
+	{
+		OnFailure.Broadcast();
+	}
+
+	SetReadyToDestroy();
+}
+
+UCustomSessionFindAndJoinAsyncAction* UCustomSessionFindAndJoinAsyncAction::FindAndJoinCustomSession(UObject* WorldContextObject, const FString& MatchType,
+	int32 RequiredConnections, int32 MaxSearchResults)
+{
+	UCustomSessionFindAndJoinAsyncAction* Action = NewObject<UCustomSessionFindAndJoinAsyncAction>();
+	Action->Subsystem = GetSessionSubsystem(WorldContextObject);
+	Action->MatchType = MatchType;
+	Action->RequiredConnections = RequiredConnections;
+	Action->MaxSearchResults = MaxSearchResults;
+	Action->RegisterWithGameInstance(WorldContextObject);
+
+	return Action;
+}
+
+void UCustomSessionFindAndJoinAsyncAction::Activate()
+{
+	if (!IsValid(Subsystem))
+	{
+		Completed(false);
+
+		return;
+	}
+
+	// search, then join the best of exactly those results, without touching any delegate of the subsystem
+	const TWeakObjectPtr<ThisClass> WeakThis(this);
+	Subsystem->FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), MaxSearchResults, NAME_GameSession, MatchType)
+		.Next([WeakThis](const FCustomSessionFindResult& FindResult)
+		{
+			ThisClass* Action = WeakThis.Get();
+			if (Action == nullptr)
+			{
+				return;
+			}
+
+			if (!FindResult.bWasSuccessful || !IsValid(Action->Subsystem))
+			{
+				Action->Completed(false);
+
+				return;
+			}
+
+			Action->Subsystem->JoinBestSessionAsync(FindResult.Snapshot, Action->RequiredConnections, NAME_GameSession)
+				.Next([WeakThis](const FCustomSessionJoinResult& JoinResult)
+				{
+					if (ThisClass* This = WeakThis.Get())
+					{
+						This->Completed(JoinResult.Result == ECustomSessionResult::Success);
+					}
+				});
+		});
+}
+
+void UCustomSessionFindAndJoinAsyncAction::Completed(bool bJoined)
+{
+	FString ConnectString;
+	if (bJoined && IsValid(Subsystem) && Subsystem->ResolveConnectString(ConnectString, NAME_GameSession))
+	{
+		OnJoined.Broadcast(ConnectString);
+	}
+	else
+	{
+		OnFailure.Broadcast(FString());
+	}
+
+	SetReadyToDestroy();
+}
@@ -0,0 +1,387 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionBenchmark.h"
+
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionMockSession.h"
+#include "CustomSessionSubsystem.h"
+#include "Dom/JsonObject.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/App.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+#include "TimerManager.h"
+
+namespace CustomSessionBenchmark
+{
+	double Percentile(const TArray<double>& SortedSamples, double Fraction)
+	{
+		if (SortedSamples.IsEmpty())
+		{
+			return 0.0;
+		}
+
+		const int32 Index = FMath::Clamp(FMath::CeilToInt(Fraction * SortedSamples.Num()) - 1, 0, SortedSamples.Num() - 1);
+
+		return SortedSamples[Index];
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs BenchmarkCommand(
+		TEXT("CustomSessions.Benchmark"),
+		TEXT("Benchmarks the session subsystem against the mock backend, writing CSV and JSON to Saved/Profiling/CustomSessions. ")
+		TEXT("Args: Iterations=20 Cycles=50 LatencyMs=0 Sessions=2000 PerTick=100 Quit=0"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const UGameInstance* GameInstance = IsValid(World) ? World->GetGameInstance() : nullptr;
+			UCustomSessionSubsystem* Subsystem = GameInstance != nullptr ? GameInstance->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+			if (UCustomSessionBenchmark::Run(Subsystem, FCustomSessionBenchmarkOptions::FromCommandArgs(FString::Join(Args, TEXT(" ")))) == nullptr)
+			{
+				UE_LOG(LogCustomSessions, Error, TEXT("Can't benchmark now: no session subsystem, it is busy or a benchmark is already running"));
+			}
+		}));
+}
+
+UCustomSessionBenchmark* UCustomSessionBenchmark::RunningBenchmark = nullptr;
+
+FCustomSessionBenchmarkOptions FCustomSessionBenchmarkOptions::FromCommandArgs(const FString& Args)
+{
+	FCustomSessionBenchmarkOptions Options;
+	FParse::Value(*Args, TEXT("Iterations="), Options.Iterations);
+	FParse::Value(*Args, TEXT("Cycles="), Options.CreateDestroyCycles);
+	FParse::Value(*Args, TEXT("LatencyMs="), Options.MockLatencyMs);
+	FParse::Value(*Args, TEXT("Sessions="), Options.NumSyntheticSessions);
+	FParse::Value(*Args, TEXT("PerTick="), Options.SearchResultsPerTick);
+	FParse::Value(*Args, TEXT("MatchType="), Options.MatchType);
+	FParse::Bool(*Args, TEXT("Quit="), Options.bQuitWhenDone);
+
+	return Options;
+}
+
+UCustomSessionBenchmark* UCustomSessionBenchmark::Run(UCustomSessionSubsystem* Subsystem, const FCustomSessionBenchmarkOptions& Options)
+{
+	if (RunningBenchmark != nullptr || !IsValid(Subsystem) || Subsystem->IsBusy())
+	{
+		return nullptr;
+	}
+
+	UCustomSessionBenchmark* Benchmark = NewObject<UCustomSessionBenchmark>(Subsystem);
+	Benchmark->Subsystem = Subsystem;
+	Benchmark->Options = Options;
+	Benchmark->AddToRoot();
+	RunningBenchmark = Benchmark;
+	Benchmark->Start();
+
+	return Benchmark;
+}
+
+void UCustomSessionBenchmark::Start()
+{
+	FCustomSessionMockSettings MockSettings = FCustomSessionMockSettings::LoadFromConfig();
+	MockSettings.bEnabled = true;
+	MockSettings.MinLatencyMs = Options.MockLatencyMs;
+	MockSettings.LatencyJitterMs = 0.0f;
+	MockSettings.FailureRate = 0.0f;
+	MockSettings.NumSyntheticSessions = Options.NumSyntheticSessions;
+	MockSettings.SearchResultsPerTick = Options.SearchResultsPerTick;
+	MockSettings.SyntheticMatchTypes.AddUnique(Options.MatchType);
+
+	MockSession = Subsystem->UseMockBackend(MockSettings);
+	if (!MockSession.IsValid())
+	{
+		UE_LOG(LogCustomSessions, Error, TEXT("Benchmark could not switch the session subsystem to the mock backend"));
+		Finish();
+
+		return;
+	}
+
+	UE_LOG(LogCustomSessions, Display, TEXT("Benchmarking the session subsystem, it keeps using the mock backend afterwards"));
+	MockSession->OnSearchResultsDelivered.AddUObject(this, &ThisClass::SearchResultsDelivered);
+
+	RunProcessingBenchmarks();
+
+	Phase = EPhase::Search;
+	Iteration = 0;
+	PhaseStartTime = FPlatformTime::Seconds();
+	StartSearchIteration();
+}
+
+void UCustomSessionBenchmark::RunProcessingBenchmarks()
+{
+	FRandomStream RandomStream(MockSession->GetSettings().RandomSeed);
+
+	// what a search is sent with, applied locally as for a backend that filters nothing itself, e.g. LAN
+	const TArray<FCustomSessionSearchFilter> Filters = {
+		FCustomSessionSearchFilter(CustomSessionsApi::MatchTypeKey, Options.MatchType),
+		FCustomSessionSearchFilter(CustomSessionsApi::BuildKey, Subsystem->GetSessionBuildUniqueId())
+	};
+
+	for (const int32 Size : Options.ProcessingSizes)
+	{
+		TArray<FOnlineSessionSearchResult> Results;
+		Results.Reserve(Size);
+		for (int32 Index = 0; Index < Size; ++Index)
+		{
+			Results.Add(FCustomSessionMockSession::MakeSyntheticResult(MockSession->GetSettings(), RandomStream, Index));
+		}
+
+		const FString TimeMetric = FString::Printf(TEXT("ProcessResults%d"), Size);
+		const int32 Passes = FMath::Max(10, 10000 / FMath::Max(1, Size));
+		int32 NumJoinable = 0;
+		for (int32 Pass = 0; Pass < Passes; ++Pass)
+		{
+			// filtering works in place, every pass starts from the full result set
+			TArray<FOnlineSessionSearchResult> SearchResults = Results;
+			const double StartTime = FPlatformTime::Seconds();
+
+			// what a search completion costs before the join starts: local filtering, then ranking for JoinBestSession
+			UCustomSessionSubsystem::FilterSearchResults(SearchResults, Filters);
+			NumJoinable = Subsystem->RankSessions(SearchResults).Num();
+
+			AddSample(TimeMetric, TEXT("us"), (FPlatformTime::Seconds() - StartTime) * 1000000.0);
+		}
+
+		UE_LOG(LogCustomSessions, Verbose, TEXT("Processed %d results %d times, %d joinable"), Size, Passes, NumJoinable);
+	}
+}
+
+void UCustomSessionBenchmark::StartSearchIteration()
+{
+	if (Iteration >= Options.Iterations)
+	{
+		AddSample(TEXT("SearchFailures"), TEXT("count"), Failures);
+		Phase = EPhase::Join;
+		Iteration = 0;
+		Failures = 0;
+		StartJoinIteration();
+
+		return;
+	}
+
+	// every iteration has to reach the backend, not the search cache
+	Subsystem->InvalidateSearchCache();
+	Subsystem->OnCustomSessionFindSessionsCompleted.AddUObject(this, &ThisClass::SearchCompleted);
+
+	FirstResultTime = 0.0;
+	OperationStartUsedMemory = FPlatformMemory::GetStats().UsedPhysical;
+	OperationStartTime = FPlatformTime::Seconds();
+	Subsystem->FindSession(Options.NumSyntheticSessions, NAME_GameSession, Options.MatchType);
+}
+
+void UCustomSessionBenchmark::SearchResultsDelivered(int32 NumResults)
+{
+	if (Phase == EPhase::Search && FirstResultTime == 0.0)
+	{
+		FirstResultTime = FPlatformTime::Seconds();
+	}
+}
+
+void UCustomSessionBenchmark::SearchCompleted(const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful)
+{
+	Subsystem->OnCustomSessionFindSessionsCompleted.RemoveAll(this);
+
+	const double CompletedTime = FPlatformTime::Seconds();
+	const uint64 CompletedUsedMemory = FPlatformMemory::GetStats().UsedPhysical;
+	if (bWasSuccessful)
+	{
+		AddSample(TEXT("TimeToFirstResult"), TEXT("ms"), ((FirstResultTime > 0.0 ? FirstResultTime : CompletedTime) - OperationStartTime) * 1000.0);
+		AddSample(TEXT("TimeToAllResults"), TEXT("ms"), (CompletedTime - OperationStartTime) * 1000.0);
+		AddSample(TEXT("SearchResults"), TEXT("count"), Snapshot->Num());
+		// process wide, so whatever else ran meanwhile is in it too; the snapshot is still alive and counted
+		AddSample(TEXT("SearchAllocations"), TEXT("KiB"), (static_cast<double>(CompletedUsedMemory) - static_cast<double>(OperationStartUsedMemory)) / 1024.0);
+	}
+	else
+	{
+		++Failures;
+	}
+
+	++Iteration;
+	RunNextTick(&ThisClass::StartSearchIteration);
+}
+
+void UCustomSessionBenchmark::StartJoinIteration()
+{
+	if (Iteration >= Options.Iterations)
+	{
+		AddSample(TEXT("JoinFailures"), TEXT("count"), Failures);
+		Phase = EPhase::CreateDestroy;
+		Iteration = 0;
+		Failures = 0;
+		PhaseStartTime = FPlatformTime::Seconds();
+		StartCreateDestroyCycle();
+
+		return;
+	}
+
+	Subsystem->OnCustomsessionJoinSessionCompleted.AddUObject(this, &ThisClass::JoinCompleted);
+	OperationStartTime = FPlatformTime::Seconds();
+	if (!Subsystem->JoinBestSession())
+	{
+		Subsystem->OnCustomsessionJoinSessionCompleted.RemoveAll(this);
+		++Failures;
+		++Iteration;
+		RunNextTick(&ThisClass::StartJoinIteration);
+	}
+}
+
+void UCustomSessionBenchmark::JoinCompleted(EOnJoinSessionCompleteResult::Type JoinResult)
+{
+	Subsystem->OnCustomsessionJoinSessionCompleted.RemoveAll(this);
+	if (JoinResult == EOnJoinSessionCompleteResult::Success)
+	{
+		AddSample(TEXT("TimeToJoin"), TEXT("ms"), ElapsedMs(OperationStartTime));
+	}
+	else
+	{
+		++Failures;
+	}
+
+	// leave the joined session so the next join starts from the same place
+	Subsystem->OnCustomSessionDestroySessionCompleted.AddUniqueDynamic(this, &ThisClass::DestroyCompleted);
+	Subsystem->DestroySession();
+}
+
+void UCustomSessionBenchmark::StartCreateDestroyCycle()
+{
+	if (Iteration >= Options.CreateDestroyCycles)
+	{
+		const double PhaseSeconds = FPlatformTime::Seconds() - PhaseStartTime;
+		AddSample(TEXT("CreateDestroyThroughput"), TEXT("cycles/s"), PhaseSeconds > 0.0 ? Options.CreateDestroyCycles / PhaseSeconds : 0.0);
+		AddSample(TEXT("CreateDestroyFailures"), TEXT("count"), Failures);
+		Finish();
+
+		return;
+	}
+
+	Subsystem->OnCustomSessionCreateSessionCompleted.AddUniqueDynamic(this, &ThisClass::CreateCompleted);
+	OperationStartTime = FPlatformTime::Seconds();
+	Subsystem->CreateSession(NAME_GameSession, 4, Options.MatchType);
+}
+
+void UCustomSessionBenchmark::CreateCompleted(bool bWasSuccessful)
+{
+	Subsystem->OnCustomSessionCreateSessionCompleted.RemoveDynamic(this, &ThisClass::CreateCompleted);
+	if (!bWasSuccessful)
+	{
+		++Failures;
+	}
+
+	Subsystem->OnCustomSessionDestroySessionCompleted.AddUniqueDynamic(this, &ThisClass::DestroyCompleted);
+	Subsystem->DestroySession();
+}
+
+void UCustomSessionBenchmark::DestroyCompleted(bool bWasSuccessful)
+{
+	Subsystem->OnCustomSessionDestroySessionCompleted.RemoveDynamic(this, &ThisClass::DestroyCompleted);
+
+	++Iteration;
+	if (Phase == EPhase::Join)
+	{
+		RunNextTick(&ThisClass::StartJoinIteration);
+
+		return;
+	}
+
+	AddSample(TEXT("CreateDestroyCycle"), TEXT("ms"), ElapsedMs(OperationStartTime));
+	RunNextTick(&ThisClass::StartCreateDestroyCycle);
+}
+
+void UCustomSessionBenchmark::Finish()
+{
+	Phase = EPhase::Done;
+	if (MockSession.IsValid())
+	{
+		MockSession->OnSearchResultsDelivered.RemoveAll(this);
+		WriteReport();
+	}
+
+	RunningBenchmark = nullptr;
+	RemoveFromRoot();
+
+	if (Options.bQuitWhenDone)
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UCustomSessionBenchmark::WriteReport() const
+{
+	FString Csv = TEXT("Metric,Unit,Samples,Min,Mean,P50,P95,P99,Max\n");
+	TArray<TSharedPtr<FJsonValue>> JsonMetrics;
+	for (const FCustomSessionBenchmarkMetric& Metric : Metrics)
+	{
+		TArray<double> Sorted = Metric.Samples;
+		Sorted.Sort();
+
+		double Sum = 0.0;
+		for (const double Sample : Sorted)
+		{
+			Sum += Sample;
+		}
+
+		const double Mean = Sorted.IsEmpty() ? 0.0 : Sum / Sorted.Num();
+		const double Min = Sorted.IsEmpty() ? 0.0 : Sorted[0];
+		const double Max = Sorted.IsEmpty() ? 0.0 : Sorted.Last();
+		const double P50 = CustomSessionBenchmark::Percentile(Sorted, 0.5);
+		const double P95 = CustomSessionBenchmark::Percentile(Sorted, 0.95);
+		const double P99 = CustomSessionBenchmark::Percentile(Sorted, 0.99);
+
+		Csv += FString::Printf(TEXT("%s,%s,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"), *Metric.Name, *Metric.Unit, Sorted.Num(), Min, Mean, P50, P95, P99, Max);
+
+		const TSharedRef<FJsonObject> JsonMetric = MakeShared<FJsonObject>();
+		JsonMetric->SetStringField(TEXT("name"), Metric.Name);
+		JsonMetric->SetStringField(TEXT("unit"), Metric.Unit);
+		JsonMetric->SetNumberField(TEXT("samples"), Sorted.Num());
+		JsonMetric->SetNumberField(TEXT("min"), Min);
+		JsonMetric->SetNumberField(TEXT("mean"), Mean);
+		JsonMetric->SetNumberField(TEXT("p50"), P50);
+		JsonMetric->SetNumberField(TEXT("p95"), P95);
+		JsonMetric->SetNumberField(TEXT("p99"), P99);
+		JsonMetric->SetNumberField(TEXT("max"), Max);
+		JsonMetrics.Add(MakeShared<FJsonValueObject>(JsonMetric));
+	}
+
+	const TSharedRef<FJsonObject> JsonReport = MakeShared<FJsonObject>();
+	JsonReport->SetStringField(TEXT("build"), FApp::GetBuildVersion());
+	JsonReport->SetStringField(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	JsonReport->SetNumberField(TEXT("iterations"), Options.Iterations);
+	JsonReport->SetNumberField(TEXT("mockLatencyMs"), Options.MockLatencyMs);
+	JsonReport->SetNumberField(TEXT("syntheticSessions"), Options.NumSyntheticSessions);
+	JsonReport->SetArrayField(TEXT("metrics"), JsonMetrics);
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(JsonReport, JsonWriter);
+
+	const FString BasePath = FPaths::ProfilingDir() / TEXT("CustomSessions") / FString::Printf(TEXT("Benchmark-%s"), *FDateTime::Now().ToString());
+	FFileHelper::SaveStringToFile(Csv, *(BasePath + TEXT(".csv")));
+	FFileHelper::SaveStringToFile(Json, *(BasePath + TEXT(".json")));
+
+	UE_LOG(LogCustomSessions, Display, TEXT("Session benchmark written to %s.csv/.json\n%s"), *BasePath, *Csv);
+}
+
+void UCustomSessionBenchmark::AddSample(const FString& Name, const FString& Unit, double Value)
+{
+	FCustomSessionBenchmarkMetric* Metric = Metrics.FindByPredicate([&Name](const FCustomSessionBenchmarkMetric& Existing) { return Existing.Name == Name; });
+	if (Metric == nullptr)
+	{
+		Metric = &Metrics.AddDefaulted_GetRef();
+		Metric->Name = Name;
+		Metric->Unit = Unit;
+	}
+
+	Metric->Samples.Add(Value);
+}
+
+void UCustomSessionBenchmark::RunNextTick(void (UCustomSessionBenchmark::*Step)())
+{
+	// never start the next operation from inside the subsystem's broadcast of the previous one
+	Subsystem->GetGameInstance()->GetTimerManager().SetTimerForNextTick(this, Step);
+}
+
+double UCustomSessionBenchmark::ElapsedMs(double StartTime)
+{
+	return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+}
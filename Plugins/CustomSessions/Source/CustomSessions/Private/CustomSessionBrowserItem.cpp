@@ -0,0 +1,40 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionBrowserItem.h"
+
+#include "CustomSessionSubsystem.h"
+
+void UCustomSessionBrowserItem::SetFromResult(const FOnlineSessionSearchResult& Result)
+{
+	SessionId = Result.GetSessionIdStr();
+	OwnerName = Result.Session.OwningUserName;
+	MatchType.Reset();
+	Result.Session.SessionSettings.Get(CustomSessionsApi::MatchTypeKey, MatchType);
+	PingInMs = Result.PingInMs;
+	OpenConnections = Result.Session.NumOpenPublicConnections;
+	MaxConnections = Result.Session.SessionSettings.NumPublicConnections;
+}
+
+void UCustomSessionBrowserItem::BindToSnapshot(const FCustomSessionSearchSnapshotRef& InSnapshot, int32 InResultIndex)
+{
+	Snapshot = InSnapshot;
+	ResultIndex = InResultIndex;
+	SetFromResult((*InSnapshot)[InResultIndex]);
+}
+
+void UCustomSessionBrowserItem::Reset()
+{
+	Snapshot.Reset();
+	ResultIndex = INDEX_NONE;
+	SessionId.Reset();
+	OwnerName.Reset();
+	MatchType.Reset();
+	PingInMs = 0;
+	OpenConnections = 0;
+	MaxConnections = 0;
+}
+
+const FOnlineSessionSearchResult* UCustomSessionBrowserItem::GetSearchResult() const
+{
+	return Snapshot.IsValid() && Snapshot->GetResults().IsValidIndex(ResultIndex) ? &(*Snapshot)[ResultIndex] : nullptr;
+}
@@ -0,0 +1,38 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionBrowserRow.h"
+
+#include "CustomSessionBrowserItem.h"
+#include "Components/TextBlock.h"
+
+void UCustomSessionBrowserRow::NativeOnListItemObjectSet(UObject* ListItemObject)
+{
+	IUserObjectListEntry::NativeOnListItemObjectSet(ListItemObject);
+
+	const UCustomSessionBrowserItem* Item = Cast<UCustomSessionBrowserItem>(ListItemObject);
+	if (!IsValid(Item))
+	{
+		return;
+	}
+
+	if (Text_Owner)
+	{
+		Text_Owner->SetText(FText::FromString(Item->OwnerName));
+	}
+
+	if (Text_MatchType)
+	{
+		Text_MatchType->SetText(FText::FromString(Item->MatchType));
+	}
+
+	if (Text_Ping)
+	{
+		Text_Ping->SetText(FText::AsNumber(Item->PingInMs));
+	}
+
+	if (Text_Players)
+	{
+		const int32 NumPlayers = FMath::Max(0, Item->MaxConnections - Item->OpenConnections);
+		Text_Players->SetText(FText::Format(INVTEXT("{0}/{1}"), FText::AsNumber(NumPlayers), FText::AsNumber(Item->MaxConnections)));
+	}
+}
@@ -0,0 +1,276 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionBrowserWidget.h"
+
+#include "CustomSessionBrowserItem.h"
+#include "CustomSessionSubsystem.h"
+#include "Components/Button.h"
+#include "Components/EditableTextBox.h"
+#include "Components/ListView.h"
+#include "Engine/GameInstance.h"
+
+void UCustomSessionBrowserWidget::NativeConstruct()
+{
+	Super::NativeConstruct();
+
+	if (const UGameInstance* GameInstance = GetGameInstance())
+	{
+		CustomSessionSubsystem = GameInstance->GetSubsystem<UCustomSessionSubsystem>();
+	}
+
+	if (ListView_Sessions)
+	{
+		ListView_Sessions->OnItemClicked().AddUObject(this, &ThisClass::ItemClicked);
+	}
+
+	if (Button_Refresh)
+	{
+		Button_Refresh->OnClicked.AddUniqueDynamic(this, &ThisClass::RefreshClicked);
+	}
+
+	if (EditableTextBox_Filter)
+	{
+		EditableTextBox_Filter->OnTextChanged.AddUniqueDynamic(this, &ThisClass::TextFilterChanged);
+	}
+}
+
+void UCustomSessionBrowserWidget::NativeDestruct()
+{
+	if (IsValid(CustomSessionSubsystem))
+	{
+		CustomSessionSubsystem->OnCustomSessionSearchProgress.RemoveAll(this);
+	}
+
+	++RefreshSerial;
+
+	if (ListView_Sessions)
+	{
+		ListView_Sessions->OnItemClicked().RemoveAll(this);
+	}
+
+	Super::NativeDestruct();
+}
+
+void UCustomSessionBrowserWidget::NativeTick(const FGeometry& MyGeometry, float InDeltaTime)
+{
+	Super::NativeTick(MyGeometry, InDeltaTime);
+
+	// however many batches arrived this frame, the list is sorted once
+	if (bListDirty)
+	{
+		ApplySortAndFilter();
+	}
+}
+
+void UCustomSessionBrowserWidget::Refresh()
+{
+	if (!IsValid(CustomSessionSubsystem))
+	{
+		return;
+	}
+
+	StaleItems.Append(Items);
+	Items.Reset();
+	ItemsBySessionId.Reset();
+
+	const TArray<FCustomSessionSearchFilter> NoFilters;
+	SearchKey = CustomSessionSubsystem->GetSearchKey(NoFilters, MatchType);
+	++RefreshSerial;
+
+	CustomSessionSubsystem->OnCustomSessionSearchProgress.RemoveAll(this);
+	CustomSessionSubsystem->OnCustomSessionSearchProgress.AddUObject(this, &ThisClass::SearchProgress);
+
+	// searches started by anyone else complete on the public delegate, the browser only shows its own
+	CustomSessionSubsystem->FindSessionsAsync(NoFilters, MaxSearchResults, NAME_GameSession, MatchType)
+		.Next([WeakThis = TWeakObjectPtr<ThisClass>(this), Serial = RefreshSerial](const FCustomSessionFindResult& FindResult)
+		{
+			ThisClass* This = WeakThis.Get();
+			if (This != nullptr && This->RefreshSerial == Serial)
+			{
+				This->SearchCompleted(FindResult.Snapshot, FindResult.bWasSuccessful);
+			}
+		});
+}
+
+void UCustomSessionBrowserWidget::SetSortMode(ECustomSessionBrowserSort NewSortMode, bool bNewSortDescending)
+{
+	SortMode = NewSortMode;
+	bSortDescending = bNewSortDescending;
+	bListDirty = true;
+}
+
+void UCustomSessionBrowserWidget::SetTextFilter(const FString& NewTextFilter)
+{
+	TextFilter = NewTextFilter;
+	bListDirty = true;
+}
+
+void UCustomSessionBrowserWidget::SetHideFullSessions(bool bHide)
+{
+	bHideFullSessions = bHide;
+	bListDirty = true;
+}
+
+void UCustomSessionBrowserWidget::SearchProgress(const TArray<FOnlineSessionSearchResult>& PartialResults, int32 FirstNewResult)
+{
+	if (!IsValid(CustomSessionSubsystem) || !CustomSessionSubsystem->IsSearchInFlight(SearchKey))
+	{
+		return;
+	}
+
+	for (UCustomSessionBrowserItem* StaleItem : StaleItems)
+	{
+		ReleaseItem(StaleItem);
+	}
+
+	StaleItems.Reset();
+
+	for (int32 Index = FirstNewResult; Index < PartialResults.Num(); ++Index)
+	{
+		const FOnlineSessionSearchResult& Result = PartialResults[Index];
+		if (!Result.IsValid() || ItemsBySessionId.Contains(Result.GetSessionIdStr()))
+		{
+			continue;
+		}
+
+		UCustomSessionBrowserItem* Item = AcquireItem();
+		Item->SetFromResult(Result);
+		Items.Add(Item);
+		ItemsBySessionId.Add(Item->SessionId, Item);
+	}
+
+	bListDirty = true;
+}
+
+void UCustomSessionBrowserWidget::SearchCompleted(const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful)
+{
+	if (IsValid(CustomSessionSubsystem))
+	{
+		CustomSessionSubsystem->OnCustomSessionSearchProgress.RemoveAll(this);
+	}
+
+	for (UCustomSessionBrowserItem* StaleItem : StaleItems)
+	{
+		ReleaseItem(StaleItem);
+	}
+
+	StaleItems.Reset();
+
+	// items shown while searching are bound to their final result, the ones filtered out meanwhile go back to the pool
+	TArray<UCustomSessionBrowserItem*> CompletedItems;
+	CompletedItems.Reserve(Snapshot->Num());
+	for (int32 Index = 0; Index < Snapshot->Num(); ++Index)
+	{
+		const FOnlineSessionSearchResult& Result = (*Snapshot)[Index];
+		if (!Result.IsValid())
+		{
+			continue;
+		}
+
+		UCustomSessionBrowserItem* Item = nullptr;
+		if (!ItemsBySessionId.RemoveAndCopyValue(Result.GetSessionIdStr(), Item))
+		{
+			Item = AcquireItem();
+		}
+
+		Item->BindToSnapshot(Snapshot, Index);
+		CompletedItems.Add(Item);
+	}
+
+	for (const TPair<FString, UCustomSessionBrowserItem*>& Unmatched : ItemsBySessionId)
+	{
+		ReleaseItem(Unmatched.Value);
+	}
+
+	Items = MoveTemp(CompletedItems);
+	ItemsBySessionId.Reset();
+	for (UCustomSessionBrowserItem* Item : Items)
+	{
+		ItemsBySessionId.Add(Item->SessionId, Item);
+	}
+
+	bListDirty = true;
+}
+
+void UCustomSessionBrowserWidget::ItemClicked(UObject* Item)
+{
+	const UCustomSessionBrowserItem* BrowserItem = Cast<UCustomSessionBrowserItem>(Item);
+	const FOnlineSessionSearchResult* SearchResult = IsValid(BrowserItem) ? BrowserItem->GetSearchResult() : nullptr;
+	if (SearchResult == nullptr)
+	{
+		return;
+	}
+
+	OnSessionChosen.Broadcast(*SearchResult);
+}
+
+void UCustomSessionBrowserWidget::RefreshClicked()
+{
+	Refresh();
+}
+
+void UCustomSessionBrowserWidget::TextFilterChanged(const FText& Text)
+{
+	SetTextFilter(Text.ToString());
+}
+
+UCustomSessionBrowserItem* UCustomSessionBrowserWidget::AcquireItem()
+{
+	if (!ItemPool.IsEmpty())
+	{
+		return ItemPool.Pop(false);
+	}
+
+	return NewObject<UCustomSessionBrowserItem>(this);
+}
+
+void UCustomSessionBrowserWidget::ReleaseItem(UCustomSessionBrowserItem* Item)
+{
+	Item->Reset();
+	ItemPool.Add(Item);
+}
+
+bool UCustomSessionBrowserWidget::PassesFilter(const UCustomSessionBrowserItem* Item) const
+{
+	if (bHideFullSessions && Item->OpenConnections <= 0)
+	{
+		return false;
+	}
+
+	return TextFilter.IsEmpty() || Item->OwnerName.Contains(TextFilter) || Item->MatchType.Contains(TextFilter);
+}
+
+void UCustomSessionBrowserWidget::ApplySortAndFilter()
+{
+	bListDirty = false;
+
+	// stale items stay on screen until the new search returns something
+	const TArray<UCustomSessionBrowserItem*>& SourceItems = Items.IsEmpty() ? StaleItems : Items;
+	VisibleItems.Reset(SourceItems.Num());
+	for (UCustomSessionBrowserItem* Item : SourceItems)
+	{
+		if (PassesFilter(Item))
+		{
+			VisibleItems.Add(Item);
+		}
+	}
+
+	const ECustomSessionBrowserSort Mode = SortMode;
+	const bool bDescending = bSortDescending;
+	VisibleItems.StableSort([Mode, bDescending](const UCustomSessionBrowserItem& Lhs, const UCustomSessionBrowserItem& Rhs)
+	{
+		const UCustomSessionBrowserItem& First = bDescending ? Rhs : Lhs;
+		const UCustomSessionBrowserItem& Second = bDescending ? Lhs : Rhs;
+		switch (Mode)
+		{
+			case ECustomSessionBrowserSort::OpenConnections:	return First.OpenConnections < Second.OpenConnections;
+			case ECustomSessionBrowserSort::OwnerName:			return First.OwnerName < Second.OwnerName;
+			default:											return First.PingInMs < Second.PingInMs;
+		}
+	});
+
+	if (ListView_Sessions)
+	{
+		ListView_Sessions->SetListItems(VisibleItems);
+	}
+}
@@ -0,0 +1,129 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionDiagnostics.h"
+
+#include "Engine/Engine.h"
+#include "HAL/IConsoleManager.h"
+
+DEFINE_LOG_CATEGORY(LogCustomSessions);
+
+namespace CustomSessionDiagnostics
+{
+	float MaxEventsPerSecond = 10.0f;
+	FAutoConsoleVariableRef CVarMaxEventsPerSecond(
+		TEXT("CustomSessions.Diagnostics.MaxEventsPerSecond"),
+		MaxEventsPerSecond,
+		TEXT("Events each diagnostics category emits per second at most, bursts up to the same amount; 0 disables the limit"));
+
+	bool bOnScreen = true;
+	FAutoConsoleVariableRef CVarOnScreen(
+		TEXT("CustomSessions.Diagnostics.OnScreen"),
+		bOnScreen,
+		TEXT("Copies the diagnostics on screen in development builds, never on dedicated servers"));
+
+	struct FTokenBucket
+	{
+		float Tokens = 0.0f;
+		double LastRefillTime = 0.0;
+		int32 Suppressed = 0;
+	};
+
+	/** Per category, the bucket of the informational events and the one of warnings and errors */
+	FTokenBucket Buckets[static_cast<int32>(ECustomSessionDiagnostics::Count)][2];
+
+	FColor GetColor(ELogVerbosity::Type Verbosity)
+	{
+		switch (Verbosity & ELogVerbosity::VerbosityMask)
+		{
+			case ELogVerbosity::Fatal:
+			case ELogVerbosity::Error:		return FColor::Red;
+			case ELogVerbosity::Warning:	return FColor::Orange;
+			case ELogVerbosity::Display:	return FColor::Emerald;
+			default:						return FColor::Cyan;
+		}
+	}
+}
+
+bool FCustomSessionDiagnostics::TryConsume(ECustomSessionDiagnostics Category, ELogVerbosity::Type Verbosity, int32& OutSuppressed)
+{
+	using namespace CustomSessionDiagnostics;
+
+	OutSuppressed = 0;
+	if (MaxEventsPerSecond <= 0.0f)
+	{
+		return true;
+	}
+
+	const bool bIsWarningOrWorse = (Verbosity & ELogVerbosity::VerbosityMask) <= ELogVerbosity::Warning;
+	FTokenBucket& Bucket = Buckets[static_cast<int32>(Category)][bIsWarningOrWorse ? 1 : 0];
+	const double Now = FPlatformTime::Seconds();
+	Bucket.Tokens = FMath::Min(MaxEventsPerSecond, Bucket.Tokens + static_cast<float>(Now - Bucket.LastRefillTime) * MaxEventsPerSecond);
+	Bucket.LastRefillTime = Now;
+	if (Bucket.Tokens < 1.0f)
+	{
+		++Bucket.Suppressed;
+
+		return false;
+	}
+
+	Bucket.Tokens -= 1.0f;
+	OutSuppressed = Bucket.Suppressed;
+	Bucket.Suppressed = 0;
+
+	return true;
+}
+
+void FCustomSessionDiagnostics::Emit(ECustomSessionDiagnostics Category, ELogVerbosity::Type Verbosity, const TCHAR* EventName,
+									 std::initializer_list<FCustomSessionDiagnosticField> Fields)
+{
+	int32 Suppressed = 0;
+	if (!TryConsume(Category, Verbosity, Suppressed))
+	{
+		return;
+	}
+
+	TStringBuilder<256> Line;
+	Line << GetCategoryName(Category) << TEXT(" event=") << EventName;
+	for (const FCustomSessionDiagnosticField& Field : Fields)
+	{
+		Line << TEXT(' ') << Field.Key << TEXT('=');
+		int32 SpaceIndex = INDEX_NONE;
+		if (Field.Value.IsEmpty() || Field.Value.FindChar(TEXT(' '), SpaceIndex))
+		{
+			Line << TEXT('"') << Field.Value << TEXT('"');
+		}
+		else
+		{
+			Line << Field.Value;
+		}
+	}
+
+	if (Suppressed > 0)
+	{
+		Line << TEXT(" suppressed=") << Suppressed;
+	}
+
+	GLog->Log(LogCustomSessions.GetCategoryName(), Verbosity, Line.ToString());
+
+#if CUSTOMSESSIONS_WITH_ONSCREEN_DIAGNOSTICS
+	if (CustomSessionDiagnostics::bOnScreen && GEngine && !IsRunningDedicatedServer())
+	{
+		// every event keeps a single line on screen, updated in place instead of stacking up
+		const uint64 Key = HashCombine(GetTypeHash(static_cast<uint8>(Category)), FCrc::StrCrc32(EventName));
+		GEngine->AddOnScreenDebugMessage(Key, 15.0f, CustomSessionDiagnostics::GetColor(Verbosity), Line.ToString());
+	}
+#endif
+}
+
+const TCHAR* FCustomSessionDiagnostics::GetCategoryName(ECustomSessionDiagnostics Category)
+{
+	switch (Category)
+	{
+		case ECustomSessionDiagnostics::Session:	return TEXT("Session");
+		case ECustomSessionDiagnostics::Search:		return TEXT("Search");
+		case ECustomSessionDiagnostics::Join:		return TEXT("Join");
+		case ECustomSessionDiagnostics::Players:	return TEXT("Players");
+		case ECustomSessionDiagnostics::UI:			return TEXT("UI");
+		default:									return TEXT("Unknown");
+	}
+}
@@ -0,0 +1,518 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionLatencyProbe.h"
+
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionProbeProtocol.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+namespace CustomSessionProbe
+{
+	void WriteUInt32(uint8* Data, uint32 Value)
+	{
+		for (int32 Byte = 0; Byte < 4; ++Byte)
+		{
+			Data[Byte] = static_cast<uint8>(Value >> (Byte * 8));
+		}
+	}
+
+	uint32 ReadUInt32(const uint8* Data)
+	{
+		uint32 Value = 0;
+		for (int32 Byte = 0; Byte < 4; ++Byte)
+		{
+			Value |= static_cast<uint32>(Data[Byte]) << (Byte * 8);
+		}
+
+		return Value;
+	}
+
+	void WriteHeader(uint8* Data, const FHeader& Header)
+	{
+		WriteUInt32(Data, Magic);
+		Data[4] = static_cast<uint8>(Header.Message);
+		Data[5] = Header.Value;
+		Data[6] = static_cast<uint8>(Header.Index);
+		Data[7] = static_cast<uint8>(Header.Index >> 8);
+		WriteUInt32(Data + 8, Header.Sequence);
+	}
+
+	bool ReadHeader(const uint8* Data, int32 Size, FHeader& OutHeader)
+	{
+		if (Size < HeaderSize || ReadUInt32(Data) != Magic)
+		{
+			return false;
+		}
+
+		OutHeader.Message = static_cast<EMessage>(Data[4]);
+		OutHeader.Value = Data[5];
+		OutHeader.Index = static_cast<uint16>(Data[6] | (Data[7] << 8));
+		OutHeader.Sequence = ReadUInt32(Data + 8);
+
+		const bool bIsReservation = OutHeader.Message == EMessage::Reserve || OutHeader.Message == EMessage::Reserved || OutHeader.Message == EMessage::Release;
+
+		return Size == (bIsReservation ? ReservationSize : HeaderSize);
+	}
+
+	void WriteToken(uint8* Data, const FGuid& Token)
+	{
+		for (int32 Component = 0; Component < 4; ++Component)
+		{
+			WriteUInt32(Data + HeaderSize + Component * 4, Token[Component]);
+		}
+	}
+
+	FGuid ReadToken(const uint8* Data)
+	{
+		const uint8* Token = Data + HeaderSize;
+
+		return FGuid(ReadUInt32(Token), ReadUInt32(Token + 4), ReadUInt32(Token + 8), ReadUInt32(Token + 12));
+	}
+
+	void DestroySocket(FSocket*& Socket)
+	{
+		if (Socket == nullptr)
+		{
+			return;
+		}
+
+		Socket->Close();
+		ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM)->DestroySocket(Socket);
+		Socket = nullptr;
+	}
+}
+
+FCustomSessionProbeResponder::~FCustomSessionProbeResponder()
+{
+	Stop();
+}
+
+bool FCustomSessionProbeResponder::Start(int32 FirstPort, int32 NumPortsToTry)
+{
+	if (IsListening())
+	{
+		return true;
+	}
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (SocketSubsystem == nullptr || FirstPort <= 0)
+	{
+		return false;
+	}
+
+	for (int32 Candidate = FirstPort; Candidate < FirstPort + FMath::Max(NumPortsToTry, 1) && Candidate <= MAX_uint16; ++Candidate)
+	{
+		Socket = FUdpSocketBuilder(TEXT("CustomSessionsProbeResponder"))
+			.AsNonBlocking()
+			.BoundToPort(Candidate)
+			.Build();
+
+		if (Socket != nullptr)
+		{
+			Port = Candidate;
+			break;
+		}
+	}
+
+	if (Socket == nullptr)
+	{
+		UE_LOG(LogCustomSessions, Warning, TEXT("Could not bind a latency probe port in [%d, %d)"), FirstPort, FirstPort + NumPortsToTry);
+
+		return false;
+	}
+
+	Sender = SocketSubsystem->CreateInternetAddr();
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FCustomSessionProbeResponder::Tick));
+	UE_LOG(LogCustomSessions, Log, TEXT("Answering latency probes on port %d"), Port);
+
+	return true;
+}
+
+void FCustomSessionProbeResponder::Stop()
+{
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+
+	CustomSessionProbe::DestroySocket(Socket);
+	Port = 0;
+	Senders.Reset();
+}
+
+bool FCustomSessionProbeResponder::Tick(float DeltaTime)
+{
+	uint8 Data[CustomSessionProbe::MaxPacketSize];
+	uint32 PendingSize = 0;
+	while (Socket->HasPendingData(PendingSize))
+	{
+		int32 BytesRead = 0;
+		if (!Socket->RecvFrom(Data, sizeof(Data), BytesRead, *Sender))
+		{
+			break;
+		}
+
+		CustomSessionProbe::FHeader Header;
+		if (!CustomSessionProbe::ReadHeader(Data, BytesRead, Header))
+		{
+			continue;
+		}
+
+		switch (Header.Message)
+		{
+			case CustomSessionProbe::EMessage::Ping:
+			{
+				// the answer is the same packet, the prober keeps the send times on its side
+				Header.Message = CustomSessionProbe::EMessage::Pong;
+			}
+			break;
+
+			case CustomSessionProbe::EMessage::Reserve:
+			{
+				// flooding senders get no answer at all, answering would make the host a reflector
+				const double Now = FPlatformTime::Seconds();
+				FSenderReservations* SenderReservations = AdmitReserveRequest(Now);
+				if (SenderReservations == nullptr)
+				{
+					continue;
+				}
+
+				// answered every time it is asked, a lost answer is recovered by asking again with the same token
+				const ECustomSessionReservationResult Result = Reserve(*SenderReservations, CustomSessionProbe::ReadToken(Data), Header.Value, Now);
+				Header.Message = CustomSessionProbe::EMessage::Reserved;
+				Header.Value = static_cast<uint8>(Result);
+			}
+			break;
+
+			case CustomSessionProbe::EMessage::Release:
+			{
+				Release(CustomSessionProbe::ReadToken(Data));
+			}
+			continue;
+
+			default:
+			continue;
+		}
+
+		CustomSessionProbe::WriteHeader(Data, Header);
+		int32 BytesSent = 0;
+		Socket->SendTo(Data, BytesRead, BytesSent, *Sender);
+	}
+
+	return true;
+}
+
+FCustomSessionProbeResponder::FSenderReservations* FCustomSessionProbeResponder::AdmitReserveRequest(double Now)
+{
+	const FString Address = Sender->ToString(false);
+	FSenderReservations* SenderReservations = Senders.Find(Address);
+	if (SenderReservations == nullptr)
+	{
+		if (Senders.Num() >= MaxTrackedSenders)
+		{
+			PruneSenders(Now);
+		}
+
+		if (Senders.Num() >= MaxTrackedSenders)
+		{
+			return nullptr;
+		}
+
+		SenderReservations = &Senders.Add(Address);
+	}
+
+	if (Now - SenderReservations->WindowStart >= 1.0)
+	{
+		SenderReservations->WindowStart = Now;
+		SenderReservations->NumRequests = 0;
+	}
+
+	return ++SenderReservations->NumRequests <= Limits.MaxRequestsPerSecond ? SenderReservations : nullptr;
+}
+
+ECustomSessionReservationResult FCustomSessionProbeResponder::Reserve(FSenderReservations& SenderReservations, const FGuid& Token, int32 NumSlots, double Now)
+{
+	if (!OnReserveSlots.IsBound() || !Token.IsValid() || NumSlots <= 0)
+	{
+		return ECustomSessionReservationResult::Unavailable;
+	}
+
+	// no party is that large, it would only hold slots other players could use
+	if (NumSlots > Limits.MaxSlotsPerRequest)
+	{
+		return ECustomSessionReservationResult::Full;
+	}
+
+	SenderReservations.Granted.RemoveAll([Now](const FGrantedReservation& Granted) { return Granted.ExpiryTime <= Now; });
+
+	int32 OtherReservations = 0;
+	int32 OtherSlots = 0;
+	for (const FGrantedReservation& Granted : SenderReservations.Granted)
+	{
+		if (Granted.Token != Token)
+		{
+			++OtherReservations;
+			OtherSlots += Granted.NumSlots;
+		}
+	}
+
+	if (OtherReservations >= Limits.MaxReservationsPerAddress || OtherSlots + NumSlots > Limits.MaxSlotsPerAddress)
+	{
+		return ECustomSessionReservationResult::Full;
+	}
+
+	const ECustomSessionReservationResult Result = OnReserveSlots.Execute(Token, NumSlots);
+	if (Result != ECustomSessionReservationResult::Granted)
+	{
+		return Result;
+	}
+
+	FGrantedReservation* Existing = SenderReservations.Granted.FindByPredicate([&Token](const FGrantedReservation& Granted) { return Granted.Token == Token; });
+	if (Existing == nullptr)
+	{
+		Existing = &SenderReservations.Granted.Add_GetRef(FGrantedReservation{Token});
+	}
+
+	Existing->NumSlots = FMath::Max(Existing->NumSlots, NumSlots);
+	Existing->ExpiryTime = Now + Limits.Lifetime;
+
+	return Result;
+}
+
+void FCustomSessionProbeResponder::Release(const FGuid& Token)
+{
+	if (!Token.IsValid())
+	{
+		return;
+	}
+
+	for (TPair<FString, FSenderReservations>& SenderReservations : Senders)
+	{
+		SenderReservations.Value.Granted.RemoveAll([&Token](const FGrantedReservation& Granted) { return Granted.Token == Token; });
+	}
+
+	OnReleaseSlots.ExecuteIfBound(Token);
+}
+
+void FCustomSessionProbeResponder::PruneSenders(double Now)
+{
+	for (auto It = Senders.CreateIterator(); It; ++It)
+	{
+		FSenderReservations& SenderReservations = It.Value();
+		SenderReservations.Granted.RemoveAll([Now](const FGrantedReservation& Granted) { return Granted.ExpiryTime <= Now; });
+		if (SenderReservations.Granted.IsEmpty() && Now - SenderReservations.WindowStart >= 1.0)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+FCustomSessionLatencyProbe::FCustomSessionLatencyProbe(int32 InNumSamples, float InTimeout, float InCacheTime)
+	: NumSamples(FMath::Clamp(InNumSamples, 1, 32))
+	, Timeout(InTimeout)
+	, CacheTime(InCacheTime)
+{
+}
+
+FCustomSessionLatencyProbe::~FCustomSessionLatencyProbe()
+{
+	Cancel();
+	CustomSessionProbe::DestroySocket(Socket);
+}
+
+void FCustomSessionLatencyProbe::Probe(TArray<FCustomSessionProbeTarget>&& Targets, FCustomSessionProbesCompleted&& OnCompleted)
+{
+	Cancel();
+
+	++Round;
+	NextSample = 0;
+	Results.Reset();
+	OnProbesCompleted = MoveTemp(OnCompleted);
+
+	const bool bCanSend = EnsureSocket();
+	for (FCustomSessionProbeTarget& Target : Targets)
+	{
+		float CachedRoundTrip = 0.0f;
+		if (GetCachedRoundTrip(Target.Endpoint, CachedRoundTrip))
+		{
+			Results.Add(Target.Id, CachedRoundTrip);
+		}
+		else if (bCanSend && PendingTargets.Num() < MAX_uint16)
+		{
+			FPendingTarget& Pending = PendingTargets.AddDefaulted_GetRef();
+			Pending.Address = Target.Endpoint.ToInternetAddr();
+			Pending.Target = MoveTemp(Target);
+			Pending.SendTimes.SetNumZeroed(NumSamples);
+			Pending.RoundTrips.Reserve(NumSamples);
+		}
+		else
+		{
+			Results.Add(Target.Id, -1.0f);
+		}
+	}
+
+	if (PendingTargets.IsEmpty())
+	{
+		Complete();
+
+		return;
+	}
+
+	Deadline = FPlatformTime::Seconds() + Timeout;
+	SendNextSamples();
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FCustomSessionLatencyProbe::Tick));
+}
+
+void FCustomSessionLatencyProbe::Cancel()
+{
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+
+	PendingTargets.Reset();
+	OnProbesCompleted.Unbind();
+}
+
+bool FCustomSessionLatencyProbe::GetCachedRoundTrip(const FIPv4Endpoint& Endpoint, float& OutRoundTripMs) const
+{
+	const FCachedRoundTrip* Cached = Cache.Find(Endpoint);
+	if (Cached == nullptr || FPlatformTime::Seconds() - Cached->MeasuredTime > CacheTime)
+	{
+		return false;
+	}
+
+	OutRoundTripMs = Cached->RoundTripMs;
+
+	return true;
+}
+
+bool FCustomSessionLatencyProbe::Tick(float DeltaTime)
+{
+	ReceiveAnswers();
+
+	const bool bAllAnswered = !PendingTargets.ContainsByPredicate([this](const FPendingTarget& Pending)
+	{
+		return Pending.RoundTrips.Num() < NumSamples;
+	});
+
+	if (bAllAnswered || FPlatformTime::Seconds() >= Deadline)
+	{
+		TickerHandle.Reset();
+		Complete();
+
+		return false;
+	}
+
+	// one sample per frame and target, back to back samples would only measure the same queueing
+	SendNextSamples();
+
+	return true;
+}
+
+void FCustomSessionLatencyProbe::SendNextSamples()
+{
+	if (NextSample >= NumSamples)
+	{
+		return;
+	}
+
+	uint8 Data[CustomSessionProbe::HeaderSize];
+	for (int32 Index = 0; Index < PendingTargets.Num(); ++Index)
+	{
+		FPendingTarget& Pending = PendingTargets[Index];
+		CustomSessionProbe::WriteHeader(Data, {CustomSessionProbe::EMessage::Ping, static_cast<uint8>(NextSample), static_cast<uint16>(Index), Round});
+		Pending.SendTimes[NextSample] = FPlatformTime::Seconds();
+
+		int32 BytesSent = 0;
+		Socket->SendTo(Data, sizeof(Data), BytesSent, *Pending.Address);
+	}
+
+	++NextSample;
+}
+
+void FCustomSessionLatencyProbe::ReceiveAnswers()
+{
+	uint8 Data[CustomSessionProbe::MaxPacketSize];
+	uint32 PendingSize = 0;
+	while (Socket->HasPendingData(PendingSize))
+	{
+		int32 BytesRead = 0;
+		if (!Socket->RecvFrom(Data, sizeof(Data), BytesRead, *Sender))
+		{
+			break;
+		}
+
+		const double Now = FPlatformTime::Seconds();
+		CustomSessionProbe::FHeader Header;
+		if (!CustomSessionProbe::ReadHeader(Data, BytesRead, Header) || Header.Message != CustomSessionProbe::EMessage::Pong
+			|| Header.Sequence != Round || !PendingTargets.IsValidIndex(Header.Index) || Header.Value >= NumSamples)
+		{
+			continue;
+		}
+
+		// duplicated datagrams are counted once
+		const uint8 Sample = Header.Value;
+		FPendingTarget& Pending = PendingTargets[Header.Index];
+		const uint32 SampleBit = 1u << (Sample % 32);
+		if ((Pending.AnsweredSamples & SampleBit) != 0 || Pending.SendTimes[Sample] <= 0.0)
+		{
+			continue;
+		}
+
+		Pending.AnsweredSamples |= SampleBit;
+		Pending.RoundTrips.Add(static_cast<float>((Now - Pending.SendTimes[Sample]) * 1000.0));
+	}
+}
+
+void FCustomSessionLatencyProbe::Complete()
+{
+	const double Now = FPlatformTime::Seconds();
+	for (FPendingTarget& Pending : PendingTargets)
+	{
+		if (Pending.RoundTrips.IsEmpty())
+		{
+			Results.Add(Pending.Target.Id, -1.0f);
+
+			continue;
+		}
+
+		Pending.RoundTrips.Sort();
+		const float Median = Pending.RoundTrips[Pending.RoundTrips.Num() / 2];
+		Results.Add(Pending.Target.Id, Median);
+		Cache.Add(Pending.Target.Endpoint, FCachedRoundTrip{Median, Now});
+		UE_LOG(LogCustomSessions, Verbose, TEXT("Probed %s: %.1fms over %d of %d samples"),
+			*Pending.Target.Endpoint.ToString(), Median, Pending.RoundTrips.Num(), NumSamples);
+	}
+
+	PendingTargets.Reset();
+
+	// the callback may start the next round
+	const FCustomSessionProbesCompleted Completed = MoveTemp(OnProbesCompleted);
+	OnProbesCompleted.Unbind();
+	const TMap<FString, float> RoundTrips = MoveTemp(Results);
+	Completed.ExecuteIfBound(RoundTrips);
+}
+
+bool FCustomSessionLatencyProbe::EnsureSocket()
+{
+	if (Socket != nullptr)
+	{
+		return true;
+	}
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (SocketSubsystem == nullptr)
+	{
+		return false;
+	}
+
+	Socket = FUdpSocketBuilder(TEXT("CustomSessionsLatencyProbe")).AsNonBlocking().Build();
+	Sender = SocketSubsystem->CreateInternetAddr();
+
+	return Socket != nullptr;
+}
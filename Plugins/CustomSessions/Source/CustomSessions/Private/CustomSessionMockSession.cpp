@@ -0,0 +1,679 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionMockSession.h"
+
+#include "Containers/Ticker.h"
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionSearchFilter.h"
+#include "CustomSessionSubsystem.h"
+#include "Misc/CommandLine.h"
+#include "Misc/ConfigCacheIni.h"
+#include "OnlineSubsystemTypes.h"
+
+namespace CustomSessionMock
+{
+	const TCHAR* ConfigSection = TEXT("CustomSessions.MockSessionBackend");
+	const FName NetIdType("CustomSessionsMock");
+
+	class FSessionInfo : public FOnlineSessionInfo
+	{
+	public:
+		FSessionInfo(const FString& InSessionId, const FString& InHostAddress)
+			: SessionId(FUniqueNetIdString::Create(InSessionId, NetIdType))
+			, HostAddress(InHostAddress)
+		{
+		}
+
+		virtual const uint8* GetBytes() const override { return nullptr; }
+		virtual int32 GetSize() const override { return sizeof(FSessionInfo); }
+		virtual bool IsValid() const override { return true; }
+		virtual FString ToString() const override { return SessionId->ToString(); }
+		virtual FString ToDebugString() const override { return FString::Printf(TEXT("MockSession %s at %s"), *SessionId->ToString(), *HostAddress); }
+		virtual const FUniqueNetId& GetSessionId() const override { return *SessionId; }
+
+		FUniqueNetIdRef SessionId;
+		FString HostAddress;
+	};
+}
+
+FCustomSessionMockSettings FCustomSessionMockSettings::LoadFromConfig()
+{
+	FCustomSessionMockSettings Settings;
+	if (GConfig)
+	{
+		const TCHAR* Section = CustomSessionMock::ConfigSection;
+		GConfig->GetBool(Section, TEXT("bEnabled"), Settings.bEnabled, GEngineIni);
+		GConfig->GetFloat(Section, TEXT("MinLatencyMs"), Settings.MinLatencyMs, GEngineIni);
+		GConfig->GetFloat(Section, TEXT("LatencyJitterMs"), Settings.LatencyJitterMs, GEngineIni);
+		GConfig->GetFloat(Section, TEXT("FailureRate"), Settings.FailureRate, GEngineIni);
+		GConfig->GetInt(Section, TEXT("NumSyntheticSessions"), Settings.NumSyntheticSessions, GEngineIni);
+		GConfig->GetInt(Section, TEXT("SyntheticMaxPublicConnections"), Settings.SyntheticMaxPublicConnections, GEngineIni);
+		GConfig->GetInt(Section, TEXT("SyntheticBuildUniqueId"), Settings.SyntheticBuildUniqueId, GEngineIni);
+		GConfig->GetArray(Section, TEXT("SyntheticMatchTypes"), Settings.SyntheticMatchTypes, GEngineIni);
+		GConfig->GetArray(Section, TEXT("SyntheticRegions"), Settings.SyntheticRegions, GEngineIni);
+		GConfig->GetInt(Section, TEXT("SearchResultsPerTick"), Settings.SearchResultsPerTick, GEngineIni);
+		GConfig->GetInt(Section, TEXT("RandomSeed"), Settings.RandomSeed, GEngineIni);
+	}
+
+	// -CustomSessionsMock forces the mock on, e.g. for CI runs with a shipping config
+	Settings.bEnabled |= FParse::Param(FCommandLine::Get(), TEXT("CustomSessionsMock"));
+	FParse::Value(FCommandLine::Get(), TEXT("CustomSessionsMockSessions="), Settings.NumSyntheticSessions);
+	FParse::Value(FCommandLine::Get(), TEXT("CustomSessionsMockFailureRate="), Settings.FailureRate);
+
+	if (Settings.SyntheticMatchTypes.IsEmpty())
+	{
+		Settings.SyntheticMatchTypes.Add(TEXT("FreeForAll"));
+	}
+
+	return Settings;
+}
+
+FCustomSessionMockSession::FCustomSessionMockSession(const FCustomSessionMockSettings& InSettings)
+	: Settings(InSettings)
+	, RandomStream(InSettings.RandomSeed)
+{
+	AdvertisedSessions.Reserve(Settings.NumSyntheticSessions);
+	for (int32 Index = 0; Index < Settings.NumSyntheticSessions; ++Index)
+	{
+		AdvertisedSessions.Add(MakeSyntheticResult(Settings, RandomStream, Index));
+	}
+}
+
+FOnlineSessionSearchResult FCustomSessionMockSession::MakeSyntheticResult(const FCustomSessionMockSettings& InSettings, FRandomStream& RandomStream, int32 Index)
+{
+	FOnlineSessionSearchResult Result;
+	Result.PingInMs = RandomStream.RandRange(5, 300);
+
+	FOnlineSession& Session = Result.Session;
+	Session.OwningUserName = FString::Printf(TEXT("MockHost%d"), Index);
+	Session.OwningUserId = FUniqueNetIdString::Create(Session.OwningUserName, CustomSessionMock::NetIdType);
+	Session.SessionInfo = MakeShared<CustomSessionMock::FSessionInfo>(FString::Printf(TEXT("MockSession%d"), Index),
+		FString::Printf(TEXT("127.0.0.1:%d"), 7777 + Index % 1000));
+
+	const int32 MaxConnections = FMath::Max(1, InSettings.SyntheticMaxPublicConnections);
+	Session.SessionSettings.NumPublicConnections = MaxConnections;
+	Session.SessionSettings.bShouldAdvertise = true;
+	Session.SessionSettings.bUsesPresence = true;
+	Session.SessionSettings.bUseLobbiesIfAvailable = true;
+	Session.SessionSettings.BuildUniqueId = UCustomSessionSubsystem::ResolveBuildUniqueId(InSettings.SyntheticBuildUniqueId);
+	Session.SessionSettings.Set(CustomSessionsApi::BuildKey, Session.SessionSettings.BuildUniqueId, EOnlineDataAdvertisementType::ViaOnlineService);
+	Session.NumOpenPublicConnections = RandomStream.RandRange(0, MaxConnections);
+
+	if (!InSettings.SyntheticMatchTypes.IsEmpty())
+	{
+		const FString& MatchType = InSettings.SyntheticMatchTypes[Index % InSettings.SyntheticMatchTypes.Num()];
+		Session.SessionSettings.Set(CustomSessionsApi::MatchTypeKey, MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	}
+
+	if (!InSettings.SyntheticRegions.IsEmpty())
+	{
+		const FString& Region = InSettings.SyntheticRegions[Index % InSettings.SyntheticRegions.Num()];
+		Session.SessionSettings.Set(CustomSessionsApi::RegionKey, Region, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	}
+
+	return Result;
+}
+
+FUniqueNetIdRef FCustomSessionMockSession::MakeLocalUserId(int32 LocalUserNum)
+{
+	return FUniqueNetIdString::Create(FString::Printf(TEXT("MockLocalPlayer%d"), LocalUserNum), CustomSessionMock::NetIdType);
+}
+
+void FCustomSessionMockSession::RunAfterLatency(TFunction<void(FCustomSessionMockSession&)>&& Callback)
+{
+	const float LatencySeconds = (Settings.MinLatencyMs + RandomStream.FRandRange(0.0f, Settings.LatencyJitterMs)) / 1000.0f;
+	TWeakPtr<FCustomSessionMockSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakThis, Callback = MoveTemp(Callback)](float)
+	{
+		if (const TSharedPtr<FCustomSessionMockSession, ESPMode::ThreadSafe> This = WeakThis.Pin())
+		{
+			Callback(*This);
+		}
+
+		return false;
+	}), LatencySeconds);
+}
+
+bool FCustomSessionMockSession::ShouldFail()
+{
+	return Settings.FailureRate > 0.0f && RandomStream.FRand() < Settings.FailureRate;
+}
+
+FUniqueNetIdPtr FCustomSessionMockSession::CreateSessionIdFromString(const FString& SessionIdStr)
+{
+	return FUniqueNetIdString::Create(SessionIdStr, CustomSessionMock::NetIdType);
+}
+
+FNamedOnlineSession* FCustomSessionMockSession::GetNamedSession(FName SessionName)
+{
+	return Sessions.FindByPredicate([SessionName](const FNamedOnlineSession& Session) { return Session.SessionName == SessionName; });
+}
+
+void FCustomSessionMockSession::RemoveNamedSession(FName SessionName)
+{
+	Sessions.RemoveAll([SessionName](const FNamedOnlineSession& Session) { return Session.SessionName == SessionName; });
+}
+
+EOnlineSessionState::Type FCustomSessionMockSession::GetSessionState(FName SessionName) const
+{
+	const FNamedOnlineSession* Session = Sessions.FindByPredicate([SessionName](const FNamedOnlineSession& Named) { return Named.SessionName == SessionName; });
+
+	return Session != nullptr ? Session->SessionState : EOnlineSessionState::NoSession;
+}
+
+bool FCustomSessionMockSession::HasPresenceSession()
+{
+	return Sessions.ContainsByPredicate([](const FNamedOnlineSession& Session) { return Session.SessionSettings.bUsesPresence; });
+}
+
+FNamedOnlineSession* FCustomSessionMockSession::AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings)
+{
+	return &Sessions.Emplace_GetRef(SessionName, SessionSettings);
+}
+
+FNamedOnlineSession* FCustomSessionMockSession::AddNamedSession(FName SessionName, const FOnlineSession& Session)
+{
+	return &Sessions.Emplace_GetRef(SessionName, Session);
+}
+
+bool FCustomSessionMockSession::CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	const FUniqueNetIdRef HostId = MakeLocalUserId(HostingPlayerNum);
+
+	return CreateSession(*HostId, SessionName, NewSessionSettings);
+}
+
+bool FCustomSessionMockSession::CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings)
+{
+	if (GetNamedSession(SessionName) != nullptr)
+	{
+		return false;
+	}
+
+	FNamedOnlineSession* Session = AddNamedSession(SessionName, NewSessionSettings);
+	Session->SessionState = EOnlineSessionState::Creating;
+	Session->OwningUserId = HostingPlayerId.AsShared();
+	Session->OwningUserName = HostingPlayerId.ToString();
+	Session->bHosting = true;
+	Session->NumOpenPublicConnections = NewSessionSettings.NumPublicConnections;
+	Session->NumOpenPrivateConnections = NewSessionSettings.NumPrivateConnections;
+	Session->SessionInfo = MakeShared<CustomSessionMock::FSessionInfo>(FString::Printf(TEXT("MockHosted%s"), *SessionName.ToString()), TEXT("127.0.0.1:7777"));
+
+	RunAfterLatency([SessionName](FCustomSessionMockSession& This)
+	{
+		FNamedOnlineSession* Created = This.GetNamedSession(SessionName);
+		const bool bWasSuccessful = Created != nullptr && !This.ShouldFail();
+		if (bWasSuccessful)
+		{
+			Created->SessionState = EOnlineSessionState::Pending;
+		}
+		else
+		{
+			This.RemoveNamedSession(SessionName);
+		}
+
+		This.TriggerOnCreateSessionCompleteDelegates(SessionName, bWasSuccessful);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::StartSession(FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	Session->SessionState = EOnlineSessionState::Starting;
+	RunAfterLatency([SessionName](FCustomSessionMockSession& This)
+	{
+		FNamedOnlineSession* Started = This.GetNamedSession(SessionName);
+		if (Started != nullptr)
+		{
+			Started->SessionState = EOnlineSessionState::InProgress;
+		}
+
+		This.TriggerOnStartSessionCompleteDelegates(SessionName, Started != nullptr);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	// players already in keep their slots, only the free ones follow the new capacity
+	const int32 UsedPublicConnections = Session->SessionSettings.NumPublicConnections - Session->NumOpenPublicConnections;
+	Session->SessionSettings = UpdatedSessionSettings;
+	Session->NumOpenPublicConnections = FMath::Max(0, UpdatedSessionSettings.NumPublicConnections - UsedPublicConnections);
+	RunAfterLatency([SessionName](FCustomSessionMockSession& This)
+	{
+		This.TriggerOnUpdateSessionCompleteDelegates(SessionName, This.GetNamedSession(SessionName) != nullptr);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::EndSession(FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	Session->SessionState = EOnlineSessionState::Ending;
+	RunAfterLatency([SessionName](FCustomSessionMockSession& This)
+	{
+		FNamedOnlineSession* Ended = This.GetNamedSession(SessionName);
+		if (Ended != nullptr)
+		{
+			Ended->SessionState = EOnlineSessionState::Ended;
+		}
+
+		This.TriggerOnEndSessionCompleteDelegates(SessionName, Ended != nullptr);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::DestroySession(FName SessionName, const FOnDestroySessionCompleteDelegate& CompletionDelegate)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	Session->SessionState = EOnlineSessionState::Destroying;
+	RunAfterLatency([SessionName, CompletionDelegate](FCustomSessionMockSession& This)
+	{
+		This.RemoveNamedSession(SessionName);
+		CompletionDelegate.ExecuteIfBound(SessionName, true);
+		This.TriggerOnDestroySessionCompleteDelegates(SessionName, true);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::IsPlayerInSession(FName SessionName, const FUniqueNetId& UniqueId)
+{
+	const FNamedOnlineSession* Session = GetNamedSession(SessionName);
+
+	return Session != nullptr && Session->RegisteredPlayers.ContainsByPredicate([&UniqueId](const FUniqueNetIdRef& Player) { return *Player == UniqueId; });
+}
+
+bool FCustomSessionMockSession::StartMatchmaking(const TArray<FUniqueNetIdRef>& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	const FUniqueNetIdRef SearchingId = MakeLocalUserId(SearchingPlayerNum);
+
+	return FindSessions(*SearchingId, SearchSettings);
+}
+
+bool FCustomSessionMockSession::FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings)
+{
+	if (CurrentSearch.IsValid())
+	{
+		return false;
+	}
+
+	CurrentSearch = SearchSettings;
+	SearchSettings->SearchState = EOnlineAsyncTaskState::InProgress;
+	SearchSettings->SearchResults.Reset();
+
+	const int32 SearchId = ++CurrentSearchId;
+	RunAfterLatency([SearchSettings, SearchId](FCustomSessionMockSession& This)
+	{
+		This.DeliverSearchResults(SearchSettings, SearchId, 0);
+	});
+
+	return true;
+}
+
+void FCustomSessionMockSession::DeliverSearchResults(TSharedRef<FOnlineSessionSearch> Search, int32 SearchId, int32 NextCandidate)
+{
+	if (SearchId != CurrentSearchId)
+	{
+		return;
+	}
+
+	if (NextCandidate == 0 && ShouldFail())
+	{
+		CurrentSearch.Reset();
+		Search->SearchState = EOnlineAsyncTaskState::Failed;
+		TriggerOnFindSessionsCompleteDelegates(false);
+
+		return;
+	}
+
+	// the backend applies every custom query setting, the same way a real lobby service filters server side
+	TArray<FCustomSessionSearchFilter> Filters;
+	for (const TPair<FName, FOnlineSessionSearchParam>& SearchParam : Search->QuerySettings.SearchParams)
+	{
+		if (SearchParam.Key != SEARCH_PRESENCE)
+		{
+			FCustomSessionSearchFilter& Filter = Filters.AddDefaulted_GetRef();
+			Filter.Key = SearchParam.Key;
+			Filter.Value = SearchParam.Value.Data;
+			Filter.ComparisonOp = SearchParam.Value.ComparisonOp;
+		}
+	}
+
+	const int32 MaxResults = Search->MaxSearchResults > 0 ? Search->MaxSearchResults : MAX_int32;
+	const int32 BatchSize = Settings.SearchResultsPerTick > 0 ? Settings.SearchResultsPerTick : MAX_int32;
+	int32 Delivered = 0;
+	int32 Candidate = NextCandidate;
+	for (; Candidate < AdvertisedSessions.Num() && Search->SearchResults.Num() < MaxResults && Delivered < BatchSize; ++Candidate)
+	{
+		const FOnlineSessionSearchResult& Advertised = AdvertisedSessions[Candidate];
+		const bool bMatches = !Filters.ContainsByPredicate([&Advertised](const FCustomSessionSearchFilter& Filter)
+		{
+			return !Filter.Matches(Advertised.Session.SessionSettings);
+		});
+
+		if (bMatches)
+		{
+			Search->SearchResults.Add(Advertised);
+			++Delivered;
+		}
+	}
+
+	if (Delivered > 0)
+	{
+		OnSearchResultsDelivered.Broadcast(Search->SearchResults.Num());
+	}
+
+	if (Candidate < AdvertisedSessions.Num() && Search->SearchResults.Num() < MaxResults)
+	{
+		TWeakPtr<FCustomSessionMockSession, ESPMode::ThreadSafe> WeakThis = AsShared();
+		FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakThis, Search, SearchId, Candidate](float)
+		{
+			if (const TSharedPtr<FCustomSessionMockSession, ESPMode::ThreadSafe> This = WeakThis.Pin())
+			{
+				This->DeliverSearchResults(Search, SearchId, Candidate);
+			}
+
+			return false;
+		}));
+
+		return;
+	}
+
+	CurrentSearch.Reset();
+	Search->SearchState = EOnlineAsyncTaskState::Done;
+	TriggerOnFindSessionsCompleteDelegates(true);
+}
+
+bool FCustomSessionMockSession::FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate)
+{
+	const FOnlineSessionSearchResult* Found = AdvertisedSessions.FindByPredicate([&SessionId](const FOnlineSessionSearchResult& Result)
+	{
+		return Result.Session.SessionInfo->GetSessionId() == SessionId;
+	});
+
+	const FOnlineSessionSearchResult Result = Found != nullptr ? *Found : FOnlineSessionSearchResult();
+	const bool bWasSuccessful = Found != nullptr;
+	RunAfterLatency([CompletionDelegate, Result, bWasSuccessful](FCustomSessionMockSession&)
+	{
+		CompletionDelegate.ExecuteIfBound(0, bWasSuccessful, Result);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::CancelFindSessions()
+{
+	if (!CurrentSearch.IsValid())
+	{
+		return false;
+	}
+
+	++CurrentSearchId;
+	CurrentSearch->SearchState = EOnlineAsyncTaskState::Failed;
+	CurrentSearch.Reset();
+	RunAfterLatency([](FCustomSessionMockSession& This)
+	{
+		This.TriggerOnCancelFindSessionsCompleteDelegates(true);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::PingSearchResults(const FOnlineSessionSearchResult& SearchResult)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::JoinSession(int32 LocalUserNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	const FUniqueNetIdRef LocalUserId = MakeLocalUserId(LocalUserNum);
+
+	return JoinSession(*LocalUserId, SessionName, DesiredSession);
+}
+
+bool FCustomSessionMockSession::JoinSession(const FUniqueNetId& LocalUserId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession)
+{
+	if (GetNamedSession(SessionName) != nullptr)
+	{
+		TriggerOnJoinSessionCompleteDelegates(SessionName, EOnJoinSessionCompleteResult::AlreadyInSession);
+
+		return false;
+	}
+
+	if (!DesiredSession.IsValid())
+	{
+		return false;
+	}
+
+	const FString DesiredSessionId = DesiredSession.GetSessionIdStr();
+	RunAfterLatency([SessionName, DesiredSessionId](FCustomSessionMockSession& This)
+	{
+		FOnlineSessionSearchResult* Advertised = This.AdvertisedSessions.FindByPredicate([&DesiredSessionId](const FOnlineSessionSearchResult& Result)
+		{
+			return Result.GetSessionIdStr() == DesiredSessionId;
+		});
+
+		EOnJoinSessionCompleteResult::Type JoinResult = EOnJoinSessionCompleteResult::Success;
+		if (Advertised == nullptr)
+		{
+			JoinResult = EOnJoinSessionCompleteResult::SessionDoesNotExist;
+		}
+		else if (Advertised->Session.NumOpenPublicConnections <= 0)
+		{
+			JoinResult = EOnJoinSessionCompleteResult::SessionIsFull;
+		}
+		else if (This.ShouldFail())
+		{
+			JoinResult = EOnJoinSessionCompleteResult::CouldNotRetrieveAddress;
+		}
+		else
+		{
+			// later searches see the slot as taken, so popular sessions fill up like they would on a real backend
+			--Advertised->Session.NumOpenPublicConnections;
+			FNamedOnlineSession* Joined = This.AddNamedSession(SessionName, Advertised->Session);
+			Joined->SessionState = EOnlineSessionState::Pending;
+			Joined->bHosting = false;
+		}
+
+		This.TriggerOnJoinSessionCompleteDelegates(SessionName, JoinResult);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::FindFriendSession(int32 LocalUserNum, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& FriendList)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::SendSessionInviteToFriend(const FUniqueNetId& LocalUserId, FName SessionName, const FUniqueNetId& Friend)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::SendSessionInviteToFriends(int32 LocalUserNum, FName SessionName, const TArray<FUniqueNetIdRef>& Friends)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::SendSessionInviteToFriends(const FUniqueNetId& LocalUserId, FName SessionName, const TArray<FUniqueNetIdRef>& Friends)
+{
+	return false;
+}
+
+bool FCustomSessionMockSession::GetResolvedConnectString(FName SessionName, FString& ConnectInfo, FName PortType)
+{
+	const FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr || !Session->SessionInfo.IsValid())
+	{
+		return false;
+	}
+
+	ConnectInfo = StaticCastSharedPtr<CustomSessionMock::FSessionInfo>(Session->SessionInfo)->HostAddress;
+
+	return true;
+}
+
+bool FCustomSessionMockSession::GetResolvedConnectString(const FOnlineSessionSearchResult& SearchResult, FName PortType, FString& ConnectInfo)
+{
+	if (!SearchResult.IsSessionInfoValid())
+	{
+		return false;
+	}
+
+	ConnectInfo = StaticCastSharedPtr<const CustomSessionMock::FSessionInfo>(SearchResult.Session.SessionInfo)->HostAddress;
+
+	return true;
+}
+
+FOnlineSessionSettings* FCustomSessionMockSession::GetSessionSettings(FName SessionName)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+
+	return Session != nullptr ? &Session->SessionSettings : nullptr;
+}
+
+bool FCustomSessionMockSession::RegisterPlayer(FName SessionName, const FUniqueNetId& PlayerId, bool bWasInvited)
+{
+	return RegisterPlayers(SessionName, { PlayerId.AsShared() }, bWasInvited);
+}
+
+bool FCustomSessionMockSession::RegisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players, bool bWasInvited)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	for (const FUniqueNetIdRef& Player : Players)
+	{
+		if (!Session->RegisteredPlayers.ContainsByPredicate([&Player](const FUniqueNetIdRef& Registered) { return *Registered == *Player; }))
+		{
+			Session->RegisteredPlayers.Add(Player);
+			Session->NumOpenPublicConnections = FMath::Max(0, Session->NumOpenPublicConnections - 1);
+		}
+	}
+
+	RunAfterLatency([SessionName, Players](FCustomSessionMockSession& This)
+	{
+		This.TriggerOnRegisterPlayersCompleteDelegates(SessionName, Players, true);
+	});
+
+	return true;
+}
+
+bool FCustomSessionMockSession::UnregisterPlayer(FName SessionName, const FUniqueNetId& PlayerId)
+{
+	return UnregisterPlayers(SessionName, { PlayerId.AsShared() });
+}
+
+bool FCustomSessionMockSession::UnregisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players)
+{
+	FNamedOnlineSession* Session = GetNamedSession(SessionName);
+	if (Session == nullptr)
+	{
+		return false;
+	}
+
+	for (const FUniqueNetIdRef& Player : Players)
+	{
+		if (Session->RegisteredPlayers.RemoveAll([&Player](const FUniqueNetIdRef& Registered) { return *Registered == *Player; }) > 0)
+		{
+			Session->NumOpenPublicConnections = FMath::Min(Session->SessionSettings.NumPublicConnections, Session->NumOpenPublicConnections + 1);
+		}
+	}
+
+	RunAfterLatency([SessionName, Players](FCustomSessionMockSession& This)
+	{
+		This.TriggerOnUnregisterPlayersCompleteDelegates(SessionName, Players, true);
+	});
+
+	return true;
+}
+
+void FCustomSessionMockSession::RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate)
+{
+	Delegate.ExecuteIfBound(PlayerId, EOnJoinSessionCompleteResult::Success);
+}
+
+void FCustomSessionMockSession::UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate)
+{
+	Delegate.ExecuteIfBound(PlayerId, true);
+}
+
+void FCustomSessionMockSession::RemovePlayerFromSession(int32 LocalUserNum, FName SessionName, const FUniqueNetId& TargetPlayerId)
+{
+	UnregisterPlayer(SessionName, TargetPlayerId);
+}
+
+int32 FCustomSessionMockSession::GetNumSessions()
+{
+	return Sessions.Num();
+}
+
+void FCustomSessionMockSession::DumpSessionState()
+{
+	UE_LOG(LogCustomSessions, Display, TEXT("Mock session backend: %d named sessions, %d advertised"), Sessions.Num(), AdvertisedSessions.Num());
+	for (const FNamedOnlineSession& Session : Sessions)
+	{
+		DumpNamedSession(&Session);
+	}
+}
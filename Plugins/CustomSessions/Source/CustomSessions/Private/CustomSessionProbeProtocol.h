@@ -0,0 +1,53 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FSocket;
+
+/** Datagrams exchanged with the probe responder of a host, little endian on the wire */
+namespace CustomSessionProbe
+{
+	/** "CSPB", so stray datagrams on the port are ignored */
+	constexpr uint32 Magic = 0x43535042;
+
+	enum class EMessage : uint8
+	{
+		Ping = 1,
+		Pong = 2,
+		Reserve = 3,
+		Reserved = 4,
+		Release = 5
+	};
+
+	/** Magic, message, value, index and sequence */
+	constexpr int32 HeaderSize = 12;
+
+	/** Reservation messages carry their token after the header */
+	constexpr int32 ReservationSize = HeaderSize + 16;
+
+	constexpr int32 MaxPacketSize = ReservationSize;
+
+	/**
+	 * Pings and pongs use Value for the sample, Index for the target and Sequence for the round.
+	 * Reservations use Value for the slots asked for or the result, and Sequence for the request
+	 */
+	struct FHeader
+	{
+		EMessage Message = EMessage::Ping;
+		uint8 Value = 0;
+		uint16 Index = 0;
+		uint32 Sequence = 0;
+	};
+
+	void WriteHeader(uint8* Data, const FHeader& Header);
+
+	/** @return false if the datagram is not ours or too short for its message */
+	bool ReadHeader(const uint8* Data, int32 Size, FHeader& OutHeader);
+
+	void WriteToken(uint8* Data, const FGuid& Token);
+	FGuid ReadToken(const uint8* Data);
+
+	void DestroySocket(FSocket*& Socket);
+}
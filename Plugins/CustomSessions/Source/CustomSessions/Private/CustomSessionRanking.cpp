@@ -0,0 +1,96 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionRanking.h"
+
+#include "CustomSessionSubsystem.h"
+
+bool FCustomSessionRanking::Score(const FOnlineSessionSearchResult& Result, const FCustomSessionRankingContext& Context, float& OutScore)
+{
+	if (!Result.IsValid() || !Result.IsSessionInfoValid())
+	{
+		return false;
+	}
+
+	const FOnlineSession& Session = Result.Session;
+	if (Context.bRequireBuildMatch && Session.SessionSettings.BuildUniqueId != Context.BuildUniqueId)
+	{
+		return false;
+	}
+
+	const int32 MaxConnections = Session.SessionSettings.NumPublicConnections;
+	const int32 OpenConnections = Session.NumOpenPublicConnections;
+	if (OpenConnections < Context.RequiredConnections)
+	{
+		return false;
+	}
+
+	// a measured round trip beats whatever the backend reports, which is often nothing for internet sessions
+	int32 PingInMs = Result.PingInMs;
+	if (!Context.MeasuredPingsMs.IsEmpty())
+	{
+		if (const int32* MeasuredPing = Context.MeasuredPingsMs.Find(Result.GetSessionIdStr()))
+		{
+			PingInMs = *MeasuredPing;
+		}
+	}
+
+	const FCustomSessionRankingWeights& Weights = Context.Weights;
+	const bool bPingKnown = PingInMs >= 0 && PingInMs < MAX_QUERY_PING;
+	if (bPingKnown && Weights.MaxAcceptablePingMs > 0 && PingInMs > Weights.MaxAcceptablePingMs)
+	{
+		return false;
+	}
+
+	// without a limit pings still rank, on the scale of the highest one a backend can report
+	const int32 PingScaleMs = Weights.MaxAcceptablePingMs > 0 ? Weights.MaxAcceptablePingMs : MAX_QUERY_PING;
+	const float PingTerm = bPingKnown
+		? 1.0f - FMath::Clamp(static_cast<float>(PingInMs) / PingScaleMs, 0.0f, 1.0f)
+		: 0.0f;
+	const float FreeTerm = Weights.FreeConnectionsSaturation > 0
+		? FMath::Clamp(static_cast<float>(OpenConnections - Context.RequiredConnections) / Weights.FreeConnectionsSaturation, 0.0f, 1.0f)
+		: 0.0f;
+	const float FillTerm = MaxConnections > 0 ? 1.0f - static_cast<float>(OpenConnections) / MaxConnections : 0.0f;
+	const float BuildTerm = Session.SessionSettings.BuildUniqueId == Context.BuildUniqueId ? 1.0f : 0.0f;
+
+	float RegionTerm = 0.0f;
+	if (!Context.Region.IsEmpty())
+	{
+		FString Region;
+		if (Session.SessionSettings.Get(CustomSessionsApi::RegionKey, Region) && Region.Equals(Context.Region))
+		{
+			RegionTerm = 1.0f;
+		}
+	}
+
+	OutScore = Weights.Ping * PingTerm
+			 + Weights.FreeConnections * FreeTerm
+			 + Weights.FillRatio * FillTerm
+			 + Weights.BuildMatch * BuildTerm
+			 + Weights.RegionMatch * RegionTerm;
+
+	if (Context.ScoreDelegate.IsBound())
+	{
+		OutScore += Context.ScoreDelegate.Execute(Result);
+	}
+
+	return true;
+}
+
+void FCustomSessionRanking::Rank(const TArray<FOnlineSessionSearchResult>& Results, const FCustomSessionRankingContext& Context,
+								 TArray<FCustomSessionRankedResult>& OutRanked)
+{
+	OutRanked.Reset(Results.Num());
+	for (int32 Index = 0; Index < Results.Num(); ++Index)
+	{
+		float ResultScore = 0.0f;
+		if (Score(Results[Index], Context, ResultScore))
+		{
+			OutRanked.Add({Index, ResultScore});
+		}
+	}
+
+	OutRanked.Sort([](const FCustomSessionRankedResult& A, const FCustomSessionRankedResult& B)
+	{
+		return A.Score != B.Score ? A.Score > B.Score : A.Index < B.Index;
+	});
+}
@@ -0,0 +1,242 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionReservation.h"
+
+#include "CustomSessionProbeProtocol.h"
+#include "Common/UdpSocketBuilder.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+
+ECustomSessionReservationResult FCustomSessionSlotReservations::Reserve(const FGuid& Token, int32 NumSlots, int32 FreeSlots, float Lifetime)
+{
+	RemoveExpired();
+
+	const double ExpiryTime = FPlatformTime::Seconds() + Lifetime;
+	if (FReservation* Existing = Reservations.Find(Token))
+	{
+		if (Existing->NumSlots >= NumSlots)
+		{
+			Existing->ExpiryTime = ExpiryTime;
+
+			return ECustomSessionReservationResult::Granted;
+		}
+	}
+
+	int32 OtherReservedSlots = 0;
+	for (const TPair<FGuid, FReservation>& Reservation : Reservations)
+	{
+		if (Reservation.Key != Token)
+		{
+			OtherReservedSlots += Reservation.Value.NumSlots;
+		}
+	}
+
+	if (NumSlots > FreeSlots - OtherReservedSlots)
+	{
+		return ECustomSessionReservationResult::Full;
+	}
+
+	Reservations.Add(Token, FReservation{NumSlots, ExpiryTime});
+
+	return ECustomSessionReservationResult::Granted;
+}
+
+bool FCustomSessionSlotReservations::IsReserved(const FGuid& Token)
+{
+	RemoveExpired();
+
+	return Token.IsValid() && Reservations.Contains(Token);
+}
+
+bool FCustomSessionSlotReservations::Consume(const FGuid& Token)
+{
+	RemoveExpired();
+
+	FReservation* Reservation = Token.IsValid() ? Reservations.Find(Token) : nullptr;
+	if (Reservation == nullptr)
+	{
+		return false;
+	}
+
+	if (--Reservation->NumSlots <= 0)
+	{
+		Reservations.Remove(Token);
+	}
+
+	return true;
+}
+
+void FCustomSessionSlotReservations::Release(const FGuid& Token)
+{
+	Reservations.Remove(Token);
+}
+
+int32 FCustomSessionSlotReservations::GetReservedSlots()
+{
+	RemoveExpired();
+
+	int32 ReservedSlots = 0;
+	for (const TPair<FGuid, FReservation>& Reservation : Reservations)
+	{
+		ReservedSlots += Reservation.Value.NumSlots;
+	}
+
+	return ReservedSlots;
+}
+
+void FCustomSessionSlotReservations::RemoveExpired()
+{
+	const double Now = FPlatformTime::Seconds();
+	for (auto It = Reservations.CreateIterator(); It; ++It)
+	{
+		if (It.Value().ExpiryTime <= Now)
+		{
+			It.RemoveCurrent();
+		}
+	}
+}
+
+FCustomSessionReservationClient::FCustomSessionReservationClient(float InTimeout, int32 InMaxRequests)
+	: Timeout(InTimeout)
+	, MaxRequests(FMath::Max(InMaxRequests, 1))
+{
+}
+
+FCustomSessionReservationClient::~FCustomSessionReservationClient()
+{
+	Cancel();
+	CustomSessionProbe::DestroySocket(Socket);
+}
+
+void FCustomSessionReservationClient::Reserve(const FIPv4Endpoint& Host, const FGuid& InToken, int32 InNumSlots, FCustomSessionReservationCompleted&& OnCompleted)
+{
+	Cancel();
+
+	if (!EnsureSocket())
+	{
+		OnCompleted.ExecuteIfBound(ECustomSessionReservationResult::TimedOut);
+
+		return;
+	}
+
+	HostAddress = Host.ToInternetAddr();
+	Token = InToken;
+	NumSlots = static_cast<uint8>(FMath::Clamp(InNumSlots, 1, MAX_uint8));
+	++Sequence;
+	NumRequests = 0;
+	StartTime = FPlatformTime::Seconds();
+	OnReservationCompleted = MoveTemp(OnCompleted);
+
+	SendRequest();
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateRaw(this, &FCustomSessionReservationClient::Tick));
+}
+
+void FCustomSessionReservationClient::Release(const FIPv4Endpoint& Host, const FGuid& InToken)
+{
+	if (!EnsureSocket())
+	{
+		return;
+	}
+
+	uint8 Data[CustomSessionProbe::ReservationSize];
+	CustomSessionProbe::WriteHeader(Data, {CustomSessionProbe::EMessage::Release, 0, 0, 0});
+	CustomSessionProbe::WriteToken(Data, InToken);
+
+	int32 BytesSent = 0;
+	Socket->SendTo(Data, sizeof(Data), BytesSent, *Host.ToInternetAddr());
+}
+
+void FCustomSessionReservationClient::Cancel()
+{
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+
+	OnReservationCompleted.Unbind();
+}
+
+bool FCustomSessionReservationClient::Tick(float DeltaTime)
+{
+	uint8 Data[CustomSessionProbe::MaxPacketSize];
+	uint32 PendingSize = 0;
+	while (Socket->HasPendingData(PendingSize))
+	{
+		int32 BytesRead = 0;
+		if (!Socket->RecvFrom(Data, sizeof(Data), BytesRead, *Sender))
+		{
+			break;
+		}
+
+		// answers to an earlier request, e.g. to the previous candidate, are ignored
+		CustomSessionProbe::FHeader Header;
+		if (!CustomSessionProbe::ReadHeader(Data, BytesRead, Header) || Header.Message != CustomSessionProbe::EMessage::Reserved
+			|| Header.Sequence != Sequence || CustomSessionProbe::ReadToken(Data) != Token)
+		{
+			continue;
+		}
+
+		const ECustomSessionReservationResult Result = Header.Value <= static_cast<uint8>(ECustomSessionReservationResult::Unavailable)
+			? static_cast<ECustomSessionReservationResult>(Header.Value)
+			: ECustomSessionReservationResult::Unavailable;
+
+		TickerHandle.Reset();
+		const FCustomSessionReservationCompleted Completed = MoveTemp(OnReservationCompleted);
+		OnReservationCompleted.Unbind();
+		Completed.ExecuteIfBound(Result);
+
+		return false;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now - StartTime >= Timeout)
+	{
+		TickerHandle.Reset();
+		const FCustomSessionReservationCompleted Completed = MoveTemp(OnReservationCompleted);
+		OnReservationCompleted.Unbind();
+		Completed.ExecuteIfBound(ECustomSessionReservationResult::TimedOut);
+
+		return false;
+	}
+
+	if (Now >= NextRequestTime && NumRequests < MaxRequests)
+	{
+		SendRequest();
+	}
+
+	return true;
+}
+
+void FCustomSessionReservationClient::SendRequest()
+{
+	uint8 Data[CustomSessionProbe::ReservationSize];
+	CustomSessionProbe::WriteHeader(Data, {CustomSessionProbe::EMessage::Reserve, NumSlots, 0, Sequence});
+	CustomSessionProbe::WriteToken(Data, Token);
+
+	int32 BytesSent = 0;
+	Socket->SendTo(Data, sizeof(Data), BytesSent, *HostAddress);
+
+	// resent evenly over the timeout, a lost datagram costs a fraction of it instead of the whole join
+	++NumRequests;
+	NextRequestTime = FPlatformTime::Seconds() + Timeout / MaxRequests;
+}
+
+bool FCustomSessionReservationClient::EnsureSocket()
+{
+	if (Socket != nullptr)
+	{
+		return true;
+	}
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	if (SocketSubsystem == nullptr)
+	{
+		return false;
+	}
+
+	Socket = FUdpSocketBuilder(TEXT("CustomSessionsReservation")).AsNonBlocking().Build();
+	Sender = SocketSubsystem->CreateInternetAddr();
+
+	return Socket != nullptr;
+}
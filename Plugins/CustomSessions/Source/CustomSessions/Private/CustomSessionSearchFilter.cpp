@@ -0,0 +1,111 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionSearchFilter.h"
+
+namespace CustomSessionSearchFilter
+{
+	bool ToNumber(const FVariantData& Data, double& OutNumber)
+	{
+		switch (Data.GetType())
+		{
+			case EOnlineKeyValuePairDataType::Int32:
+			{
+				int32 Value = 0;
+				Data.GetValue(Value);
+				OutNumber = Value;
+			}
+			return true;
+
+			case EOnlineKeyValuePairDataType::UInt32:
+			{
+				uint32 Value = 0;
+				Data.GetValue(Value);
+				OutNumber = Value;
+			}
+			return true;
+
+			case EOnlineKeyValuePairDataType::Int64:
+			{
+				int64 Value = 0;
+				Data.GetValue(Value);
+				OutNumber = static_cast<double>(Value);
+			}
+			return true;
+
+			case EOnlineKeyValuePairDataType::UInt64:
+			{
+				uint64 Value = 0;
+				Data.GetValue(Value);
+				OutNumber = static_cast<double>(Value);
+			}
+			return true;
+
+			case EOnlineKeyValuePairDataType::Float:
+			{
+				float Value = 0.0f;
+				Data.GetValue(Value);
+				OutNumber = Value;
+			}
+			return true;
+
+			case EOnlineKeyValuePairDataType::Double:
+			{
+				Data.GetValue(OutNumber);
+			}
+			return true;
+
+			default:
+			return false;
+		}
+	}
+
+	/** Returns <0, 0 or >0 comparing Lhs with Rhs, numerically when both are numbers */
+	int32 Compare(const FVariantData& Lhs, const FVariantData& Rhs)
+	{
+		double LhsNumber = 0.0, RhsNumber = 0.0;
+		if (ToNumber(Lhs, LhsNumber) && ToNumber(Rhs, RhsNumber))
+		{
+			return LhsNumber < RhsNumber ? -1 : (LhsNumber > RhsNumber ? 1 : 0);
+		}
+
+		return Lhs.ToString().Compare(Rhs.ToString());
+	}
+
+	/** In and NotIn take their values as a comma separated list */
+	bool IsInList(const FVariantData& Data, const FVariantData& List)
+	{
+		TArray<FString> Values;
+		List.ToString().ParseIntoArray(Values, TEXT(","));
+		const FString Value = Data.ToString();
+
+		return Values.ContainsByPredicate([&Value](const FString& Candidate) { return Candidate.TrimStartAndEnd().Equals(Value); });
+	}
+}
+
+bool FCustomSessionSearchFilter::Matches(const FOnlineSessionSettings& Settings) const
+{
+	const FOnlineSessionSetting* Setting = Settings.Settings.Find(Key);
+	if (Setting == nullptr)
+	{
+		return ComparisonOp == EOnlineComparisonOp::NotEquals || ComparisonOp == EOnlineComparisonOp::NotIn;
+	}
+
+	switch (ComparisonOp)
+	{
+		case EOnlineComparisonOp::Equals:				return Setting->Data == Value;
+		case EOnlineComparisonOp::NotEquals:			return Setting->Data != Value;
+		case EOnlineComparisonOp::GreaterThan:			return CustomSessionSearchFilter::Compare(Setting->Data, Value) > 0;
+		case EOnlineComparisonOp::GreaterThanEquals:	return CustomSessionSearchFilter::Compare(Setting->Data, Value) >= 0;
+		case EOnlineComparisonOp::LessThan:				return CustomSessionSearchFilter::Compare(Setting->Data, Value) < 0;
+		case EOnlineComparisonOp::LessThanEquals:		return CustomSessionSearchFilter::Compare(Setting->Data, Value) <= 0;
+		case EOnlineComparisonOp::In:					return CustomSessionSearchFilter::IsInList(Setting->Data, Value);
+		case EOnlineComparisonOp::NotIn:				return !CustomSessionSearchFilter::IsInList(Setting->Data, Value);
+		// Near is a ranking hint for the backends that support it, never a reason to discard locally
+		default:										return true;
+	}
+}
+
+FString FCustomSessionSearchFilter::ToString() const
+{
+	return FString::Printf(TEXT("%s %s %s"), *Key.ToString(), EOnlineComparisonOp::ToString(ComparisonOp), *Value.ToString());
+}
@@ -0,0 +1,10 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionSearchSnapshot.h"
+
+const FCustomSessionSearchSnapshotRef& FCustomSessionSearchSnapshot::Empty()
+{
+	static const FCustomSessionSearchSnapshotRef EmptySnapshot = MakeShared<const FCustomSessionSearchSnapshot, ESPMode::ThreadSafe>();
+
+	return EmptySnapshot;
+}
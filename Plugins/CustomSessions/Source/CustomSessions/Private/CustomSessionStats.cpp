@@ -0,0 +1,294 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionStats.h"
+
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionSubsystem.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "HAL/IConsoleManager.h"
+#include "ProfilingDebugging/MiscTrace.h"
+#include "Stats/Stats.h"
+
+DECLARE_STATS_GROUP(TEXT("CustomSessions"), STATGROUP_CustomSessions, STATCAT_Advanced);
+
+/** Accumulators keep their value between frames, what `stat CustomSessions` shows is always the running total */
+#define CUSTOMSESSIONS_DECLARE_OPERATION_STATS(Operation) \
+	DECLARE_DWORD_ACCUMULATOR_STAT(TEXT(#Operation " count"), STAT_CustomSessions_##Operation##_Count, STATGROUP_CustomSessions); \
+	DECLARE_DWORD_ACCUMULATOR_STAT(TEXT(#Operation " failures"), STAT_CustomSessions_##Operation##_Failures, STATGROUP_CustomSessions); \
+	DECLARE_DWORD_ACCUMULATOR_STAT(TEXT(#Operation " time outs"), STAT_CustomSessions_##Operation##_TimeOuts, STATGROUP_CustomSessions); \
+	DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT(#Operation " p50 (ms)"), STAT_CustomSessions_##Operation##_P50, STATGROUP_CustomSessions); \
+	DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT(#Operation " p95 (ms)"), STAT_CustomSessions_##Operation##_P95, STATGROUP_CustomSessions); \
+	DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT(#Operation " p99 (ms)"), STAT_CustomSessions_##Operation##_P99, STATGROUP_CustomSessions); \
+	static void PublishStats_##Operation(const FCustomSessionOperationStats& Stats) \
+	{ \
+		SET_DWORD_STAT(STAT_CustomSessions_##Operation##_Count, Stats.Count); \
+		SET_DWORD_STAT(STAT_CustomSessions_##Operation##_Failures, Stats.Failures); \
+		SET_DWORD_STAT(STAT_CustomSessions_##Operation##_TimeOuts, Stats.TimeOuts); \
+		SET_FLOAT_STAT(STAT_CustomSessions_##Operation##_P50, Stats.P50Ms); \
+		SET_FLOAT_STAT(STAT_CustomSessions_##Operation##_P95, Stats.P95Ms); \
+		SET_FLOAT_STAT(STAT_CustomSessions_##Operation##_P99, Stats.P99Ms); \
+	}
+
+CUSTOMSESSIONS_DECLARE_OPERATION_STATS(Create)
+CUSTOMSESSIONS_DECLARE_OPERATION_STATS(Find)
+CUSTOMSESSIONS_DECLARE_OPERATION_STATS(Join)
+CUSTOMSESSIONS_DECLARE_OPERATION_STATS(Start)
+CUSTOMSESSIONS_DECLARE_OPERATION_STATS(End)
+CUSTOMSESSIONS_DECLARE_OPERATION_STATS(Destroy)
+CUSTOMSESSIONS_DECLARE_OPERATION_STATS(Resolve)
+CUSTOMSESSIONS_DECLARE_OPERATION_STATS(Update)
+
+#undef CUSTOMSESSIONS_DECLARE_OPERATION_STATS
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Find results (last)"), STAT_CustomSessions_Find_LastResults, STATGROUP_CustomSessions);
+
+namespace CustomSessionStats
+{
+	/** Growth between bucket bounds, bucket 0 holds everything under 1ms */
+	constexpr double BucketGrowth = 1.25;
+
+	void Publish(ECustomSessionOperation Operation, const FCustomSessionOperationStats& Stats)
+	{
+		switch (Operation)
+		{
+			case ECustomSessionOperation::Create: PublishStats_Create(Stats); break;
+			case ECustomSessionOperation::Find:
+			{
+				PublishStats_Find(Stats);
+				SET_DWORD_STAT(STAT_CustomSessions_Find_LastResults, Stats.LastResults);
+			}
+			break;
+			case ECustomSessionOperation::Join: PublishStats_Join(Stats); break;
+			case ECustomSessionOperation::Start: PublishStats_Start(Stats); break;
+			case ECustomSessionOperation::End: PublishStats_End(Stats); break;
+			case ECustomSessionOperation::Destroy: PublishStats_Destroy(Stats); break;
+			case ECustomSessionOperation::Resolve: PublishStats_Resolve(Stats); break;
+			case ECustomSessionOperation::Update: PublishStats_Update(Stats); break;
+			default: break;
+		}
+	}
+
+	FAutoConsoleCommandWithWorldAndArgs StatsCommand(
+		TEXT("CustomSessions.Stats"),
+		TEXT("Prints count, failures and p50/p95/p99 latency of every session operation. Args: Reset"),
+		FConsoleCommandWithWorldAndArgsDelegate::CreateLambda([](const TArray<FString>& Args, UWorld* World)
+		{
+			const UGameInstance* GameInstance = IsValid(World) ? World->GetGameInstance() : nullptr;
+			UCustomSessionSubsystem* Subsystem = GameInstance != nullptr ? GameInstance->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+			if (!IsValid(Subsystem))
+			{
+				UE_LOG(LogCustomSessions, Error, TEXT("No session subsystem to print the stats of"));
+
+				return;
+			}
+
+			if (Args.Num() > 0 && Args[0].Equals(TEXT("Reset"), ESearchCase::IgnoreCase))
+			{
+				Subsystem->ResetOperationStats();
+				UE_LOG(LogCustomSessions, Display, TEXT("Custom session stats reset"));
+
+				return;
+			}
+
+			UE_LOG(LogCustomSessions, Display, TEXT("%-8s %7s %8s %8s %9s %9s %9s %9s %9s %9s"),
+				TEXT("Op"), TEXT("Count"), TEXT("Failures"), TEXT("TimeOuts"), TEXT("Last"), TEXT("Mean"), TEXT("p50"), TEXT("p95"), TEXT("p99"), TEXT("Max"));
+
+			const UEnum* OperationEnum = StaticEnum<ECustomSessionOperation>();
+			for (int32 Index = 0; Index < OperationEnum->NumEnums() - 1; ++Index)
+			{
+				const ECustomSessionOperation Operation = static_cast<ECustomSessionOperation>(OperationEnum->GetValueByIndex(Index));
+				const FCustomSessionOperationStats Stats = Subsystem->GetOperationStats(Operation);
+				UE_LOG(LogCustomSessions, Display, TEXT("%-8s %7d %8d %8d %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f"),
+					*OperationEnum->GetNameStringByIndex(Index), Stats.Count, Stats.Failures, Stats.TimeOuts,
+					Stats.LastMs, Stats.MeanMs, Stats.P50Ms, Stats.P95Ms, Stats.P99Ms, Stats.MaxMs);
+			}
+		}));
+}
+
+FCustomSessionLatencyHistogram::FCustomSessionLatencyHistogram()
+{
+	Reset();
+}
+
+void FCustomSessionLatencyHistogram::Add(double LatencyMs)
+{
+	LatencyMs = FMath::Max(LatencyMs, 0.0);
+	++Buckets[GetBucket(LatencyMs)];
+	Min = Count > 0 ? FMath::Min(Min, LatencyMs) : LatencyMs;
+	Max = Count > 0 ? FMath::Max(Max, LatencyMs) : LatencyMs;
+	Sum += LatencyMs;
+	++Count;
+}
+
+void FCustomSessionLatencyHistogram::Reset()
+{
+	for (uint32& Bucket : Buckets)
+	{
+		Bucket = 0;
+	}
+
+	Count = 0;
+	Sum = 0.0;
+	Min = 0.0;
+	Max = 0.0;
+}
+
+double FCustomSessionLatencyHistogram::GetPercentile(double Percentile) const
+{
+	if (Count == 0)
+	{
+		return 0.0;
+	}
+
+	const double Rank = FMath::Clamp(Percentile, 0.0, 1.0) * Count;
+	int64 Accumulated = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		if (Buckets[Bucket] == 0 || Accumulated + Buckets[Bucket] < Rank)
+		{
+			Accumulated += Buckets[Bucket];
+			continue;
+		}
+
+		const double LowerBound = GetBucketLowerBound(Bucket);
+		const double UpperBound = Bucket + 1 < NumBuckets ? GetBucketLowerBound(Bucket + 1) : Max;
+		const double Alpha = (Rank - Accumulated) / Buckets[Bucket];
+
+		return FMath::Clamp(FMath::Lerp(LowerBound, UpperBound, Alpha), Min, Max);
+	}
+
+	return Max;
+}
+
+int32 FCustomSessionLatencyHistogram::GetBucket(double LatencyMs)
+{
+	if (LatencyMs < 1.0)
+	{
+		return 0;
+	}
+
+	const int32 Bucket = 1 + FMath::FloorToInt32(FMath::Loge(LatencyMs) / FMath::Loge(CustomSessionStats::BucketGrowth));
+
+	return FMath::Min(Bucket, NumBuckets - 1);
+}
+
+double FCustomSessionLatencyHistogram::GetBucketLowerBound(int32 Bucket)
+{
+	return Bucket == 0 ? 0.0 : FMath::Pow(CustomSessionStats::BucketGrowth, static_cast<double>(Bucket - 1));
+}
+
+void FCustomSessionOperationRecorder::Begin(ECustomSessionOperation Operation, FName SessionName)
+{
+	if (IsRunning(SessionName))
+	{
+		TRACE_END_REGION(*GetTraceRegionName(Operation, SessionName));
+	}
+
+	StartTimes.Add(SessionName, FPlatformTime::Seconds());
+	TRACE_BEGIN_REGION(*GetTraceRegionName(Operation, SessionName));
+}
+
+bool FCustomSessionOperationRecorder::End(ECustomSessionOperation Operation, bool bWasSuccessful, int32 NumResults, FName SessionName)
+{
+	double StartTime = 0.0;
+	if (!StartTimes.RemoveAndCopyValue(SessionName, StartTime))
+	{
+		return false;
+	}
+
+	TRACE_END_REGION(*GetTraceRegionName(Operation, SessionName));
+
+	LastMs = (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	Latency.Add(LastMs);
+	if (!bWasSuccessful)
+	{
+		++Failures;
+	}
+
+	if (NumResults != INDEX_NONE)
+	{
+		LastResults = NumResults;
+		TotalResults += NumResults;
+	}
+
+	CustomSessionStats::Publish(Operation, ToStats());
+
+	return true;
+}
+
+bool FCustomSessionOperationRecorder::TimedOut(ECustomSessionOperation Operation, FName SessionName)
+{
+	if (!IsRunning(SessionName))
+	{
+		return false;
+	}
+
+	++TimeOuts;
+
+	return End(Operation, false, INDEX_NONE, SessionName);
+}
+
+void FCustomSessionOperationRecorder::Cancel(ECustomSessionOperation Operation, FName SessionName)
+{
+	if (StartTimes.Remove(SessionName) == 0)
+	{
+		return;
+	}
+
+	TRACE_END_REGION(*GetTraceRegionName(Operation, SessionName));
+}
+
+FCustomSessionOperationStats FCustomSessionOperationRecorder::ToStats() const
+{
+	FCustomSessionOperationStats Stats;
+	Stats.Count = static_cast<int32>(Latency.GetCount());
+	Stats.Failures = Failures;
+	Stats.TimeOuts = TimeOuts;
+	Stats.LastMs = static_cast<float>(LastMs);
+	Stats.MinMs = static_cast<float>(Latency.GetMin());
+	Stats.MeanMs = static_cast<float>(Latency.GetMean());
+	Stats.P50Ms = static_cast<float>(Latency.GetPercentile(0.50));
+	Stats.P95Ms = static_cast<float>(Latency.GetPercentile(0.95));
+	Stats.P99Ms = static_cast<float>(Latency.GetPercentile(0.99));
+	Stats.MaxMs = static_cast<float>(Latency.GetMax());
+	Stats.LastResults = LastResults;
+	Stats.TotalResults = TotalResults;
+
+	return Stats;
+}
+
+void FCustomSessionOperationRecorder::Reset()
+{
+	// a running operation keeps being timed, it is recorded when it completes
+	Failures = 0;
+	TimeOuts = 0;
+	LastResults = 0;
+	TotalResults = 0;
+	LastMs = 0.0;
+	Latency.Reset();
+}
+
+const TCHAR* FCustomSessionOperationRecorder::GetTraceRegionName(ECustomSessionOperation Operation)
+{
+	switch (Operation)
+	{
+		case ECustomSessionOperation::Create: return TEXT("CustomSessions.CreateSession");
+		case ECustomSessionOperation::Find: return TEXT("CustomSessions.FindSessions");
+		case ECustomSessionOperation::Join: return TEXT("CustomSessions.JoinSession");
+		case ECustomSessionOperation::Start: return TEXT("CustomSessions.StartSession");
+		case ECustomSessionOperation::End: return TEXT("CustomSessions.EndSession");
+		case ECustomSessionOperation::Destroy: return TEXT("CustomSessions.DestroySession");
+		case ECustomSessionOperation::Resolve: return TEXT("CustomSessions.GetResolvedConnectString");
+		case ECustomSessionOperation::Update: return TEXT("CustomSessions.UpdateSession");
+		default: return TEXT("CustomSessions.Operation");
+	}
+}
+
+FString FCustomSessionOperationRecorder::GetTraceRegionName(ECustomSessionOperation Operation, FName SessionName)
+{
+	// regions are matched by name, concurrent ones on different sessions need names of their own
+	return SessionName == NAME_None
+		? FString(GetTraceRegionName(Operation))
+		: FString::Printf(TEXT("%s %s"), GetTraceRegionName(Operation), *SessionName.ToString());
+}
@@ -2,312 +2,2872 @@
 
 #include "CustomSessionSubsystem.h"
 
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionLatencyProbe.h"
+#include "CustomSessionReservation.h"
+#include "CustomSessionMockSession.h"
 #include "OnlineSessionSettings.h"
 #include "OnlineSubsystem.h"
+#include "TimerManager.h"
+#include "Engine/GameInstance.h"
+#include "GameMapsSettings.h"
+#include "Misc/PackageName.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
 
-void UCustomSessionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+namespace
 {
-	Super::Initialize(Collection);
-	if (const IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get())
+	/** Taken out of the array before resolving, continuations may add waiters of their own */
+	template <typename ResultType>
+	void ResolveWaiters(TArray<TCustomSessionWaiter<ResultType>>& Waiters, ECustomSessionOperation Operation, const FString& Key, const ResultType& Result)
 	{
-		OnlineSession = OnlineSubsystem->GetSessionInterface();
-		if (GEngine)
+		TArray<TCustomSessionWaiter<ResultType>, TInlineAllocator<4>> Resolved;
+		for (int32 Index = 0; Index < Waiters.Num();)
+		{
+			if (Waiters[Index].Operation == Operation && Waiters[Index].Key == Key)
+			{
+				Resolved.Add(MoveTemp(Waiters[Index]));
+				Waiters.RemoveAt(Index, 1, false);
+
+				continue;
+			}
+
+			++Index;
+		}
+
+		for (TCustomSessionWaiter<ResultType>& Waiter : Resolved)
+		{
+			Waiter.Promise.SetValue(Result);
+		}
+	}
+
+	template <typename ResultType>
+	void ResolveRequestWaiter(TArray<TCustomSessionWaiter<ResultType>>& Waiters, uint32 RequestId, const ResultType& Result)
+	{
+		if (RequestId == 0)
+		{
+			return;
+		}
+
+		const int32 Index = Waiters.IndexOfByPredicate([RequestId](const TCustomSessionWaiter<ResultType>& Waiter) { return Waiter.RequestId == RequestId; });
+		if (Index == INDEX_NONE)
+		{
+			return;
+		}
+
+		TPromise<ResultType> Promise = MoveTemp(Waiters[Index].Promise);
+		Waiters.RemoveAt(Index, 1, false);
+		Promise.SetValue(Result);
+	}
+
+	template <typename ResultType>
+	void ResolveAllWaiters(TArray<TCustomSessionWaiter<ResultType>>& Waiters, const ResultType& Result)
+	{
+		TArray<TCustomSessionWaiter<ResultType>> Resolved = MoveTemp(Waiters);
+		for (TCustomSessionWaiter<ResultType>& Waiter : Resolved)
 		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Cyan, 
-				FString::Printf(TEXT("Found subsystem: %s"), *OnlineSubsystem->GetSubsystemName().ToString()));
+			Waiter.Promise.SetValue(Result);
 		}
+	}
 
-		OnCreateSessionCompleteDelegate.BindUObject(this, &ThisClass::CreateSessionCompleted);
-		OnFindSessionsCompleteDelegate.BindUObject(this, &ThisClass::FindSessionCompleted);
-		OnJoinSessionCompleteDelegate.BindUObject(this, &ThisClass::JoinSessionCompleted);
-		OnStartSessionCompleteDelegate.BindUObject(this, &ThisClass::StartSessionCompleted);
-		OnDestroySessionCompleteDelegate.BindUObject(this, &ThisClass::DestroySessionCompleted);
+	template <typename ResultType>
+	TFuture<ResultType> AddWaiter(TArray<TCustomSessionWaiter<ResultType>>& Waiters, ECustomSessionOperation Operation, const FString& Key, uint32 RequestId = 0)
+	{
+		TCustomSessionWaiter<ResultType>& Waiter = Waiters.AddDefaulted_GetRef();
+		Waiter.Operation = Operation;
+		Waiter.Key = Key;
+		Waiter.RequestId = RequestId;
+
+		return Waiter.Promise.GetFuture();
 	}
 }
 
-void UCustomSessionSubsystem::Deinitialize()
+void UCustomSessionSubsystem::Initialize(FSubsystemCollectionBase& Collection)
 {
-	DestroySession();
-	Super::Deinitialize();
+	Super::Initialize(Collection);
+	OnCreateSessionCompleteDelegate.BindUObject(this, &ThisClass::CreateSessionCompleted);
+	OnFindSessionsCompleteDelegate.BindUObject(this, &ThisClass::FindSessionCompleted);
+	OnJoinSessionCompleteDelegate.BindUObject(this, &ThisClass::JoinSessionCompleted);
+	OnStartSessionCompleteDelegate.BindUObject(this, &ThisClass::StartSessionCompleted);
+	OnEndSessionCompleteDelegate.BindUObject(this, &ThisClass::EndSessionCompleted);
+	OnDestroySessionCompleteDelegate.BindUObject(this, &ThisClass::DestroySessionCompleted);
+	OnUpdateSessionCompleteDelegate.BindUObject(this, &ThisClass::UpdateSessionCompleted);
+
+	const FCustomSessionMockSettings MockSettings = FCustomSessionMockSettings::LoadFromConfig();
+	if (MockSettings.bEnabled)
+	{
+		UseMockBackend(MockSettings);
+
+		return;
+	}
+
+	if (const IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get())
+	{
+		OnlineSession = OnlineSubsystem->GetSessionInterface();
+		BindBackendDelegates();
+		CUSTOMSESSION_EVENT(Session, Display, "SubsystemFound", {TEXT("Subsystem"), OnlineSubsystem->GetSubsystemName()});
+	}
 }
 
-void UCustomSessionSubsystem::CreateSession(FName SessionName, int32 NumPublicConnections, const FString& MatchType)
+void UCustomSessionSubsystem::BindBackendDelegates()
 {
 	if (!OnlineSession.IsValid())
 	{
-		UE_LOG(LogOnlineSession, Error, TEXT("Can't create a session without a valid OSS"));
-		OnCustomSessionCreateSessionCompleted.Broadcast(false);
+		return;
+	}
+
+	CreateSessionCompleteDelegate_Handle = OnlineSession->AddOnCreateSessionCompleteDelegate_Handle(OnCreateSessionCompleteDelegate);
+	StartSessionCompleteDelegate_Handle = OnlineSession->AddOnStartSessionCompleteDelegate_Handle(OnStartSessionCompleteDelegate);
+	EndSessionCompleteDelegate_Handle = OnlineSession->AddOnEndSessionCompleteDelegate_Handle(OnEndSessionCompleteDelegate);
+	DestroySessionCompleteDelegate_Handle = OnlineSession->AddOnDestroySessionCompleteDelegate_Handle(OnDestroySessionCompleteDelegate);
+	UpdateSessionCompleteDelegate_Handle = OnlineSession->AddOnUpdateSessionCompleteDelegate_Handle(OnUpdateSessionCompleteDelegate);
+}
 
+void UCustomSessionSubsystem::UnbindBackendDelegates()
+{
+	if (!OnlineSession.IsValid())
+	{
 		return;
 	}
 
-	if (CreateSessionCompleteDelegate_Handle.IsValid())
+	OnlineSession->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate_Handle);
+	OnlineSession->ClearOnStartSessionCompleteDelegate_Handle(StartSessionCompleteDelegate_Handle);
+	OnlineSession->ClearOnEndSessionCompleteDelegate_Handle(EndSessionCompleteDelegate_Handle);
+	OnlineSession->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate_Handle);
+	OnlineSession->ClearOnUpdateSessionCompleteDelegate_Handle(UpdateSessionCompleteDelegate_Handle);
+	OnlineSession->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate_Handle);
+	OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate_Handle);
+	for (TPair<FName, FCustomSessionAbandonedJoin>& Abandoned : AbandonedJoins)
 	{
-		OnCustomSessionCreateSessionCompleted.Broadcast(false);
+		OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(Abandoned.Value.JoinSessionCompleteHandle);
+		if (const UGameInstance* GameInstance = GetGameInstance())
+		{
+			GameInstance->GetTimerManager().ClearTimer(Abandoned.Value.GracePeriodTimerHandle);
+		}
+	}
 
-		return;
+	AbandonedJoins.Reset();
+}
+
+void UCustomSessionSubsystem::Deinitialize()
+{
+	if (QuickMatchTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(QuickMatchTickerHandle);
+		QuickMatchTickerHandle.Reset();
 	}
 
-	const UWorld* World = GetWorld();
-	if (!IsValid(World))
+	// the futures failed below must not move a quick match on to hosting
+	bQuickMatchInProgress = false;
+	bQuickMatchSearching = false;
+
+	if (SearchProgressTickerHandle.IsValid())
 	{
-		OnCustomSessionCreateSessionCompleted.Broadcast(false);
+		FTSTicker::GetCoreTicker().RemoveTicker(SearchProgressTickerHandle);
+		SearchProgressTickerHandle.Reset();
+	}
 
-		return;
+	if (PostLoadMapDelegateHandle.IsValid())
+	{
+		FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapDelegateHandle);
+		PostLoadMapDelegateHandle.Reset();
 	}
 
-	const ULocalPlayer* LocalPlayer = World->GetFirstLocalPlayerFromController();
-	if (!IsValid(LocalPlayer))
+	PreloadedMaps.Reset();
+	PreloadingMaps.Reset();
+	PendingOperations.Reset();
+	LatencyProbe.Reset();
+	ProbeResponder.Reset();
+	ReservationClient.Reset();
+	ReserveSlotsHandler.Unbind();
+	ReleaseSlotsHandler.Unbind();
+
+	// nothing completes past this point, whoever still waits is told it failed
+	ResolveAllWaiters(OperationWaiters, false);
+	ResolveAllWaiters(SearchWaiters, FCustomSessionFindResult());
+	ResolveAllWaiters(JoinWaiters, FCustomSessionJoinResult());
+
+	// nobody is left to hear about it, the backend is only told to let go of every session
+	UnbindBackendDelegates();
+	if (OnlineSession.IsValid())
 	{
-		OnCustomSessionCreateSessionCompleted.Broadcast(false);
+		for (const TPair<FName, FCustomSessionNamedState>& Named : NamedSessions)
+		{
+			OnlineSession->DestroySession(Named.Key);
+		}
+	}
 
-		return;
+	NamedSessions.Reset();
+	WarmSessionName = NAME_None;
+
+	Super::Deinitialize();
+}
+
+TSharedPtr<FCustomSessionMockSession, ESPMode::ThreadSafe> UCustomSessionSubsystem::UseMockBackend(const FCustomSessionMockSettings& MockSettings)
+{
+	if (IsBusy())
+	{
+		return nullptr;
 	}
 
-	if (OnlineSession->GetNamedSession(SessionName) != nullptr)
+	// sessions on the previous backend are left to it, nothing we knew about them applies to the mock
+	const TSharedRef<FCustomSessionMockSession, ESPMode::ThreadSafe> MockSession = MakeShared<FCustomSessionMockSession, ESPMode::ThreadSafe>(MockSettings);
+	UnbindBackendDelegates();
+	OnlineSession = MockSession;
+	BindBackendDelegates();
+	bUsingMockBackend = true;
+	NamedSessions.Reset();
+	WarmSessionName = NAME_None;
+	LastSnapshot.Reset();
+	InvalidateSearchCache();
+	RefreshState();
+
+	UE_LOG(LogCustomSessions, Display, TEXT("Using the mock session backend with %d synthetic sessions"), MockSettings.NumSyntheticSessions);
+
+	return MockSession;
+}
+
+void UCustomSessionSubsystem::CreateSession(FName SessionName, int32 NumPublicConnections, const FString& MatchType)
+{
+	if (IsOperationBlocked(ECustomSessionOperation::Create, SessionName))
 	{
-		OnDestroySessionCompleteLambdaDelegate.Unbind();
-		OnDestroySessionCompleteLambdaDelegate.BindLambda(
-		[this, SessionName, NumPublicConnections, MatchType](FName OldSessionName, bool bWasSuccessful) -> void
+		EnqueueOperation(ECustomSessionOperation::Create, SessionName.ToString(), SessionName, [this, SessionName, NumPublicConnections, MatchType]()
 		{
 			CreateSession(SessionName, NumPublicConnections, MatchType);
 		});
 
-		DestroySessionCompleteDelegateLambda_Handle = OnlineSession->AddOnDestroySessionCompleteDelegate_Handle(OnDestroySessionCompleteLambdaDelegate);
-		DestroySession();
-
 		return;
 	}
 
-	SessionSettings = MakeShareable(new FOnlineSessionSettings());
-	SessionSettings->bIsLANMatch = IOnlineSubsystem::Get()->GetSubsystemName().IsEqual(NULL_SUBSYSTEM);
-	SessionSettings->NumPublicConnections = NumPublicConnections;
-	SessionSettings->bAllowJoinInProgress = true;
-	SessionSettings->bShouldAdvertise = true;
-	SessionSettings->bUseLobbiesIfAvailable = true;
-	SessionSettings->bAllowJoinViaPresence = true;
-	SessionSettings->bUsesPresence = true; // use world regions!
-	SessionSettings->Set(CustomSessionsApi::MatchTypeKey, MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
-	SessionSettings->BuildUniqueId = 1;
-	CreateSessionCompleteDelegate_Handle = OnlineSession->AddOnCreateSessionCompleteDelegate_Handle(OnCreateSessionCompleteDelegate);
-	if (!OnlineSession->CreateSession(*LocalPlayer->GetPreferredUniqueNetId(), SessionName, SessionSettings.ToSharedRef().Get()))
+	if (SessionName == WarmSessionName)
 	{
-		OnlineSession->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate_Handle);
-		OnCustomSessionCreateSessionCompleted.Broadcast(false);
+		PromoteWarmSession(NumPublicConnections, MatchType);
+
+		return;
 	}
+
+	ExecuteCreateSession(SessionName, NumPublicConnections, MatchType, false);
 }
 
-bool UCustomSessionSubsystem::FindSession(int32 MaxSearchResults, FName SessionName, const FString& MatchType)
+void UCustomSessionSubsystem::PrewarmHostSession()
 {
-	if (!OnlineSession.IsValid())
+	if (!bPrewarmHostSession)
 	{
-		UE_LOG(LogOnlineSession, Error, TEXT("Can't create a session without a valid OSS"));
-		FindSessionCompleted(false);
-
-		return false;
+		return;
 	}
 
-	if (FindSessionsCompleteDelegate_Handle.IsValid())
+	if (!PrewarmLobbyMap.IsEmpty())
 	{
-		FindSessionCompleted(false);
+		PreloadMap(PrewarmLobbyMap);
+	}
 
-		return false;
+	// a warm session only makes sense while we are not part of any other
+	if (!OnlineSession.IsValid() || IsBusy() || HasWarmSession() || bCreatingWarmSession || !NamedSessions.IsEmpty()
+		|| OnlineSession->GetNamedSession(PrewarmSessionName) != nullptr)
+	{
+		return;
 	}
 
 	const UWorld* World = GetWorld();
-	if (!IsValid(World))
+	if (!IsValid(World) || !IsValid(World->GetFirstLocalPlayerFromController()))
 	{
-		FindSessionCompleted(false);
-
-		return false;
+		return;
 	}
 
-	const ULocalPlayer* LocalPlayer = World->GetFirstLocalPlayerFromController();
-	if (!IsValid(LocalPlayer))
+	bCreatingWarmSession = true;
+	ExecuteCreateSession(PrewarmSessionName, 0, FString(), false);
+}
+
+void UCustomSessionSubsystem::PromoteWarmSession(int32 NumPublicConnections, const FString& MatchType)
+{
+	const FName SessionName = WarmSessionName;
+	WarmSessionName = NAME_None;
+	FCustomSessionNamedState* Named = NamedSessions.Find(SessionName);
+	if (!OnlineSession.IsValid() || Named == nullptr || !Named->Settings.IsValid() || OnlineSession->GetNamedSession(SessionName) == nullptr)
 	{
-		FindSessionCompleted(false);
+		ExecuteCreateSession(SessionName, NumPublicConnections, MatchType, false);
 
-		return false;
+		return;
 	}
 
 	CurrentGameSession = SessionName;
-	CurrentMatchType = MatchType;
+	SetSessionState(SessionName, ECustomSessionState::Creating);
+	BeginOperation(ECustomSessionOperation::Create, SessionName);
+	EnsureProbeResponder();
+	ApplyHostSettings(*Named->Settings, NumPublicConnections, MatchType);
 
-	SessionSearch = MakeShareable(new FOnlineSessionSearch());
-	SessionSearch->MaxSearchResults = MaxSearchResults;
-	SessionSearch->bIsLanQuery = IOnlineSubsystem::Get()->GetSubsystemName().IsEqual(NULL_SUBSYSTEM);
-	SessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
-	FindSessionsCompleteDelegate_Handle = OnlineSession->AddOnFindSessionsCompleteDelegate_Handle(OnFindSessionsCompleteDelegate);
-	if (!OnlineSession->FindSessions(*LocalPlayer->GetPreferredUniqueNetId(), SessionSearch.ToSharedRef()))
+	// copied, the backend may complete synchronously and the map reallocate under us
+	FOnlineSessionSettings UpdatedSettings = *Named->Settings;
+	if (!OnlineSession->UpdateSession(SessionName, UpdatedSettings, true))
 	{
-		FindSessionCompleted(false);
+		UpdateSessionCompleted(SessionName, false);
+	}
+}
 
+bool UCustomSessionSubsystem::ReleaseWarmSession()
+{
+	if (!HasWarmSession())
+	{
 		return false;
 	}
 
+	const FName SessionName = WarmSessionName;
+	WarmSessionName = NAME_None;
+	ExecuteDestroySession(SessionName);
+
 	return true;
 }
 
-void UCustomSessionSubsystem::JoinSession(const FOnlineSessionSearchResult& SearchResult)
+bool UCustomSessionSubsystem::PreloadMap(const FString& MapName)
 {
-	if (!OnlineSession.IsValid())
+	const FName PackageName = GetMapPackageName(MapName);
+	if (PackageName.IsNone())
 	{
-		return;
+		UE_LOG(LogCustomSessions, Warning, TEXT("Could not preload %s, it is not a long package name"), *MapName);
+
+		return false;
 	}
 
-	const UWorld* World = GetWorld();
-	if (!IsValid(World))
+	if (PreloadedMaps.Contains(PackageName) || PreloadingMaps.Contains(PackageName))
 	{
-		return;
+		return true;
+	}
+
+	if (!PostLoadMapDelegateHandle.IsValid())
+	{
+		PostLoadMapDelegateHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &ThisClass::PostLoadMapWithWorld);
 	}
 
-	const ULocalPlayer* LocalPlayer = World->GetFirstLocalPlayerFromController();
-	if (!IsValid(LocalPlayer))
+	PreloadingMaps.Add(PackageName);
+	LoadPackageAsync(PackageName.ToString(), FLoadPackageAsyncDelegate::CreateUObject(this, &ThisClass::MapPreloaded, FPlatformTime::Seconds()));
+
+	return true;
+}
+
+bool UCustomSessionSubsystem::IsMapPreloaded(const FString& MapName) const
+{
+	return PreloadedMaps.Contains(GetMapPackageName(MapName));
+}
+
+void UCustomSessionSubsystem::ReleasePreloadedMaps()
+{
+	// loads still in flight finish and are dropped
+	PreloadedMaps.Reset();
+	PreloadingMaps.Reset();
+}
+
+void UCustomSessionSubsystem::MapPreloaded(const FName& PackageName, UPackage* LoadedPackage, EAsyncLoadingResult::Type Result, double StartTime)
+{
+	if (PreloadingMaps.Remove(PackageName) == 0)
 	{
 		return;
 	}
 
-	const FString IdStr = SearchResult.GetSessionIdStr();
-	if (GEngine)
+	if (Result != EAsyncLoadingResult::Succeeded || !IsValid(LoadedPackage))
 	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Emerald,
-			FString::Printf(TEXT("Joining Session Id: %s..."), 
-			*IdStr));
+		UE_LOG(LogCustomSessions, Warning, TEXT("Could not preload the map %s"), *PackageName.ToString());
+
+		return;
 	}
 
-	JoinSessionCompleteDelegate_Handle = OnlineSession->AddOnJoinSessionCompleteDelegate_Handle(OnJoinSessionCompleteDelegate);
-	OnlineSession->JoinSession(*LocalPlayer->GetPreferredUniqueNetId(), CurrentGameSession, SearchResult);
+	PreloadedMaps.Add(PackageName, LoadedPackage);
+	CUSTOMSESSION_EVENT(Session, Log, "MapPreloaded", {TEXT("Map"), PackageName},
+		{TEXT("LoadMs"), (FPlatformTime::Seconds() - StartTime) * 1000.0});
 }
 
-void UCustomSessionSubsystem::StartSession()
+void UCustomSessionSubsystem::PostLoadMapWithWorld(UWorld* LoadedWorld)
 {
-}
+	const FName LoadedPackageName = IsValid(LoadedWorld) ? LoadedWorld->GetOutermost()->GetFName() : NAME_None;
+	const FName TransitionPackageName = GetMapPackageName(GetDefault<UGameMapsSettings>()->TransitionMap.GetLongPackageName());
 
-void UCustomSessionSubsystem::DestroySession()
-{
-	if (!OnlineSession.IsValid() || DestroySessionCompleteDelegate_Handle.IsValid())
+	// seamless travel stops at the transition map on its way to the map we preloaded
+	if (!LoadedPackageName.IsNone() && LoadedPackageName == TransitionPackageName)
 	{
-		OnDestroySessionCompleteLambdaDelegate.ExecuteIfBound(CurrentGameSession, false);
-		DestroySessionCompleted(CurrentGameSession, false);
 		return;
 	}
 
-	DestroySessionCompleteDelegate_Handle = OnlineSession->AddOnDestroySessionCompleteDelegate_Handle(OnDestroySessionCompleteDelegate);
-	if (!OnlineSession->DestroySession(CurrentGameSession))
+	// holding on to a world package after the travel would keep a whole world alive
+	PreloadedMaps.Reset();
+	PreloadingMaps.Reset();
+}
+
+FName UCustomSessionSubsystem::GetMapPackageName(const FString& MapName)
+{
+	FString PackageName;
+	MapName.Split(TEXT("?"), &PackageName, nullptr);
+	if (PackageName.IsEmpty())
 	{
-		OnDestroySessionCompleteLambdaDelegate.ExecuteIfBound(CurrentGameSession, false);
-		DestroySessionCompleted(CurrentGameSession, false);
+		PackageName = MapName;
 	}
+
+	PackageName = FPackageName::ObjectPathToPackageName(PackageName);
+
+	return FPackageName::IsValidLongPackageName(PackageName) ? FName(*PackageName) : NAME_None;
 }
 
-void UCustomSessionSubsystem::CreateSessionCompleted(FName SessionName, bool bWasSuccessful)
+void UCustomSessionSubsystem::ApplyHostSettings(FOnlineSessionSettings& Settings, int32 NumPublicConnections, const FString& MatchType) const
 {
-	if (OnlineSession)
+	const bool bIsDedicated = IsDedicatedServer();
+	Settings.bIsLANMatch = IsLanSubsystem();
+	Settings.bIsDedicated = bIsDedicated;
+	Settings.NumPublicConnections = NumPublicConnections;
+	Settings.bAllowJoinInProgress = true;
+	Settings.bShouldAdvertise = true;
+	// lobbies and presence belong to a user, a dedicated server is listed as a game server instead
+	Settings.bUseLobbiesIfAvailable = !bIsDedicated;
+	Settings.bAllowJoinViaPresence = !bIsDedicated;
+	Settings.bUsesPresence = !bIsDedicated; // use world regions!
+	Settings.Set(CustomSessionsApi::MatchTypeKey, MatchType, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+	if (!SessionRegion.IsEmpty())
 	{
-		OnlineSession->ClearOnCreateSessionCompleteDelegate_Handle(CreateSessionCompleteDelegate_Handle);
+		Settings.Set(CustomSessionsApi::RegionKey, SessionRegion, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
 	}
 
-	CreateSessionCompleteDelegate_Handle.Reset();
+	if (ProbeResponder.IsValid() && ProbeResponder->IsListening())
+	{
+		Settings.Set(CustomSessionsApi::ProbePortKey, ProbeResponder->GetPort(), EOnlineDataAdvertisementType::ViaOnlineService);
+	}
 
-	if (bWasSuccessful)
+	Settings.BuildUniqueId = GetSessionBuildUniqueId();
+	Settings.Set(CustomSessionsApi::BuildKey, Settings.BuildUniqueId, EOnlineDataAdvertisementType::ViaOnlineService);
+}
+
+void UCustomSessionSubsystem::EnsureProbeResponder()
+{
+	// a warm session is never joined before being promoted, no need to answer for it yet
+	if (LatencyProbePort <= 0 || bCreatingWarmSession)
 	{
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Blue, FString::Printf(TEXT("Created session with name: %s"), *SessionName.ToString()));
-		}
+		return;
 	}
-	else
+
+	if (!ProbeResponder.IsValid())
 	{
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Red, FString(TEXT("Failed to create session")));
-		}
+		ProbeResponder = MakeShared<FCustomSessionProbeResponder>();
+		ProbeResponder->OnReserveSlots.BindUObject(this, &ThisClass::ReserveSlots);
+		ProbeResponder->OnReleaseSlots.BindUObject(this, &ThisClass::ReleaseSlots);
 	}
 
-	CurrentGameSession = SessionName;
-	OnCustomSessionCreateSessionCompleted.Broadcast(bWasSuccessful);
+	ProbeResponder->Limits = SlotReservationLimits;
+	ProbeResponder->Start(LatencyProbePort);
 }
 
-void UCustomSessionSubsystem::FindSessionCompleted(bool bWasSuccessful)
+void UCustomSessionSubsystem::SetSlotReservationHandler(FCustomSessionReserveSlots&& OnReserve, FCustomSessionReleaseSlots&& OnRelease)
 {
-	if (OnlineSession)
+	ReserveSlotsHandler = MoveTemp(OnReserve);
+	ReleaseSlotsHandler = MoveTemp(OnRelease);
+}
+
+void UCustomSessionSubsystem::ClearSlotReservationHandler(const UObject* Owner)
+{
+	if (ReserveSlotsHandler.IsBoundToObject(Owner))
 	{
-		OnlineSession->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate_Handle);
+		ReserveSlotsHandler.Unbind();
+		ReleaseSlotsHandler.Unbind();
 	}
+}
 
-	FindSessionsCompleteDelegate_Handle.Reset();
+ECustomSessionReservationResult UCustomSessionSubsystem::ReserveSlots(const FGuid& Token, int32 NumSlots)
+{
+	const ECustomSessionReservationResult Result = ReserveSlotsHandler.IsBound()
+		? ReserveSlotsHandler.Execute(Token, NumSlots)
+		: ECustomSessionReservationResult::Unavailable;
 
-	if (!SessionSearch.IsValid())
+	CUSTOMSESSION_EVENT(Players, Verbose, "SlotsReserved", {TEXT("Slots"), NumSlots}, {TEXT("Result"), UEnum::GetValueAsString(Result)});
+
+	return Result;
+}
+
+void UCustomSessionSubsystem::ReleaseSlots(const FGuid& Token)
+{
+	ReleaseSlotsHandler.ExecuteIfBound(Token);
+}
+
+void UCustomSessionSubsystem::ExecuteCreateSession(FName SessionName, int32 NumPublicConnections, const FString& MatchType, bool bDestroyedExisting)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCustomSessionSubsystem::ExecuteCreateSession);
+
+	if (!OnlineSession.IsValid())
 	{
-		OnCustomSessionFindSessionsCompleted.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+		UE_LOG(LogCustomSessions, Error, TEXT("Can't create a session without a valid OSS"));
+		BroadcastOperationCompleted(ECustomSessionOperation::Create, SessionName, false);
 
 		return;
 	}
 
-	if (JoinSessionCompleteDelegate_Handle.IsValid())
+	const UWorld* World = GetWorld();
+	if (!IsValid(World))
 	{
-		OnCustomSessionFindSessionsCompleted.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+		BroadcastOperationCompleted(ECustomSessionOperation::Create, SessionName, false);
 
 		return;
 	}
 
-	if (!bWasSuccessful)
+	const FUniqueNetIdPtr HostingUserId = GetLocalUserId();
+	if (!HostingUserId.IsValid() && !IsDedicatedServer())
 	{
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Red,
-				FString("Error finding sessions"));
-		}
-
-		OnCustomSessionFindSessionsCompleted.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+		BroadcastOperationCompleted(ECustomSessionOperation::Create, SessionName, false);
 
 		return;
 	}
 
-	if (SessionSearch->SearchResults.IsEmpty())
+	if (OnlineSession->GetNamedSession(SessionName) != nullptr)
 	{
-		if (GEngine)
+		if (bDestroyedExisting)
 		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Orange,
-				FString("No sessions found"));
+			UE_LOG(LogCustomSessions, Error, TEXT("Could not destroy the existing session %s to create it again"), *SessionName.ToString());
+			BroadcastOperationCompleted(ECustomSessionOperation::Create, SessionName, false);
+
+			return;
 		}
 
-		OnCustomSessionFindSessionsCompleted.Broadcast(TArray<FOnlineSessionSearchResult>(), false);
+		// destroy first and create right after it, ahead of anything already queued
+		PendingOperations.Insert(FCustomSessionPendingOperation{ECustomSessionOperation::Create, SessionName.ToString(), SessionName,
+			[this, SessionName, NumPublicConnections, MatchType]()
+			{
+				ExecuteCreateSession(SessionName, NumPublicConnections, MatchType, true);
+			}}, 0);
+
+		ExecuteDestroySession(SessionName);
 
 		return;
 	}
 
-	OnCustomSessionFindSessionsCompleted.Broadcast(SessionSearch->SearchResults, true);
+	const TSharedRef<FOnlineSessionSettings> Settings = MakeShared<FOnlineSessionSettings>();
+	EnsureProbeResponder();
+	ApplyHostSettings(*Settings, NumPublicConnections, MatchType);
+	if (bCreatingWarmSession)
+	{
+		// nobody can be let in before the host travels to a listen map, it is advertised once promoted
+		Settings->bShouldAdvertise = false;
+	}
+	else
+	{
+		BeginOperation(ECustomSessionOperation::Create, SessionName);
+	}
+
+	NamedSessions.FindOrAdd(SessionName).Settings = Settings;
+	SetSessionState(SessionName, ECustomSessionState::Creating);
+	// user 0 stands for the server itself on dedicated servers
+	const bool bCreating = HostingUserId.IsValid()
+		? OnlineSession->CreateSession(*HostingUserId, SessionName, *Settings)
+		: OnlineSession->CreateSession(0, SessionName, *Settings);
+	if (!bCreating)
+	{
+		CreateSessionCompleted(SessionName, false);
+	}
 }
 
-void UCustomSessionSubsystem::JoinSessionCompleted(FName SessionName, EOnJoinSessionCompleteResult::Type JoinResult)
+bool UCustomSessionSubsystem::FindSession(int32 MaxSearchResults, FName SessionName, const FString& MatchType)
 {
-	if (!OnlineSession)
+	return FindSessionWithFilters(TArray<FCustomSessionSearchFilter>(), MaxSearchResults, SessionName, MatchType);
+}
+
+bool UCustomSessionSubsystem::FindSessionWithFilters(const TArray<FCustomSessionSearchFilter>& Filters, int32 MaxSearchResults, FName SessionName, const FString& MatchType)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCustomSessionSubsystem::FindSessionWithFilters);
+
+	TArray<FCustomSessionSearchFilter> SearchFilters = MakeSearchFilters(Filters, MatchType);
+	const bool bIsLanQuery = IsLanSubsystem();
+	const FString SearchKey = MakeSearchCacheKey(SearchFilters, bIsLanQuery);
+
+	if (!OnlineSession.IsValid())
 	{
-		UE_LOG(LogOnlineSession, Error, TEXT("AMenuSystemCharacter::OnJoinSessionComplete : OnlineSession is not valid"));
-		OnCustomsessionJoinSessionCompleted.Broadcast(EOnJoinSessionCompleteResult::UnknownError);
+		UE_LOG(LogCustomSessions, Error, TEXT("Can't find sessions without a valid OSS"));
+		BroadcastFindCompleted(SearchKey, FCustomSessionSearchSnapshot::Empty(), false);
 
-		return;
+		return false;
 	}
 
-	OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate_Handle);
-	JoinSessionCompleteDelegate_Handle.Reset();
-	OnCustomsessionJoinSessionCompleted.Broadcast(JoinResult);
-}
+	const UWorld* World = GetWorld();
+	if (!IsValid(World))
+	{
+		BroadcastFindCompleted(SearchKey, FCustomSessionSearchSnapshot::Empty(), false);
 
-void UCustomSessionSubsystem::StartSessionCompleted(FName SessionName, bool bWasSuccessful)
-{
+		return false;
+	}
 
-}
+	if (!GetLocalUserId().IsValid() && !IsDedicatedServer())
+	{
+		BroadcastFindCompleted(SearchKey, FCustomSessionSearchSnapshot::Empty(), false);
 
-void UCustomSessionSubsystem::DestroySessionCompleted(FName SessionName, bool bWasSuccessful)
-{
-	if (OnlineSession.IsValid())
+		return false;
+	}
+
+	if (IsSearching() && SearchKey == InFlightSearchKey)
+	{
+		// same query already running: wait for it instead of issuing a duplicate, and make sure it gets broadcast
+		bInFlightSearchIsBackground = false;
+		StartSearchProgressTicker();
+
+		return true;
+	}
+
+	const double Now = FPlatformTime::Seconds();
+	bool bRefreshInBackground = false;
+	const FCustomSessionSearchSnapshotRef* CachedSnapshot = !IsJoining() ? SearchCache.Find(SearchKey) : nullptr;
+	if (CachedSnapshot != nullptr)
+	{
+		const double Age = Now - (*CachedSnapshot)->GetCompletedTime();
+		if (Age <= FMath::Max(SearchCacheTimeToLive, SearchCacheMaxStaleAge))
+		{
+			UE_LOG(LogCustomSessions, Verbose, TEXT("Serving %d cached search results (%.1fs old) for %s"),
+				(*CachedSnapshot)->Num(), Age, *SearchKey);
+
+			SearchSessionName = SessionName;
+			CurrentMatchType = MatchType;
+
+			// listeners may start a search that rehashes the cache, keep the snapshot alive on our own
+			const FCustomSessionSearchSnapshotRef Snapshot = *CachedSnapshot;
+			BroadcastSearchResults(SearchKey, Snapshot, true);
+			if (Age <= SearchCacheTimeToLive || IsOperationBlocked(ECustomSessionOperation::Find, NAME_None))
+			{
+				return true;
+			}
+
+			bRefreshInBackground = true;
+		}
+	}
+
+	// sessions we are in are left alone, the search runs next to them
+	if (IsOperationBlocked(ECustomSessionOperation::Find, NAME_None))
+	{
+		EnqueueOperation(ECustomSessionOperation::Find, SearchKey, NAME_None, [this, Filters, MaxSearchResults, SessionName, MatchType]()
+		{
+			FindSessionWithFilters(Filters, MaxSearchResults, SessionName, MatchType);
+		});
+
+		return true;
+	}
+
+	SearchSessionName = SessionName;
+	CurrentMatchType = MatchType;
+	RequestSearchFilters = MoveTemp(SearchFilters);
+	RequestMaxSearchResults = MaxSearchResults;
+	NarrowerScopeResults.Reset();
+
+	// the own region first, LAN searches only ever see sessions close by
+	const bool bPartitionByRegion = !SessionRegion.IsEmpty() && MinRegionSearchResults > 0 && !bIsLanQuery;
+	SearchScope = bPartitionByRegion ? ECustomSessionSearchScope::Region : ECustomSessionSearchScope::Global;
+
+	InFlightSearchKey = SearchKey;
+	bInFlightSearchIsBackground = bRefreshInBackground;
+
+	RefreshState();
+	BeginOperation(ECustomSessionOperation::Find);
+	if (!StartBackendSearch())
+	{
+		FindSessionCompleted(false);
+
+		return bRefreshInBackground;
+	}
+
+	if (!bRefreshInBackground)
+	{
+		StartSearchProgressTicker();
+	}
+
+	return true;
+}
+
+void UCustomSessionSubsystem::StartSearchProgressTicker()
+{
+	if (OnCustomSessionSearchProgress.IsBound() && !SearchProgressTickerHandle.IsValid())
+	{
+		SearchProgressTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::PollSearchProgress));
+	}
+}
+
+void UCustomSessionSubsystem::InvalidateSearchCache()
+{
+	SearchCache.Reset();
+}
+
+int32 UCustomSessionSubsystem::FilterSearchResults(TArray<FOnlineSessionSearchResult>& SearchResults, const TArray<FCustomSessionSearchFilter>& Filters)
+{
+	return SearchResults.RemoveAll([&Filters](const FOnlineSessionSearchResult& Result)
+	{
+		return Filters.ContainsByPredicate([&Result](const FCustomSessionSearchFilter& Filter) { return !Filter.Matches(Result.Session.SessionSettings); });
+	});
+}
+
+TArray<FCustomSessionRankedResult> UCustomSessionSubsystem::RankSessions(const TArray<FOnlineSessionSearchResult>& SearchResults, int32 RequiredConnections) const
+{
+	TArray<FCustomSessionRankedResult> RankedResults;
+	FCustomSessionRanking::Rank(SearchResults, MakeRankingContext(RequiredConnections), RankedResults);
+
+	return RankedResults;
+}
+
+bool UCustomSessionSubsystem::StartBackendSearch()
+{
+	const FUniqueNetIdPtr SearchingUserId = GetLocalUserId();
+	if (!OnlineSession.IsValid() || (!SearchingUserId.IsValid() && !IsDedicatedServer()))
+	{
+		return false;
+	}
+
+	ActiveSearchFilters = RequestSearchFilters;
+	const FCustomSessionSearchFilter ScopeFilter = MakeScopeFilter(SearchScope);
+	if (ScopeFilter.Key != NAME_None)
+	{
+		ActiveSearchFilters.Add(ScopeFilter);
+	}
+
+	SessionSearch = MakeShareable(new FOnlineSessionSearch());
+	SessionSearch->MaxSearchResults = RequestMaxSearchResults;
+	SessionSearch->bIsLanQuery = IsLanSubsystem();
+	if (!bSearchDedicatedServers)
+	{
+		SessionSearch->QuerySettings.Set(SEARCH_PRESENCE, true, EOnlineComparisonOp::Equals);
+	}
+	for (const FCustomSessionSearchFilter& Filter : ActiveSearchFilters)
+	{
+		if (IsFilterAppliedByBackend(Filter))
+		{
+			SessionSearch->QuerySettings.SearchParams.Add(Filter.Key, FOnlineSessionSearchParam(Filter.Value, Filter.ComparisonOp));
+		}
+	}
+
+	ReportedSearchResults = 0;
+	if (FindSessionsTimeout > 0.0f)
+	{
+		// set before the call, backends may complete within it
+		GetGameInstance()->GetTimerManager().SetTimer(FindSessionsTimerHandle, this, &ThisClass::FindSessionsTimedOut, FindSessionsTimeout, false);
+	}
+
+	FindSessionsCompleteDelegate_Handle = OnlineSession->AddOnFindSessionsCompleteDelegate_Handle(OnFindSessionsCompleteDelegate);
+	const bool bSearching = SearchingUserId.IsValid()
+		? OnlineSession->FindSessions(*SearchingUserId, SessionSearch.ToSharedRef())
+		: OnlineSession->FindSessions(0, SessionSearch.ToSharedRef());
+	if (!bSearching)
+	{
+		GetGameInstance()->GetTimerManager().ClearTimer(FindSessionsTimerHandle);
+		OnlineSession->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate_Handle);
+		FindSessionsCompleteDelegate_Handle.Reset();
+
+		return false;
+	}
+
+	return true;
+}
+
+bool UCustomSessionSubsystem::WidenSearch()
+{
+	if (SearchScope == ECustomSessionSearchScope::Global || !SessionSearch.IsValid() || SessionSearch->SearchResults.Num() >= MinRegionSearchResults)
+	{
+		return false;
+	}
+
+	const ECustomSessionSearchScope NextScope = SearchScope == ECustomSessionSearchScope::Region && FindNeighborRegions() != nullptr
+		? ECustomSessionSearchScope::Neighbors
+		: ECustomSessionSearchScope::Global;
+
+	CUSTOMSESSION_EVENT(Search, Log, "SearchWidened", {TEXT("MatchType"), CurrentMatchType}, {TEXT("Results"), SessionSearch->SearchResults.Num()},
+		{TEXT("Scope"), UEnum::GetValueAsString(NextScope)});
+
+	// every scope contains the narrower one, the wider results replace these unless that search fails
+	NarrowerScopeResults = MoveTemp(SessionSearch->SearchResults);
+	SearchScope = NextScope;
+	if (!StartBackendSearch())
+	{
+		FindSessionCompleted(false);
+	}
+
+	return true;
+}
+
+FCustomSessionSearchFilter UCustomSessionSubsystem::MakeScopeFilter(ECustomSessionSearchScope Scope) const
+{
+	switch (Scope)
+	{
+		case ECustomSessionSearchScope::Region:
+		{
+			return FCustomSessionSearchFilter(CustomSessionsApi::RegionKey, SessionRegion);
+		}
+
+		case ECustomSessionSearchScope::Neighbors:
+		{
+			const TArray<FString>* Neighbors = FindNeighborRegions();
+			const FString Regions = Neighbors != nullptr ? SessionRegion + TEXT(",") + FString::Join(*Neighbors, TEXT(",")) : SessionRegion;
+
+			return FCustomSessionSearchFilter(CustomSessionsApi::RegionKey, Regions, EOnlineComparisonOp::In);
+		}
+
+		default:
+		return FCustomSessionSearchFilter();
+	}
+}
+
+const TArray<FString>* UCustomSessionSubsystem::FindNeighborRegions() const
+{
+	const FCustomSessionRegionNeighbors* Entry = RegionNeighbors.FindByPredicate([this](const FCustomSessionRegionNeighbors& Candidate)
+	{
+		return Candidate.Region.Equals(SessionRegion);
+	});
+
+	return Entry != nullptr && !Entry->Neighbors.IsEmpty() ? &Entry->Neighbors : nullptr;
+}
+
+int32 UCustomSessionSubsystem::ResolveBuildUniqueId(int32 ConfiguredId)
+{
+	return ConfiguredId != 0 ? ConfiguredId : ::GetBuildUniqueId();
+}
+
+FCustomSessionRankingContext UCustomSessionSubsystem::MakeRankingContext(int32 RequiredConnections) const
+{
+	FCustomSessionRankingContext Context;
+	Context.Weights = RankingWeights;
+	Context.BuildUniqueId = GetSessionBuildUniqueId();
+	Context.bRequireBuildMatch = bFilterSearchByBuild;
+	Context.Region = SessionRegion;
+	Context.RequiredConnections = RequiredConnections;
+	Context.ScoreDelegate = ScoreDelegate;
+
+	return Context;
+}
+
+bool UCustomSessionSubsystem::CancelFindSessions()
+{
+	if (!IsSearching())
+	{
+		return false;
+	}
+
+	CUSTOMSESSION_EVENT(Search, Log, "SearchCancelled", {TEXT("MatchType"), CurrentMatchType});
+	CancelInFlightSearch(ECustomSessionResult::Cancelled, true);
+
+	return true;
+}
+
+void UCustomSessionSubsystem::JoinSession(const FOnlineSessionSearchResult& SearchResult, FName SessionName)
+{
+	ExecuteJoinSession(SearchResult, SessionName == NAME_None ? SearchSessionName : SessionName, 0);
+}
+
+void UCustomSessionSubsystem::ExecuteJoinSession(const FOnlineSessionSearchResult& SearchResult, FName SessionName, uint32 RequestId)
+{
+	const bool bBlocked = IsOperationBlocked(ECustomSessionOperation::Join, SessionName);
+	if (bBlocked || HasWarmSession())
+	{
+		EnqueueOperation(ECustomSessionOperation::Join, SessionName.ToString(), SessionName, [this, SearchResult, SessionName, RequestId]()
+		{
+			ExecuteJoinSession(SearchResult, SessionName, RequestId);
+		}, RequestId);
+
+		// the warm session holds the name we join under, it goes away first
+		if (!bBlocked)
+		{
+			ReleaseWarmSession();
+		}
+
+		return;
+	}
+
+	JoinSessionName = SessionName;
+	JoinRequestId = RequestId;
+	SetSessionState(SessionName, ECustomSessionState::Joining);
+	BeginOperation(ECustomSessionOperation::Join, SessionName);
+	JoinCandidates.Reset();
+	JoinCandidatesSnapshot.Reset();
+	NextJoinCandidate = 0;
+	JoinDeadline = FPlatformTime::Seconds() + JoinTotalDeadline;
+	++JoinSerial;
+	JoinReservationToken = FGuid::NewGuid();
+	ReservedSessionName = NAME_None;
+	JoinRequiredConnections = 1;
+
+	if (!StartJoinAttempt(SearchResult))
+	{
+		FinishJoin(EOnJoinSessionCompleteResult::UnknownError);
+	}
+}
+
+bool UCustomSessionSubsystem::JoinBestSession(int32 RequiredConnections)
+{
+	if (!LastSnapshot.IsValid())
+	{
+		return false;
+	}
+
+	return JoinBestSessionFrom(LastSnapshot.ToSharedRef(), RequiredConnections, SearchSessionName);
+}
+
+bool UCustomSessionSubsystem::JoinBestSessionFrom(const FCustomSessionSearchSnapshotRef& Snapshot, int32 RequiredConnections, FName SessionName, uint32 RequestId)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCustomSessionSubsystem::JoinBestSessionFrom);
+
+	const auto EnqueueJoin = [this, &Snapshot, RequiredConnections, SessionName, RequestId]()
+	{
+		// whether anything is joinable is only known once it runs, a failure is broadcast then
+		EnqueueOperation(ECustomSessionOperation::Join, SessionName.ToString(), SessionName, [this, Snapshot, RequiredConnections, SessionName, RequestId]()
+		{
+			if (!JoinBestSessionFrom(Snapshot, RequiredConnections, SessionName, RequestId))
+			{
+				BroadcastJoinCompleted(SessionName, EOnJoinSessionCompleteResult::SessionDoesNotExist, RequestId);
+			}
+		}, RequestId);
+	};
+
+	if (IsOperationBlocked(ECustomSessionOperation::Join, SessionName))
+	{
+		EnqueueJoin();
+
+		return true;
+	}
+
+	JoinCandidatesSnapshot = Snapshot;
+	FCustomSessionRanking::Rank(Snapshot->GetResults(), MakeRankingContext(RequiredConnections), JoinCandidates);
+	if (JoinCandidates.IsEmpty())
+	{
+		JoinCandidatesSnapshot.Reset();
+
+		return false;
+	}
+
+	// only dropped once there is something to join, a quick match hosting instead still finds it warm
+	if (HasWarmSession())
+	{
+		JoinCandidates.Reset();
+		JoinCandidatesSnapshot.Reset();
+		EnqueueJoin();
+		ReleaseWarmSession();
+
+		return true;
+	}
+
+	JoinSessionName = SessionName;
+	JoinRequestId = RequestId;
+	SetSessionState(SessionName, ECustomSessionState::Joining);
+	BeginOperation(ECustomSessionOperation::Join, SessionName);
+
+	NextJoinCandidate = 0;
+	JoinDeadline = FPlatformTime::Seconds() + JoinTotalDeadline;
+	++JoinSerial;
+	JoinReservationToken = FGuid::NewGuid();
+	ReservedSessionName = NAME_None;
+	JoinRequiredConnections = RequiredConnections;
+	if (bProbeLatencyBeforeJoin && NumLatencyProbeCandidates > 0)
+	{
+		ProbeJoinCandidates(RequiredConnections);
+
+		return true;
+	}
+
+	if (MaxJoinAttempts > 0 && JoinCandidates.Num() > MaxJoinAttempts)
+	{
+		JoinCandidates.SetNum(MaxJoinAttempts);
+	}
+
+	TryNextJoinCandidate(EOnJoinSessionCompleteResult::UnknownError);
+
+	return true;
+}
+
+void UCustomSessionSubsystem::ProbeJoinCandidates(int32 RequiredConnections)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCustomSessionSubsystem::ProbeJoinCandidates);
+
+	TArray<FCustomSessionProbeTarget> Targets;
+	const int32 NumCandidates = FMath::Min(NumLatencyProbeCandidates, JoinCandidates.Num());
+	Targets.Reserve(NumCandidates);
+	for (int32 Index = 0; Index < NumCandidates; ++Index)
+	{
+		FCustomSessionProbeTarget Target;
+		if (MakeProbeTarget((*JoinCandidatesSnapshot)[JoinCandidates[Index].Index], Target))
+		{
+			Targets.Add(MoveTemp(Target));
+		}
+	}
+
+	const auto JoinCandidatesInOrder = [this]()
+	{
+		if (MaxJoinAttempts > 0 && JoinCandidates.Num() > MaxJoinAttempts)
+		{
+			JoinCandidates.SetNum(MaxJoinAttempts);
+		}
+
+		TryNextJoinCandidate(EOnJoinSessionCompleteResult::UnknownError);
+	};
+
+	// hosts behind relays or older builds don't answer probes, the backend ranking is all there is
+	if (Targets.IsEmpty())
+	{
+		JoinCandidatesInOrder();
+
+		return;
+	}
+
+	if (!LatencyProbe.IsValid())
+	{
+		LatencyProbe = MakeShared<FCustomSessionLatencyProbe>(LatencyProbeSamples, LatencyProbeTimeout, LatencyProbeCacheTime);
+	}
+
+	CUSTOMSESSION_EVENT(Join, Verbose, "ProbeStarted", {TEXT("Targets"), Targets.Num()});
+	LatencyProbe->Probe(MoveTemp(Targets), FCustomSessionProbesCompleted::CreateWeakLambda(this,
+		[this, RequiredConnections, JoinCandidatesInOrder, Serial = JoinSerial](const TMap<FString, float>& RoundTrips)
+		{
+			// the join may have been cancelled or timed out meanwhile
+			if (!IsJoining() || Serial != JoinSerial || !JoinCandidatesSnapshot.IsValid())
+			{
+				return;
+			}
+
+			FCustomSessionRankingContext Context = MakeRankingContext(RequiredConnections);
+			for (const TPair<FString, float>& RoundTrip : RoundTrips)
+			{
+				// unreachable hosts rank as the worst acceptable ping, they are still better than nothing
+				const int32 PingInMs = RoundTrip.Value >= 0.0f ? FMath::CeilToInt(RoundTrip.Value) : Context.Weights.MaxAcceptablePingMs;
+				Context.MeasuredPingsMs.Add(RoundTrip.Key, PingInMs);
+				CUSTOMSESSION_EVENT(Join, Verbose, "ProbeResult", {TEXT("SessionId"), RoundTrip.Key}, {TEXT("RoundTripMs"), RoundTrip.Value});
+			}
+
+			FCustomSessionRanking::Rank(JoinCandidatesSnapshot->GetResults(), Context, JoinCandidates);
+			JoinCandidatesInOrder();
+		}));
+}
+
+bool UCustomSessionSubsystem::MakeProbeTarget(const FOnlineSessionSearchResult& SearchResult, FCustomSessionProbeTarget& OutTarget) const
+{
+	int32 ProbePort = 0;
+	if (!OnlineSession.IsValid() || !SearchResult.Session.SessionSettings.Get(CustomSessionsApi::ProbePortKey, ProbePort)
+		|| ProbePort <= 0 || ProbePort > MAX_uint16)
+	{
+		return false;
+	}
+
+	// only sessions reachable by address can be probed, e.g. steam.<id> connect strings can't
+	FString ConnectString;
+	FIPv4Endpoint GameEndpoint;
+	if (!OnlineSession->GetResolvedConnectString(SearchResult, NAME_GamePort, ConnectString) || !FIPv4Endpoint::Parse(ConnectString, GameEndpoint))
+	{
+		return false;
+	}
+
+	OutTarget.Id = SearchResult.GetSessionIdStr();
+	OutTarget.Endpoint = FIPv4Endpoint(GameEndpoint.Address, static_cast<uint16>(ProbePort));
+
+	return true;
+}
+
+bool UCustomSessionSubsystem::StartJoinAttempt(const FOnlineSessionSearchResult& SearchResult)
+{
+	FCustomSessionProbeTarget Host;
+	if (!bReserveSlotsBeforeJoin || !MakeProbeTarget(SearchResult, Host))
+	{
+		return StartBackendJoin(SearchResult);
+	}
+
+	if (!ReservationClient.IsValid())
+	{
+		ReservationClient = MakeShared<FCustomSessionReservationClient>(SlotReservationTimeout, 4);
+	}
+
+	CUSTOMSESSION_EVENT(Join, Verbose, "ReservationRequested", {TEXT("SessionId"), SearchResult.GetSessionIdStr()}, {TEXT("Slots"), JoinRequiredConnections});
+	ReservationClient->Reserve(Host.Endpoint, JoinReservationToken, JoinRequiredConnections, FCustomSessionReservationCompleted::CreateWeakLambda(this,
+		[this, SearchResult, Endpoint = Host.Endpoint, Serial = JoinSerial](ECustomSessionReservationResult Result)
+		{
+			// the join may have been cancelled or timed out meanwhile
+			if (IsJoining() && Serial == JoinSerial)
+			{
+				SlotReservationCompleted(SearchResult, Endpoint, Result);
+			}
+		}));
+
+	return true;
+}
+
+void UCustomSessionSubsystem::SlotReservationCompleted(const FOnlineSessionSearchResult& SearchResult, const FIPv4Endpoint& Host, ECustomSessionReservationResult Result)
+{
+	CUSTOMSESSION_EVENT(Join, Log, "ReservationCompleted", {TEXT("SessionId"), SearchResult.GetSessionIdStr()}, {TEXT("Result"), UEnum::GetValueAsString(Result)});
+
+	switch (Result)
+	{
+		case ECustomSessionReservationResult::Granted:
+		{
+			ReservedHost = Host;
+		}
+		break;
+
+		// a firewall may drop the datagrams, joining without slots held is still better than not joining
+		case ECustomSessionReservationResult::TimedOut:
+		break;
+
+		default:
+		{
+			TryNextJoinCandidate(Result == ECustomSessionReservationResult::Full
+				? EOnJoinSessionCompleteResult::SessionIsFull
+				: EOnJoinSessionCompleteResult::SessionDoesNotExist);
+		}
+		return;
+	}
+
+	if (!StartBackendJoin(SearchResult))
+	{
+		ReleaseSlotReservation();
+		TryNextJoinCandidate(EOnJoinSessionCompleteResult::UnknownError);
+	}
+}
+
+void UCustomSessionSubsystem::ReleaseSlotReservation()
+{
+	if (ReservedHost.IsSet() && ReservationClient.IsValid())
+	{
+		ReservationClient->Release(ReservedHost.GetValue(), JoinReservationToken);
+	}
+
+	ReservedHost.Reset();
+}
+
+bool UCustomSessionSubsystem::StartBackendJoin(const FOnlineSessionSearchResult& SearchResult)
+{
+	if (!OnlineSession.IsValid())
+	{
+		return false;
+	}
+
+	// a dedicated server has nobody to travel, it only hosts
+	const FUniqueNetIdPtr JoiningUserId = GetLocalUserId();
+	if (!JoiningUserId.IsValid())
+	{
+		return false;
+	}
+
+	CUSTOMSESSION_EVENT(Join, Log, "JoinAttempt", {TEXT("SessionId"), SearchResult.GetSessionIdStr()}, {TEXT("Ping"), SearchResult.PingInMs});
+
+	JoinFailureReason = ECustomSessionResult::Failed;
+
+	const uint32 CompletionCountBefore = JoinCompletionCount;
+	JoinSessionCompleteDelegate_Handle = OnlineSession->AddOnJoinSessionCompleteDelegate_Handle(OnJoinSessionCompleteDelegate);
+	const bool bJoining = OnlineSession->JoinSession(*JoiningUserId, JoinSessionName, SearchResult);
+
+	// some backends complete within the call and still return false, the completion already finished
+	// this attempt or moved on to the next candidate, whose handle and timer must be left alone
+	if (JoinCompletionCount != CompletionCountBefore)
+	{
+		return true;
+	}
+
+	if (!bJoining)
+	{
+		OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate_Handle);
+		JoinSessionCompleteDelegate_Handle.Reset();
+
+		return false;
+	}
+
+	const double TimeLeft = JoinDeadline - FPlatformTime::Seconds();
+	const float AttemptTimeout = static_cast<float>(FMath::Min<double>(JoinAttemptTimeout, TimeLeft));
+	if (AttemptTimeout > 0.0f)
+	{
+		GetGameInstance()->GetTimerManager().SetTimer(JoinAttemptTimerHandle, this, &ThisClass::JoinAttemptTimedOut, AttemptTimeout, false);
+	}
+
+	return true;
+}
+
+void UCustomSessionSubsystem::TryNextJoinCandidate(EOnJoinSessionCompleteResult::Type LastResult)
+{
+	while (JoinCandidatesSnapshot.IsValid() && JoinCandidates.IsValidIndex(NextJoinCandidate) && FPlatformTime::Seconds() < JoinDeadline)
+	{
+		const FOnlineSessionSearchResult& Candidate = (*JoinCandidatesSnapshot)[JoinCandidates[NextJoinCandidate++].Index];
+		if (StartJoinAttempt(Candidate))
+		{
+			return;
+		}
+	}
+
+	if (JoinCandidates.IsValidIndex(NextJoinCandidate))
+	{
+		// candidates were left untried, what failed is JoinTotalDeadline
+		JoinFailureReason = ECustomSessionResult::TimedOut;
+	}
+
+	FinishJoin(LastResult);
+}
+
+void UCustomSessionSubsystem::FinishJoin(EOnJoinSessionCompleteResult::Type JoinResult)
+{
+	if (LatencyProbe.IsValid())
+	{
+		LatencyProbe->Cancel();
+	}
+
+	if (ReservationClient.IsValid())
+	{
+		ReservationClient->Cancel();
+	}
+
+	JoinCandidates.Reset();
+	JoinCandidatesSnapshot.Reset();
+
+	const FName SessionName = JoinSessionName;
+	const uint32 RequestId = JoinRequestId;
+	JoinSessionName = NAME_None;
+	JoinRequestId = 0;
+
+	// AlreadyInSession is not a join, the name belongs to another session whose address we'd travel to
+	const bool bJoined = JoinResult == EOnJoinSessionCompleteResult::Success;
+	const ECustomSessionResult Result = bJoined ? ECustomSessionResult::Success : JoinFailureReason;
+
+	// the slots are used by travelling with the token, see ResolveConnectString
+	ReservedSessionName = bJoined && ReservedHost.IsSet() ? SessionName : NAME_None;
+	if (!bJoined)
+	{
+		ReleaseSlotReservation();
+	}
+
+	ReservedHost.Reset();
+	JoinFailureReason = ECustomSessionResult::Failed;
+	if (Result == ECustomSessionResult::TimedOut)
+	{
+		OperationRecorders.FindOrAdd(ECustomSessionOperation::Join).TimedOut(ECustomSessionOperation::Join, SessionName);
+	}
+	else
+	{
+		EndOperation(ECustomSessionOperation::Join, bJoined, INDEX_NONE, SessionName);
+	}
+
+	const bool bAbandoned = Result == ECustomSessionResult::TimedOut || Result == ECustomSessionResult::Cancelled;
+	if (bAbandoned)
+	{
+		AbandonJoin(SessionName);
+	}
+
+	SetSessionState(SessionName, bAbandoned ? ECustomSessionState::Idle : GetSettledState(SessionName));
+	if (Result == ECustomSessionResult::TimedOut)
+	{
+		CUSTOMSESSION_EVENT(Join, Warning, "JoinTimedOut", {TEXT("Session"), SessionName});
+		OnCustomSessionOperationTimedOut.Broadcast(ECustomSessionOperation::Join, SessionName);
+	}
+
+	BroadcastJoinCompleted(SessionName, JoinResult, RequestId, Result);
+	ProcessPendingOperations();
+}
+
+void UCustomSessionSubsystem::JoinAttemptTimedOut()
+{
+	if (!OnlineSession.IsValid() || !IsJoining())
+	{
+		return;
+	}
+
+	UE_LOG(LogCustomSessions, Warning, TEXT("Join attempt on %s timed out"), *JoinSessionName.ToString());
+
+	// a late answer from the backend is ignored from now on
+	OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate_Handle);
+	JoinSessionCompleteDelegate_Handle.Reset();
+
+	// the next candidate's attempt starts over, this only sticks if it was the last one
+	JoinFailureReason = ECustomSessionResult::TimedOut;
+	JoinSessionCompleted(JoinSessionName, EOnJoinSessionCompleteResult::UnknownError);
+}
+
+void UCustomSessionSubsystem::AbandonJoin(FName SessionName)
+{
+	if (!OnlineSession.IsValid() || AbandonedJoins.Contains(SessionName))
+	{
+		return;
+	}
+
+	AbandonedJoins.Add(SessionName);
+
+	// the backend may have opened the session before it stalled, nobody is going to use it
+	if (OnlineSession->GetNamedSession(SessionName) != nullptr)
+	{
+		DestroyAbandonedSession(SessionName);
+
+		return;
+	}
+
+	// or open it once the late answer comes in, e.g. the mock and Steam add the session on completion
+	FCustomSessionAbandonedJoin& Abandoned = AbandonedJoins[SessionName];
+	Abandoned.JoinSessionCompleteHandle = OnlineSession->AddOnJoinSessionCompleteDelegate_Handle(
+		FOnJoinSessionCompleteDelegate::CreateUObject(this, &ThisClass::AbandonedJoinCompleted));
+	GetGameInstance()->GetTimerManager().SetTimer(Abandoned.GracePeriodTimerHandle,
+		FTimerDelegate::CreateUObject(this, &ThisClass::ForgetAbandonedJoin, SessionName), FMath::Max(AbandonedJoinGracePeriod, 0.01f), false);
+}
+
+void UCustomSessionSubsystem::AbandonedJoinCompleted(FName SessionName, EOnJoinSessionCompleteResult::Type JoinResult)
+{
+	FCustomSessionAbandonedJoin* Abandoned = AbandonedJoins.Find(SessionName);
+	if (Abandoned == nullptr || !Abandoned->JoinSessionCompleteHandle.IsValid())
+	{
+		return;
+	}
+
+	// one shot, nothing else joins under the name until it is forgotten
+	OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(Abandoned->JoinSessionCompleteHandle);
+	Abandoned->JoinSessionCompleteHandle.Reset();
+	GetGameInstance()->GetTimerManager().ClearTimer(Abandoned->GracePeriodTimerHandle);
+
+	CUSTOMSESSION_EVENT(Join, Log, "AbandonedJoinCompleted", {TEXT("Session"), SessionName}, {TEXT("Result"), LexToString(JoinResult)});
+	if (OnlineSession->GetNamedSession(SessionName) != nullptr)
+	{
+		DestroyAbandonedSession(SessionName);
+
+		return;
+	}
+
+	ForgetAbandonedJoin(SessionName);
+}
+
+void UCustomSessionSubsystem::DestroyAbandonedSession(FName SessionName)
+{
+	// the name is only free again once the backend let go of it
+	const bool bDestroying = OnlineSession->DestroySession(SessionName, FOnDestroySessionCompleteDelegate::CreateWeakLambda(this,
+		[this](FName DestroyedSessionName, bool bWasSuccessful)
+		{
+			ForgetAbandonedJoin(DestroyedSessionName);
+		}));
+
+	if (!bDestroying)
+	{
+		ForgetAbandonedJoin(SessionName);
+	}
+}
+
+void UCustomSessionSubsystem::ForgetAbandonedJoin(FName SessionName)
+{
+	FCustomSessionAbandonedJoin Abandoned;
+	if (!AbandonedJoins.RemoveAndCopyValue(SessionName, Abandoned))
+	{
+		return;
+	}
+
+	if (OnlineSession.IsValid() && Abandoned.JoinSessionCompleteHandle.IsValid())
+	{
+		OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(Abandoned.JoinSessionCompleteHandle);
+	}
+
+	if (const UGameInstance* GameInstance = GetGameInstance())
+	{
+		GameInstance->GetTimerManager().ClearTimer(Abandoned.GracePeriodTimerHandle);
+	}
+
+	ProcessPendingOperations();
+}
+
+void UCustomSessionSubsystem::FindSessionsTimedOut()
+{
+	if (!IsSearching())
+	{
+		return;
+	}
+
+	UE_LOG(LogCustomSessions, Warning, TEXT("Search for %s sessions timed out after %.1fs"), *CurrentMatchType, FindSessionsTimeout);
+	CUSTOMSESSION_EVENT(Search, Warning, "SearchTimedOut", {TEXT("MatchType"), CurrentMatchType}, {TEXT("Seconds"), FindSessionsTimeout});
+	CancelInFlightSearch(ECustomSessionResult::TimedOut, true);
+}
+
+bool UCustomSessionSubsystem::CancelJoinSession()
+{
+	if (!IsJoining())
+	{
+		return false;
+	}
+
+	GetGameInstance()->GetTimerManager().ClearTimer(JoinAttemptTimerHandle);
+	if (OnlineSession.IsValid())
+	{
+		OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate_Handle);
+	}
+
+	JoinSessionCompleteDelegate_Handle.Reset();
+	CUSTOMSESSION_EVENT(Join, Log, "JoinCancelled", {TEXT("Session"), JoinSessionName});
+	JoinFailureReason = ECustomSessionResult::Cancelled;
+	FinishJoin(EOnJoinSessionCompleteResult::UnknownError);
+
+	return true;
+}
+
+bool UCustomSessionSubsystem::QuickMatch(const FString& MatchType, const FCustomSessionQuickMatchOptions& Options)
+{
+	if (bQuickMatchInProgress)
+	{
+		return false;
+	}
+
+	bQuickMatchInProgress = true;
+	bQuickMatchSearching = true;
+	++QuickMatchSerial;
+	QuickMatchType = MatchType;
+	QuickMatchOptions = Options;
+	QuickMatchSearchKey = GetSearchKey(TArray<FCustomSessionSearchFilter>(), MatchType);
+
+	if (Options.bHostIfNoneFound && Options.HostDeadline > 0.0f)
+	{
+		GetGameInstance()->GetTimerManager().SetTimer(QuickMatchTimerHandle, this, &ThisClass::QuickMatchDeadlineReached, Options.HostDeadline, false);
+	}
+
+	// searches and joins started by anyone else complete on the public delegates, the quick match only hears its own
+	FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), Options.MaxSearchResults, Options.SessionName, MatchType)
+		.Next([WeakThis = TWeakObjectPtr<ThisClass>(this), Serial = QuickMatchSerial](const FCustomSessionFindResult& FindResult)
+		{
+			ThisClass* This = WeakThis.Get();
+			if (This != nullptr && This->IsCurrentQuickMatch(Serial))
+			{
+				This->QuickMatchSearchCompleted(FindResult);
+			}
+		});
+
+	// a cached search completes right away
+	if (bQuickMatchSearching)
+	{
+		// backends that fill SearchResults while searching let us start joining before the search completes
+		QuickMatchTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::PollQuickMatchSearch));
+	}
+
+	return true;
+}
+
+bool UCustomSessionSubsystem::PollSearchProgress(float DeltaTime)
+{
+	if (!IsSearching())
+	{
+		SearchProgressTickerHandle.Reset();
+
+		return false;
+	}
+
+	const int32 NumResults = SessionSearch->SearchResults.Num();
+	if (NumResults > ReportedSearchResults)
+	{
+		const int32 FirstNewResult = ReportedSearchResults;
+		ReportedSearchResults = NumResults;
+		OnCustomSessionSearchProgress.Broadcast(SessionSearch->SearchResults, FirstNewResult);
+	}
+
+	return true;
+}
+
+bool UCustomSessionSubsystem::PollQuickMatchSearch(float DeltaTime)
+{
+	if (!bQuickMatchSearching)
+	{
+		QuickMatchTickerHandle.Reset();
+
+		return false;
+	}
+
+	// the search of the quick match may still be queued behind another one, that one is not ours to look at
+	if (!IsSearching() || InFlightSearchKey != QuickMatchSearchKey)
+	{
+		return true;
+	}
+
+	const FCustomSessionRankingContext RankingContext = MakeRankingContext(QuickMatchOptions.RequiredConnections);
+	const bool bHasAcceptableResult = SessionSearch->SearchResults.ContainsByPredicate([this, &RankingContext](const FOnlineSessionSearchResult& Result)
+	{
+		float Score = 0.0f;
+		return FCustomSessionRanking::Score(Result, RankingContext, Score)
+			&& !ActiveSearchFilters.ContainsByPredicate([&Result](const FCustomSessionSearchFilter& Filter) { return !Filter.Matches(Result.Session.SessionSettings); });
+	});
+
+	if (!bHasAcceptableResult)
+	{
+		return true;
+	}
+
+	// the cancelled search may still be written by the backend, the partial results are copied out of it
+	FCustomSessionSearchSnapshotRef PartialSnapshot = MakeSnapshot(SessionSearch->SearchResults.FilterByPredicate([this](const FOnlineSessionSearchResult& Result)
+	{
+		return !ActiveSearchFilters.ContainsByPredicate([&Result](const FCustomSessionSearchFilter& Filter) { return !Filter.Matches(Result.Session.SessionSettings); });
+	}));
+
+	// whoever else waits on the same search is told it was cancelled instead of waiting for a completion that never comes
+	bQuickMatchSearching = false;
+	QuickMatchTickerHandle.Reset();
+	CancelInFlightSearch(ECustomSessionResult::Cancelled, true);
+	QuickMatchJoin(PartialSnapshot);
+
+	return false;
+}
+
+void UCustomSessionSubsystem::QuickMatchSearchCompleted(const FCustomSessionFindResult& FindResult)
+{
+	// it already joined off the partial results or gave up on searching
+	if (!bQuickMatchSearching)
+	{
+		return;
+	}
+
+	bQuickMatchSearching = false;
+	if (!FindResult.bWasSuccessful)
+	{
+		QuickMatchHost();
+
+		return;
+	}
+
+	QuickMatchJoin(FindResult.Snapshot);
+}
+
+void UCustomSessionSubsystem::QuickMatchJoin(const FCustomSessionSearchSnapshotRef& Snapshot)
+{
+	// resolves right away with SessionDoesNotExist when nothing in the snapshot is joinable
+	JoinBestSessionAsync(Snapshot, QuickMatchOptions.RequiredConnections, QuickMatchOptions.SessionName)
+		.Next([WeakThis = TWeakObjectPtr<ThisClass>(this), Serial = QuickMatchSerial](const FCustomSessionJoinResult& JoinResult)
+		{
+			ThisClass* This = WeakThis.Get();
+			if (This != nullptr && This->IsCurrentQuickMatch(Serial))
+			{
+				This->QuickMatchJoinCompleted(JoinResult);
+			}
+		});
+}
+
+void UCustomSessionSubsystem::QuickMatchJoinCompleted(const FCustomSessionJoinResult& JoinResult)
+{
+	FString ConnectString;
+	if (JoinResult.Result == ECustomSessionResult::Success && ResolveConnectString(ConnectString, QuickMatchOptions.SessionName))
+	{
+		FinishQuickMatch(ECustomSessionQuickMatchResult::Joined, ConnectString);
+
+		return;
+	}
+
+	QuickMatchHost();
+}
+
+void UCustomSessionSubsystem::QuickMatchDeadlineReached()
+{
+	// a join already started is given its own deadline
+	if (!bQuickMatchSearching)
+	{
+		return;
+	}
+
+	UE_LOG(LogCustomSessions, Log, TEXT("Quick match found nothing to join in %.1fs"), QuickMatchOptions.HostDeadline);
+	bQuickMatchSearching = false;
+	if (IsSearching() && InFlightSearchKey == QuickMatchSearchKey)
+	{
+		CancelInFlightSearch(ECustomSessionResult::Cancelled, true);
+	}
+
+	QuickMatchHost();
+}
+
+void UCustomSessionSubsystem::QuickMatchHost()
+{
+	if (!QuickMatchOptions.bHostIfNoneFound)
+	{
+		FinishQuickMatch(ECustomSessionQuickMatchResult::Failed);
+
+		return;
+	}
+
+	GetGameInstance()->GetTimerManager().ClearTimer(QuickMatchTimerHandle);
+	CreateSessionAsync(QuickMatchOptions.SessionName, QuickMatchOptions.NumPublicConnections, QuickMatchType)
+		.Next([WeakThis = TWeakObjectPtr<ThisClass>(this), Serial = QuickMatchSerial](bool bWasSuccessful)
+		{
+			ThisClass* This = WeakThis.Get();
+			if (This != nullptr && This->IsCurrentQuickMatch(Serial))
+			{
+				This->FinishQuickMatch(bWasSuccessful ? ECustomSessionQuickMatchResult::Hosted : ECustomSessionQuickMatchResult::Failed);
+			}
+		});
+}
+
+void UCustomSessionSubsystem::FinishQuickMatch(ECustomSessionQuickMatchResult Result, const FString& ConnectString)
+{
+	if (!bQuickMatchInProgress)
+	{
+		return;
+	}
+
+	if (const UGameInstance* GameInstance = GetGameInstance())
+	{
+		GameInstance->GetTimerManager().ClearTimer(QuickMatchTimerHandle);
+	}
+
+	if (QuickMatchTickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(QuickMatchTickerHandle);
+		QuickMatchTickerHandle.Reset();
+	}
+
+	bQuickMatchInProgress = false;
+	bQuickMatchSearching = false;
+
+	OnCustomSessionQuickMatchCompleted.Broadcast(Result, ConnectString);
+}
+
+void UCustomSessionSubsystem::CancelInFlightSearch(ECustomSessionResult Reason, bool bBroadcast)
+{
+	if (!OnlineSession.IsValid() || !IsSearching())
+	{
+		return;
+	}
+
+	GetGameInstance()->GetTimerManager().ClearTimer(FindSessionsTimerHandle);
+	OnlineSession->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate_Handle);
+	FindSessionsCompleteDelegate_Handle.Reset();
+
+	const FString SearchKey = InFlightSearchKey;
+	const bool bTellListeners = bBroadcast && !bInFlightSearchIsBackground;
+	bInFlightSearchIsBackground = false;
+	OnlineSession->CancelFindSessions();
+
+	FCustomSessionOperationRecorder& Recorder = OperationRecorders.FindOrAdd(ECustomSessionOperation::Find);
+	if (Reason == ECustomSessionResult::TimedOut)
+	{
+		Recorder.TimedOut(ECustomSessionOperation::Find);
+	}
+	else
+	{
+		Recorder.Cancel(ECustomSessionOperation::Find);
+	}
+
+	// the backend may still write into the search it was given, we just stop looking at it
+	SessionSearch.Reset();
+	RefreshState();
+
+	if (Reason == ECustomSessionResult::TimedOut)
+	{
+		OnCustomSessionOperationTimedOut.Broadcast(ECustomSessionOperation::Find, SearchSessionName);
+	}
+
+	if (bTellListeners)
+	{
+		BroadcastFindCompleted(SearchKey, FCustomSessionSearchSnapshot::Empty(), false, Reason);
+	}
+	else
+	{
+		ResolveWaiters(SearchWaiters, ECustomSessionOperation::Find, SearchKey, FCustomSessionFindResult{FCustomSessionSearchSnapshot::Empty(), false, Reason});
+	}
+
+	ProcessPendingOperations();
+}
+
+void UCustomSessionSubsystem::StartSession(FName SessionName)
+{
+	SessionName = ResolveSessionName(SessionName);
+	if (IsOperationBlocked(ECustomSessionOperation::Start, SessionName))
+	{
+		EnqueueOperation(ECustomSessionOperation::Start, SessionName.ToString(), SessionName, [this, SessionName]()
+		{
+			StartSession(SessionName);
+		});
+
+		return;
+	}
+
+	if (!OnlineSession.IsValid() || OnlineSession->GetNamedSession(SessionName) == nullptr)
+	{
+		UE_LOG(LogCustomSessions, Warning, TEXT("Can't start session %s, it does not exist"), *SessionName.ToString());
+		BroadcastOperationCompleted(ECustomSessionOperation::Start, SessionName, false);
+
+		return;
+	}
+
+	// players that logged in right before the start should be part of it
+	if (SessionName == CurrentGameSession)
+	{
+		FlushPlayerRegistrations();
+	}
+
+	SetSessionState(SessionName, ECustomSessionState::Starting);
+	BeginOperation(ECustomSessionOperation::Start, SessionName);
+	if (!OnlineSession->StartSession(SessionName))
+	{
+		StartSessionCompleted(SessionName, false);
+	}
+}
+
+void UCustomSessionSubsystem::EndSession(FName SessionName)
+{
+	SessionName = ResolveSessionName(SessionName);
+	if (IsOperationBlocked(ECustomSessionOperation::End, SessionName))
+	{
+		EnqueueOperation(ECustomSessionOperation::End, SessionName.ToString(), SessionName, [this, SessionName]()
+		{
+			EndSession(SessionName);
+		});
+
+		return;
+	}
+
+	if (!OnlineSession.IsValid() || OnlineSession->GetNamedSession(SessionName) == nullptr)
+	{
+		BroadcastOperationCompleted(ECustomSessionOperation::End, SessionName, false);
+
+		return;
+	}
+
+	SetSessionState(SessionName, ECustomSessionState::Ending);
+	BeginOperation(ECustomSessionOperation::End, SessionName);
+	if (!OnlineSession->EndSession(SessionName))
+	{
+		EndSessionCompleted(SessionName, false);
+	}
+}
+
+void UCustomSessionSubsystem::QueueRegisterPlayer(const FUniqueNetIdRepl& PlayerId)
+{
+	if (!PlayerId.IsValid())
+	{
+		return;
+	}
+
+	const FUniqueNetIdRef NetId = PlayerId.GetUniqueNetId().ToSharedRef();
+	const auto IsSamePlayer = [&NetId](const FUniqueNetIdRef& Other) { return *Other == *NetId; };
+
+	// leaving and coming back within the same window needs no backend call at all
+	if (PendingUnregisterPlayers.RemoveAll(IsSamePlayer) == 0 && !PendingRegisterPlayers.ContainsByPredicate(IsSamePlayer))
+	{
+		PendingRegisterPlayers.Add(NetId);
+	}
+
+	SchedulePlayerRegistrationFlush();
+}
+
+void UCustomSessionSubsystem::QueueUnregisterPlayer(const FUniqueNetIdRepl& PlayerId)
+{
+	if (!PlayerId.IsValid())
+	{
+		return;
+	}
+
+	const FUniqueNetIdRef NetId = PlayerId.GetUniqueNetId().ToSharedRef();
+	const auto IsSamePlayer = [&NetId](const FUniqueNetIdRef& Other) { return *Other == *NetId; };
+
+	if (PendingRegisterPlayers.RemoveAll(IsSamePlayer) == 0 && !PendingUnregisterPlayers.ContainsByPredicate(IsSamePlayer))
+	{
+		PendingUnregisterPlayers.Add(NetId);
+	}
+
+	SchedulePlayerRegistrationFlush();
+}
+
+void UCustomSessionSubsystem::SchedulePlayerRegistrationFlush()
+{
+	if (PlayerRegistrationBatchWindow <= 0.0f)
+	{
+		FlushPlayerRegistrations();
+
+		return;
+	}
+
+	FTimerManager& TimerManager = GetGameInstance()->GetTimerManager();
+	if (!TimerManager.IsTimerActive(PlayerRegistrationTimerHandle))
+	{
+		TimerManager.SetTimer(PlayerRegistrationTimerHandle, this, &ThisClass::FlushPlayerRegistrations, PlayerRegistrationBatchWindow, false);
+	}
+}
+
+void UCustomSessionSubsystem::FlushPlayerRegistrations()
+{
+	if (const UGameInstance* GameInstance = GetGameInstance())
+	{
+		GameInstance->GetTimerManager().ClearTimer(PlayerRegistrationTimerHandle);
+	}
+
+	if (!OnlineSession.IsValid() || OnlineSession->GetNamedSession(CurrentGameSession) == nullptr)
+	{
+		PendingRegisterPlayers.Reset();
+		PendingUnregisterPlayers.Reset();
+
+		return;
+	}
+
+	if (!PendingRegisterPlayers.IsEmpty())
+	{
+		UE_LOG(LogCustomSessions, Verbose, TEXT("Registering %d players in %s"), PendingRegisterPlayers.Num(), *CurrentGameSession.ToString());
+		OnlineSession->RegisterPlayers(CurrentGameSession, PendingRegisterPlayers, false);
+		PendingRegisterPlayers.Reset();
+	}
+
+	if (!PendingUnregisterPlayers.IsEmpty())
+	{
+		UE_LOG(LogCustomSessions, Verbose, TEXT("Unregistering %d players from %s"), PendingUnregisterPlayers.Num(), *CurrentGameSession.ToString());
+		OnlineSession->UnregisterPlayers(CurrentGameSession, PendingUnregisterPlayers);
+		PendingUnregisterPlayers.Reset();
+	}
+}
+
+bool UCustomSessionSubsystem::UpdateSessionSettings(const FCustomSessionSettingsChange& Change, FName SessionName)
+{
+	SessionName = ResolveSessionName(SessionName);
+	FCustomSessionNamedState* Named = NamedSessions.Find(SessionName);
+	if (!OnlineSession.IsValid() || Named == nullptr || SessionName == WarmSessionName || OnlineSession->GetNamedSession(SessionName) == nullptr)
+	{
+		return false;
+	}
+
+	Named->PendingSettingsChange.Merge(Change);
+	ScheduleSessionSettingsUpdate();
+
+	return true;
+}
+
+void UCustomSessionSubsystem::ScheduleSessionSettingsUpdate()
+{
+	if (SessionSettingsUpdateDebounce <= 0.0f)
+	{
+		FlushSessionSettingsUpdate();
+
+		return;
+	}
+
+	// the window starts with the first change, later ones ride along instead of pushing it back
+	FTimerManager& TimerManager = GetGameInstance()->GetTimerManager();
+	if (!TimerManager.IsTimerActive(SettingsUpdateTimerHandle))
+	{
+		TimerManager.SetTimer(SettingsUpdateTimerHandle, this, &ThisClass::FlushSessionSettingsUpdate, SessionSettingsUpdateDebounce, false);
+	}
+}
+
+void UCustomSessionSubsystem::FlushSessionSettingsUpdate()
+{
+	if (const UGameInstance* GameInstance = GetGameInstance())
+	{
+		GameInstance->GetTimerManager().ClearTimer(SettingsUpdateTimerHandle);
+	}
+
+	// a completion may destroy sessions, the names are taken up front
+	TArray<FName> SessionNames;
+	NamedSessions.GenerateKeyArray(SessionNames);
+
+	bool bRetryLater = false;
+	for (const FName& SessionName : SessionNames)
+	{
+		// the completion of the running update sends what is pending
+		FCustomSessionNamedState* Named = NamedSessions.Find(SessionName);
+		if (Named == nullptr || Named->PendingSettingsChange.IsEmpty() || Named->bSettingsUpdateInFlight)
+		{
+			continue;
+		}
+
+		if (IsSessionBusy(SessionName))
+		{
+			bRetryLater = true;
+
+			continue;
+		}
+
+		ExecuteSessionSettingsUpdate(SessionName, *Named);
+	}
+
+	if (bRetryLater)
+	{
+		if (const UGameInstance* GameInstance = GetGameInstance())
+		{
+			GameInstance->GetTimerManager().SetTimer(SettingsUpdateTimerHandle, this, &ThisClass::FlushSessionSettingsUpdate,
+				FMath::Max(SessionSettingsUpdateDebounce, 0.1f), false);
+		}
+	}
+}
+
+void UCustomSessionSubsystem::ExecuteSessionSettingsUpdate(FName SessionName, FCustomSessionNamedState& Named)
+{
+	const FOnlineSessionSettings* CurrentSettings = OnlineSession.IsValid() ? OnlineSession->GetSessionSettings(SessionName) : nullptr;
+	if (CurrentSettings == nullptr)
+	{
+		Named.PendingSettingsChange = FCustomSessionSettingsChange();
+
+		return;
+	}
+
+	FOnlineSessionSettings UpdatedSettings = *CurrentSettings;
+	const TArray<FName> ChangedKeys = Named.PendingSettingsChange.ApplyTo(UpdatedSettings);
+	if (ChangedKeys.IsEmpty())
+	{
+		Named.PendingSettingsChange = FCustomSessionSettingsChange();
+		UE_LOG(LogCustomSessions, Verbose, TEXT("Session %s already has the requested settings"), *SessionName.ToString());
+
+		return;
+	}
+
+	CUSTOMSESSION_EVENT(Session, Verbose, "SessionSettingsUpdate", {TEXT("Session"), SessionName},
+		{TEXT("Keys"), FString::JoinBy(ChangedKeys, TEXT(","), [](const FName& Key) { return Key.ToString(); })});
+
+	// the settings are ours only once the backend took them, UpdateSessionCompleted commits or restores them
+	Named.InFlightSettingsChange = MoveTemp(Named.PendingSettingsChange);
+	Named.PendingSettingsChange = FCustomSessionSettingsChange();
+	Named.InFlightSettings = UpdatedSettings;
+	Named.PreviousSettings = *CurrentSettings;
+
+	// Named is not touched past this point, the backend may complete synchronously
+	Named.bSettingsUpdateInFlight = true;
+	BeginOperation(ECustomSessionOperation::Update, SessionName);
+	if (!OnlineSession->UpdateSession(SessionName, UpdatedSettings, true))
+	{
+		UpdateSessionCompleted(SessionName, false);
+	}
+}
+
+void UCustomSessionSubsystem::DestroySession(FName SessionName)
+{
+	SessionName = ResolveSessionName(SessionName);
+	if (IsOperationBlocked(ECustomSessionOperation::Destroy, SessionName))
+	{
+		EnqueueOperation(ECustomSessionOperation::Destroy, SessionName.ToString(), SessionName, [this, SessionName]()
+		{
+			DestroySession(SessionName);
+		});
+
+		return;
+	}
+
+	ExecuteDestroySession(SessionName);
+}
+
+TFuture<bool> UCustomSessionSubsystem::CreateSessionAsync(FName SessionName, int32 NumPublicConnections, const FString& MatchType)
+{
+	TFuture<bool> Future = AddWaiter(OperationWaiters, ECustomSessionOperation::Create, SessionName.ToString());
+	CreateSession(SessionName, NumPublicConnections, MatchType);
+
+	return Future;
+}
+
+TFuture<FCustomSessionFindResult> UCustomSessionSubsystem::FindSessionsAsync(const TArray<FCustomSessionSearchFilter>& Filters, int32 MaxSearchResults,
+																			  FName SessionName, const FString& MatchType)
+{
+	const FString SearchKey = MakeSearchCacheKey(MakeSearchFilters(Filters, MatchType), IsLanSubsystem());
+	TFuture<FCustomSessionFindResult> Future = AddWaiter(SearchWaiters, ECustomSessionOperation::Find, SearchKey);
+	FindSessionWithFilters(Filters, MaxSearchResults, SessionName, MatchType);
+
+	return Future;
+}
+
+TFuture<FCustomSessionJoinResult> UCustomSessionSubsystem::JoinSessionAsync(const FOnlineSessionSearchResult& SearchResult, FName SessionName)
+{
+	if (SessionName == NAME_None)
+	{
+		SessionName = SearchSessionName;
+	}
+
+	const uint32 RequestId = ++LastJoinRequestId;
+	TFuture<FCustomSessionJoinResult> Future = AddWaiter(JoinWaiters, ECustomSessionOperation::Join, SessionName.ToString(), RequestId);
+	ExecuteJoinSession(SearchResult, SessionName, RequestId);
+
+	return Future;
+}
+
+TFuture<FCustomSessionJoinResult> UCustomSessionSubsystem::JoinBestSessionAsync(const FCustomSessionSearchSnapshotRef& Snapshot,
+																				int32 RequiredConnections, FName SessionName)
+{
+	if (SessionName == NAME_None)
+	{
+		SessionName = SearchSessionName;
+	}
+
+	const uint32 RequestId = ++LastJoinRequestId;
+	TFuture<FCustomSessionJoinResult> Future = AddWaiter(JoinWaiters, ECustomSessionOperation::Join, SessionName.ToString(), RequestId);
+	if (!JoinBestSessionFrom(Snapshot, RequiredConnections, SessionName, RequestId))
+	{
+		ResolveRequestWaiter(JoinWaiters, RequestId, FCustomSessionJoinResult{EOnJoinSessionCompleteResult::SessionDoesNotExist, ECustomSessionResult::Failed});
+	}
+
+	return Future;
+}
+
+TFuture<bool> UCustomSessionSubsystem::StartSessionAsync(FName SessionName)
+{
+	SessionName = ResolveSessionName(SessionName);
+	TFuture<bool> Future = AddWaiter(OperationWaiters, ECustomSessionOperation::Start, SessionName.ToString());
+	StartSession(SessionName);
+
+	return Future;
+}
+
+TFuture<bool> UCustomSessionSubsystem::EndSessionAsync(FName SessionName)
+{
+	SessionName = ResolveSessionName(SessionName);
+	TFuture<bool> Future = AddWaiter(OperationWaiters, ECustomSessionOperation::End, SessionName.ToString());
+	EndSession(SessionName);
+
+	return Future;
+}
+
+TFuture<bool> UCustomSessionSubsystem::DestroySessionAsync(FName SessionName)
+{
+	SessionName = ResolveSessionName(SessionName);
+	TFuture<bool> Future = AddWaiter(OperationWaiters, ECustomSessionOperation::Destroy, SessionName.ToString());
+	DestroySession(SessionName);
+
+	return Future;
+}
+
+bool UCustomSessionSubsystem::ResolveConnectString(FString& OutConnectString, FName SessionName)
+{
+	if (!OnlineSession.IsValid())
+	{
+		return false;
+	}
+
+	SessionName = ResolveSessionName(SessionName);
+	BeginOperation(ECustomSessionOperation::Resolve, SessionName);
+	const bool bResolved = OnlineSession->GetResolvedConnectString(SessionName, OutConnectString);
+	EndOperation(ECustomSessionOperation::Resolve, bResolved, INDEX_NONE, SessionName);
+	if (bResolved && SessionName == ReservedSessionName)
+	{
+		OutConnectString += FString::Printf(TEXT("?%s=%s"), CustomSessionsApi::ReservationOption, *JoinReservationToken.ToString());
+	}
+
+	return bResolved;
+}
+
+ECustomSessionState UCustomSessionSubsystem::GetNamedSessionState(FName SessionName) const
+{
+	const FCustomSessionNamedState* Named = NamedSessions.Find(SessionName);
+
+	return Named != nullptr ? Named->State : ECustomSessionState::Idle;
+}
+
+TArray<FName> UCustomSessionSubsystem::GetNamedSessions() const
+{
+	TArray<FName> SessionNames;
+	NamedSessions.GenerateKeyArray(SessionNames);
+
+	return SessionNames;
+}
+
+bool UCustomSessionSubsystem::IsSessionBusy(FName SessionName) const
+{
+	const ECustomSessionState NamedState = GetNamedSessionState(SessionName);
+
+	return NamedState != ECustomSessionState::Idle && NamedState != ECustomSessionState::InSession;
+}
+
+TSharedPtr<FOnlineSessionSettings> UCustomSessionSubsystem::GetSessionSettings(FName SessionName) const
+{
+	const FCustomSessionNamedState* Named = NamedSessions.Find(ResolveSessionName(SessionName));
+
+	return Named != nullptr ? Named->Settings : nullptr;
+}
+
+FCustomSessionOperationStats UCustomSessionSubsystem::GetOperationStats(ECustomSessionOperation Operation) const
+{
+	const FCustomSessionOperationRecorder* Recorder = OperationRecorders.Find(Operation);
+
+	return Recorder != nullptr ? Recorder->ToStats() : FCustomSessionOperationStats();
+}
+
+void UCustomSessionSubsystem::ResetOperationStats()
+{
+	for (TPair<ECustomSessionOperation, FCustomSessionOperationRecorder>& Recorder : OperationRecorders)
+	{
+		Recorder.Value.Reset();
+	}
+}
+
+void UCustomSessionSubsystem::BeginOperation(ECustomSessionOperation Operation, FName SessionName)
+{
+	OperationRecorders.FindOrAdd(Operation).Begin(Operation, SessionName);
+}
+
+void UCustomSessionSubsystem::EndOperation(ECustomSessionOperation Operation, bool bWasSuccessful, int32 NumResults, FName SessionName)
+{
+	FCustomSessionOperationRecorder& Recorder = OperationRecorders.FindOrAdd(Operation);
+	if (Recorder.End(Operation, bWasSuccessful, NumResults, SessionName))
+	{
+		UE_LOG(LogCustomSessions, Verbose, TEXT("%s %s took %.1fms"), *UEnum::GetValueAsString(Operation), *SessionName.ToString(), Recorder.ToStats().LastMs);
+	}
+}
+
+void UCustomSessionSubsystem::ExecuteDestroySession(FName SessionName)
+{
+	SetSessionState(SessionName, ECustomSessionState::Destroying);
+	if (!OnlineSession.IsValid())
+	{
+		DestroySessionCompleted(SessionName, false);
+
+		return;
+	}
+
+	BeginOperation(ECustomSessionOperation::Destroy, SessionName);
+	if (!OnlineSession->DestroySession(SessionName))
+	{
+		DestroySessionCompleted(SessionName, false);
+	}
+}
+
+ECustomSessionState UCustomSessionSubsystem::GetSettledState(FName SessionName) const
+{
+	const bool bHasSession = OnlineSession.IsValid() && SessionName != NAME_None && OnlineSession->GetNamedSession(SessionName) != nullptr;
+
+	return bHasSession ? ECustomSessionState::InSession : ECustomSessionState::Idle;
+}
+
+bool UCustomSessionSubsystem::IsWarmSession(FName SessionName) const
+{
+	return SessionName != NAME_None && (SessionName == WarmSessionName || (bCreatingWarmSession && SessionName == PrewarmSessionName));
+}
+
+void UCustomSessionSubsystem::SetSessionState(FName SessionName, ECustomSessionState NewState)
+{
+	FCustomSessionNamedState* Named = NamedSessions.Find(SessionName);
+	const ECustomSessionState OldState = Named != nullptr ? Named->State : ECustomSessionState::Idle;
+	if (NewState == ECustomSessionState::Idle)
+	{
+		// a session that settled back to idle is gone, along with its settings and pending changes
+		NamedSessions.Remove(SessionName);
+	}
+	else
+	{
+		NamedSessions.FindOrAdd(SessionName).State = NewState;
+	}
+
+	if (OldState == NewState)
+	{
+		return;
+	}
+
+	UE_LOG(LogCustomSessions, Verbose, TEXT("Custom session %s state %s -> %s"), *SessionName.ToString(),
+		*UEnum::GetValueAsString(OldState), *UEnum::GetValueAsString(NewState));
+
+	if (!IsWarmSession(SessionName))
+	{
+		OnCustomSessionNamedStateChanged.Broadcast(SessionName, NewState);
+	}
+
+	RefreshState();
+}
+
+void UCustomSessionSubsystem::RefreshState()
+{
+	ECustomSessionState NewState = ECustomSessionState::Idle;
+	bool bInSession = false;
+	for (const TPair<FName, FCustomSessionNamedState>& Named : NamedSessions)
+	{
+		// the warm session is not hosted by anyone yet, as far as callers are concerned there is no session
+		if (IsWarmSession(Named.Key))
+		{
+			continue;
+		}
+
+		if (Named.Value.State == ECustomSessionState::InSession)
+		{
+			bInSession = true;
+		}
+		else if (Named.Value.State != ECustomSessionState::Idle)
+		{
+			NewState = Named.Value.State;
+			break;
+		}
+	}
+
+	if (NewState == ECustomSessionState::Idle)
+	{
+		NewState = IsSearching() ? ECustomSessionState::Searching : bInSession ? ECustomSessionState::InSession : ECustomSessionState::Idle;
+	}
+
+	if (State == NewState)
+	{
+		return;
+	}
+
+	UE_LOG(LogCustomSessions, Verbose, TEXT("Custom session state %s -> %s"), *UEnum::GetValueAsString(State), *UEnum::GetValueAsString(NewState));
+	State = NewState;
+	OnCustomSessionStateChanged.Broadcast(NewState);
+}
+
+bool UCustomSessionSubsystem::IsOperationBlocked(ECustomSessionOperation Operation, FName SessionName) const
+{
+	switch (Operation)
+	{
+		case ECustomSessionOperation::Find:
+		{
+			return IsSearching() || IsJoining();
+		}
+
+		// joining off results that are still coming in would pick from half a list
+		case ECustomSessionOperation::Join:
+		{
+			return IsSearching() || IsJoining() || IsSessionBusy(SessionName) || AbandonedJoins.Contains(SessionName);
+		}
+
+		// a late answer to a join given up on would take the name
+		case ECustomSessionOperation::Create:
+		{
+			return IsSessionBusy(SessionName) || AbandonedJoins.Contains(SessionName);
+		}
+
+		default:
+		{
+			return IsSessionBusy(SessionName);
+		}
+	}
+}
+
+void UCustomSessionSubsystem::EnqueueOperation(ECustomSessionOperation Operation, const FString& Key, FName SessionName, TFunction<void()>&& Execute,
+	uint32 RequestId)
+{
+	const int32 ExistingIndex = PendingOperations.IndexOfByPredicate([Operation, &Key](const FCustomSessionPendingOperation& Pending)
+	{
+		return Pending.Operation == Operation && Pending.Key == Key;
+	});
+
+	switch (Operation)
+	{
+		// the same search or destroy already queued serves this caller too, listeners share the broadcast
+		case ECustomSessionOperation::Find:
+		case ECustomSessionOperation::Destroy:
+		case ECustomSessionOperation::Start:
+		case ECustomSessionOperation::End:
+		{
+			if (ExistingIndex != INDEX_NONE)
+			{
+				UE_LOG(LogCustomSessions, Verbose, TEXT("Merged a queued %s request"), *UEnum::GetValueAsString(Operation));
+
+				return;
+			}
+		}
+		break;
+
+		// only the latest create or join of a session matters, it replaces the queued one in place
+		case ECustomSessionOperation::Create:
+		case ECustomSessionOperation::Join:
+		{
+			if (ExistingIndex != INDEX_NONE)
+			{
+				FCustomSessionPendingOperation& Existing = PendingOperations[ExistingIndex];
+				const FName ReplacedSessionName = Existing.SessionName;
+				const uint32 ReplacedRequestId = Existing.RequestId;
+				Existing.SessionName = SessionName;
+				Existing.Execute = MoveTemp(Execute);
+				Existing.RequestId = RequestId;
+
+				// the replaced join never runs, neither its future nor the delegate listeners may wait for it
+				if (Operation == ECustomSessionOperation::Join)
+				{
+					BroadcastJoinCompleted(ReplacedSessionName, EOnJoinSessionCompleteResult::UnknownError, ReplacedRequestId, ECustomSessionResult::Cancelled);
+				}
+
+				return;
+			}
+
+			// creating destroys any existing session with that name already
+			if (Operation == ECustomSessionOperation::Create && !PendingOperations.IsEmpty()
+				&& PendingOperations.Last().Operation == ECustomSessionOperation::Destroy && PendingOperations.Last().Key == Key)
+			{
+				PendingOperations.Pop();
+			}
+		}
+		break;
+
+		default:
+		break;
+	}
+
+	PendingOperations.Add(FCustomSessionPendingOperation{Operation, Key, SessionName, MoveTemp(Execute), RequestId});
+}
+
+void UCustomSessionSubsystem::ProcessPendingOperations()
+{
+	if (bProcessingOperations)
+	{
+		return;
+	}
+
+	// requests on different sessions do not wait for each other, the first one free to run goes
+	TGuardValue<bool> ProcessingGuard(bProcessingOperations, true);
+	for (int32 Index = 0; Index < PendingOperations.Num();)
+	{
+		if (IsOperationBlocked(PendingOperations[Index].Operation, PendingOperations[Index].SessionName))
+		{
+			++Index;
+
+			continue;
+		}
+
+		const FCustomSessionPendingOperation Pending = MoveTemp(PendingOperations[Index]);
+		PendingOperations.RemoveAt(Index);
+		Pending.Execute();
+
+		// running it may have blocked or queued anything, requests keep their order within a session
+		Index = 0;
+	}
+}
+
+void UCustomSessionSubsystem::CreateSessionCompleted(FName SessionName, bool bWasSuccessful)
+{
+	// the delegate stays bound, it fires for sessions created by anyone on this backend
+	const FCustomSessionNamedState* Named = NamedSessions.Find(SessionName);
+	if (Named == nullptr || Named->State != ECustomSessionState::Creating)
+	{
+		return;
+	}
+
+	if (bCreatingWarmSession && SessionName == PrewarmSessionName)
+	{
+		// nobody asked for this one, it waits for CreateSession without telling anyone
+		WarmSessionName = bWasSuccessful ? SessionName : NAME_None;
+		CUSTOMSESSION_EVENT(Session, Log, "WarmSessionCreated", {TEXT("Session"), SessionName}, {TEXT("Success"), bWasSuccessful});
+		SetSessionState(SessionName, GetSettledState(SessionName));
+		bCreatingWarmSession = false;
+		ProcessPendingOperations();
+
+		return;
+	}
+
+	EndOperation(ECustomSessionOperation::Create, bWasSuccessful, INDEX_NONE, SessionName);
+
+	if (bWasSuccessful)
+	{
+		CUSTOMSESSION_EVENT(Session, Log, "SessionCreated", {TEXT("Session"), SessionName});
+	}
+	else
+	{
+		CUSTOMSESSION_EVENT(Session, Error, "SessionCreateFailed", {TEXT("Session"), SessionName});
+	}
+
+	CurrentGameSession = SessionName;
+	SetSessionState(SessionName, GetSettledState(SessionName));
+	BroadcastOperationCompleted(ECustomSessionOperation::Create, SessionName, bWasSuccessful);
+	ProcessPendingOperations();
+}
+
+void UCustomSessionSubsystem::FindSessionCompleted(bool bWasSuccessful)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UCustomSessionSubsystem::FindSessionCompleted);
+
+	if (const UGameInstance* GameInstance = GetGameInstance())
+	{
+		GameInstance->GetTimerManager().ClearTimer(FindSessionsTimerHandle);
+	}
+
+	if (OnlineSession)
+	{
+		OnlineSession->ClearOnFindSessionsCompleteDelegate_Handle(FindSessionsCompleteDelegate_Handle);
+	}
+
+	FindSessionsCompleteDelegate_Handle.Reset();
+
+	if (!SessionSearch.IsValid())
+	{
+		bInFlightSearchIsBackground = false;
+		RefreshState();
+		EndOperation(ECustomSessionOperation::Find, false);
+		BroadcastFindCompleted(InFlightSearchKey, FCustomSessionSearchSnapshot::Empty(), false);
+		ProcessPendingOperations();
+
+		return;
+	}
+
+	if (bWasSuccessful)
+	{
+		FilterSearchResultsLocally();
+	}
+	else if (!NarrowerScopeResults.IsEmpty())
+	{
+		// widening failed, what was found closer by is still worth joining
+		SessionSearch->SearchResults = MoveTemp(NarrowerScopeResults);
+		bWasSuccessful = true;
+	}
+
+	if (bWasSuccessful && WidenSearch())
+	{
+		return;
+	}
+
+	NarrowerScopeResults.Reset();
+	LastSearchScope = SearchScope;
+
+	const bool bWasBackgroundRefresh = bInFlightSearchIsBackground;
+	bInFlightSearchIsBackground = false;
+
+	FCustomSessionSearchSnapshotRef Snapshot = FCustomSessionSearchSnapshot::Empty();
+	if (bWasSuccessful)
+	{
+		Snapshot = MakeSnapshot(MoveTemp(SessionSearch->SearchResults));
+		AddToSearchCache(InFlightSearchKey, Snapshot);
+	}
+
+	EndOperation(ECustomSessionOperation::Find, bWasSuccessful, Snapshot->Num());
+
+	// the results now live in the snapshot, the search object is of no use to anyone
+	SessionSearch.Reset();
+	RefreshState();
+
+	// callers were already served from the cache, the refreshed entry is for the next ones
+	if (!bWasBackgroundRefresh)
+	{
+		BroadcastSearchResults(InFlightSearchKey, Snapshot, bWasSuccessful);
+	}
+
+	ProcessPendingOperations();
+}
+
+void UCustomSessionSubsystem::BroadcastSearchResults(const FString& SearchKey, const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful)
+{
+	if (IsJoining())
+	{
+		BroadcastFindCompleted(SearchKey, FCustomSessionSearchSnapshot::Empty(), false);
+
+		return;
+	}
+
+	if (!bWasSuccessful)
+	{
+		CUSTOMSESSION_EVENT(Search, Warning, "SearchFailed", {TEXT("MatchType"), CurrentMatchType});
+
+		BroadcastFindCompleted(SearchKey, FCustomSessionSearchSnapshot::Empty(), false);
+
+		return;
+	}
+
+	if (Snapshot->IsEmpty())
+	{
+		CUSTOMSESSION_EVENT(Search, Log, "NoSessionsFound", {TEXT("MatchType"), CurrentMatchType});
+
+		BroadcastFindCompleted(SearchKey, Snapshot, false);
+
+		return;
+	}
+
+	LastSnapshot = Snapshot;
+	CUSTOMSESSION_EVENT(Search, Log, "SessionsFound", {TEXT("MatchType"), CurrentMatchType}, {TEXT("Results"), Snapshot->Num()},
+		{TEXT("Generation"), static_cast<int64>(Snapshot->GetGeneration())});
+	BroadcastFindCompleted(SearchKey, Snapshot, true);
+}
+
+void UCustomSessionSubsystem::BroadcastOperationCompleted(ECustomSessionOperation Operation, FName SessionName, bool bWasSuccessful)
+{
+	ResolveWaiters(OperationWaiters, Operation, SessionName.ToString(), bWasSuccessful);
+
+	switch (Operation)
+	{
+		case ECustomSessionOperation::Create:
+		{
+			OnCustomSessionCreateSessionCompleted.Broadcast(bWasSuccessful);
+		}
+		break;
+
+		case ECustomSessionOperation::Start:
+		{
+			OnCustomSessionStartSessionCompleted.Broadcast(bWasSuccessful);
+		}
+		break;
+
+		case ECustomSessionOperation::End:
+		{
+			OnCustomSessionEndSessionCompleted.Broadcast(bWasSuccessful);
+		}
+		break;
+
+		case ECustomSessionOperation::Destroy:
+		{
+			OnCustomSessionDestroySessionCompleted.Broadcast(bWasSuccessful);
+		}
+		break;
+
+		case ECustomSessionOperation::Update:
+		{
+			OnCustomSessionUpdateSessionCompleted.Broadcast(bWasSuccessful);
+		}
+		break;
+
+		default:
+		break;
+	}
+}
+
+void UCustomSessionSubsystem::BroadcastFindCompleted(const FString& SearchKey, const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful,
+	ECustomSessionResult FailureReason)
+{
+	const ECustomSessionResult Result = bWasSuccessful ? ECustomSessionResult::Success : FailureReason;
+	ResolveWaiters(SearchWaiters, ECustomSessionOperation::Find, SearchKey, FCustomSessionFindResult{Snapshot, bWasSuccessful, Result});
+	OnCustomSessionFindSessionsCompleted.Broadcast(Snapshot, bWasSuccessful);
+}
+
+void UCustomSessionSubsystem::BroadcastJoinCompleted(FName SessionName, EOnJoinSessionCompleteResult::Type JoinResult, uint32 RequestId,
+	ECustomSessionResult Result)
+{
+	ResolveRequestWaiter(JoinWaiters, RequestId, FCustomSessionJoinResult{JoinResult, Result});
+	OnCustomsessionJoinSessionCompleted.Broadcast(JoinResult);
+}
+
+FString UCustomSessionSubsystem::GetSearchKey(const TArray<FCustomSessionSearchFilter>& Filters, const FString& MatchType) const
+{
+	return MakeSearchCacheKey(MakeSearchFilters(Filters, MatchType), IsLanSubsystem());
+}
+
+TArray<FCustomSessionSearchFilter> UCustomSessionSubsystem::MakeSearchFilters(const TArray<FCustomSessionSearchFilter>& Filters, const FString& MatchType) const
+{
+	TArray<FCustomSessionSearchFilter> SearchFilters;
+	SearchFilters.Reserve(Filters.Num() + 3);
+	if (!MatchType.IsEmpty())
+	{
+		SearchFilters.Emplace(CustomSessionsApi::MatchTypeKey, MatchType);
+	}
+
+	if (bFilterSearchByBuild)
+	{
+		SearchFilters.Emplace(CustomSessionsApi::BuildKey, GetSessionBuildUniqueId());
+	}
+
+	SearchFilters.Append(Filters);
+
+	return SearchFilters;
+}
+
+FCustomSessionSearchSnapshotRef UCustomSessionSubsystem::MakeSnapshot(TArray<FOnlineSessionSearchResult>&& Results)
+{
+	return MakeShared<const FCustomSessionSearchSnapshot, ESPMode::ThreadSafe>(MoveTemp(Results), ++SearchGeneration, FPlatformTime::Seconds());
+}
+
+FString UCustomSessionSubsystem::MakeSearchCacheKey(const TArray<FCustomSessionSearchFilter>& Filters, bool bIsLanQuery)
+{
+	FString Key = bIsLanQuery ? TEXT("LAN") : TEXT("Online");
+	for (const FCustomSessionSearchFilter& Filter : Filters)
+	{
+		Key += TEXT("|");
+		Key += Filter.ToString();
+	}
+
+	return Key;
+}
+
+void UCustomSessionSubsystem::AddToSearchCache(const FString& SearchKey, const FCustomSessionSearchSnapshotRef& Snapshot)
+{
+	const double Now = FPlatformTime::Seconds();
+	for (auto It = SearchCache.CreateIterator(); It; ++It)
+	{
+		if (Now - It.Value()->GetCompletedTime() > FMath::Max(SearchCacheTimeToLive, SearchCacheMaxStaleAge))
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// nothing found is no answer worth repeating, the next caller asks the backend again
+	if (Snapshot->IsEmpty() || (SearchCacheTimeToLive <= 0.0f && SearchCacheMaxStaleAge <= 0.0f))
+	{
+		SearchCache.Remove(SearchKey);
+
+		return;
+	}
+
+	SearchCache.Add(SearchKey, Snapshot);
+}
+
+bool UCustomSessionSubsystem::IsDedicatedServer() const
+{
+	const UWorld* World = GetWorld();
+
+	return IsRunningDedicatedServer() || (IsValid(World) && World->GetNetMode() == NM_DedicatedServer);
+}
+
+FUniqueNetIdPtr UCustomSessionSubsystem::GetLocalUserId() const
+{
+	const UWorld* World = GetWorld();
+	const ULocalPlayer* LocalPlayer = IsValid(World) ? World->GetFirstLocalPlayerFromController() : nullptr;
+	if (IsValid(LocalPlayer))
+	{
+		return LocalPlayer->GetPreferredUniqueNetId().GetUniqueNetId();
+	}
+
+	// nobody has to sign in to the mock, e.g. a game instance created by an automation test has no player
+	return bUsingMockBackend && !IsDedicatedServer() ? FCustomSessionMockSession::MakeLocalUserId(0) : nullptr;
+}
+
+bool UCustomSessionSubsystem::IsLanSubsystem() const
+{
+	if (bUsingMockBackend)
+	{
+		return false;
+	}
+
+	const IOnlineSubsystem* OnlineSubsystem = IOnlineSubsystem::Get();
+
+	return OnlineSubsystem != nullptr && OnlineSubsystem->GetSubsystemName().IsEqual(NULL_SUBSYSTEM);
+}
+
+bool UCustomSessionSubsystem::CanFilterSearchOnBackend() const
+{
+	// the mock backend applies the query settings itself, like Steam does
+	return bUsingMockBackend || (IOnlineSubsystem::Get() != nullptr && !IsLanSubsystem());
+}
+
+bool UCustomSessionSubsystem::IsFilterAppliedByBackend(const FCustomSessionSearchFilter& Filter) const
+{
+	return CanFilterSearchOnBackend() && (bUsingMockBackend || !Filter.IsListComparison());
+}
+
+void UCustomSessionSubsystem::FilterSearchResultsLocally()
+{
+	LastDiscardedSearchResults = 0;
+	const TArray<FCustomSessionSearchFilter> LocalFilters = ActiveSearchFilters.FilterByPredicate([this](const FCustomSessionSearchFilter& Filter)
+	{
+		return !IsFilterAppliedByBackend(Filter);
+	});
+
+	if (!SessionSearch.IsValid() || LocalFilters.IsEmpty())
+	{
+		return;
+	}
+
+	LastDiscardedSearchResults = FilterSearchResults(SessionSearch->SearchResults, LocalFilters);
+	TotalDiscardedSearchResults += LastDiscardedSearchResults;
+	UE_LOG(LogCustomSessions, Verbose, TEXT("Discarded %d of %d search results locally (%lld in total)"),
+		LastDiscardedSearchResults, SessionSearch->SearchResults.Num() + LastDiscardedSearchResults, TotalDiscardedSearchResults);
+}
+
+void UCustomSessionSubsystem::JoinSessionCompleted(FName SessionName, EOnJoinSessionCompleteResult::Type JoinResult)
+{
+	++JoinCompletionCount;
+	if (const UGameInstance* GameInstance = GetGameInstance())
+	{
+		GameInstance->GetTimerManager().ClearTimer(JoinAttemptTimerHandle);
+	}
+
+	if (!OnlineSession)
+	{
+		UE_LOG(LogCustomSessions, Error, TEXT("Join of %s completed without a valid OSS"), *JoinSessionName.ToString());
+		FinishJoin(EOnJoinSessionCompleteResult::UnknownError);
+
+		return;
+	}
+
+	OnlineSession->ClearOnJoinSessionCompleteDelegate_Handle(JoinSessionCompleteDelegate_Handle);
+	JoinSessionCompleteDelegate_Handle.Reset();
+
+	if (JoinResult == EOnJoinSessionCompleteResult::Success)
+	{
+		CurrentGameSession = SessionName;
+		FinishJoin(JoinResult);
+
+		return;
+	}
+
+	// the name is held by a session we created or joined before, every candidate would fail the same and it is not ours to destroy
+	if (JoinResult == EOnJoinSessionCompleteResult::AlreadyInSession)
+	{
+		FinishJoin(JoinResult);
+
+		return;
+	}
+
+	// a failed join means the cached lobbies are no longer what the backend has
+	InvalidateSearchCache();
+	ReleaseSlotReservation();
+
+	const bool bHasMoreCandidates = JoinCandidates.IsValidIndex(NextJoinCandidate) && FPlatformTime::Seconds() < JoinDeadline;
+	if (bHasMoreCandidates && OnlineSession->GetNamedSession(SessionName) != nullptr)
+	{
+		// some backends keep the half joined session around, the next attempt would fail with AlreadyInSession
+		const bool bDestroying = OnlineSession->DestroySession(SessionName, FOnDestroySessionCompleteDelegate::CreateWeakLambda(this,
+			[this, JoinResult, Serial = JoinSerial](FName, bool)
+			{
+				// the join may have been cancelled meanwhile
+				if (IsJoining() && Serial == JoinSerial)
+				{
+					TryNextJoinCandidate(JoinResult);
+				}
+			}));
+
+		if (bDestroying)
+		{
+			return;
+		}
+	}
+
+	TryNextJoinCandidate(JoinResult);
+}
+
+void UCustomSessionSubsystem::UpdateSessionCompleted(FName SessionName, bool bWasSuccessful)
+{
+	FCustomSessionNamedState* Named = NamedSessions.Find(SessionName);
+	if (Named == nullptr)
+	{
+		return;
+	}
+
+	// a warm session being promoted is the only update sent while the session is being created
+	if (Named->State == ECustomSessionState::Creating)
+	{
+		EndOperation(ECustomSessionOperation::Create, bWasSuccessful, INDEX_NONE, SessionName);
+		if (!bWasSuccessful)
+		{
+			UE_LOG(LogCustomSessions, Warning, TEXT("Could not promote the warm session %s, creating it again"), *SessionName.ToString());
+			FString MatchType;
+			int32 NumPublicConnections = 0;
+			if (Named->Settings.IsValid())
+			{
+				Named->Settings->Get(CustomSessionsApi::MatchTypeKey, MatchType);
+				NumPublicConnections = Named->Settings->NumPublicConnections;
+			}
+
+			ExecuteCreateSession(SessionName, NumPublicConnections, MatchType, false);
+
+			return;
+		}
+
+		CUSTOMSESSION_EVENT(Session, Log, "SessionCreated", {TEXT("Session"), SessionName}, {TEXT("Warm"), true});
+		SetSessionState(SessionName, GetSettledState(SessionName));
+		BroadcastOperationCompleted(ECustomSessionOperation::Create, SessionName, true);
+		ProcessPendingOperations();
+
+		return;
+	}
+
+	if (!Named->bSettingsUpdateInFlight)
+	{
+		return;
+	}
+
+	Named->bSettingsUpdateInFlight = false;
+	const bool bHasPendingChange = !Named->PendingSettingsChange.IsEmpty();
+	if (bWasSuccessful)
+	{
+		if (!Named->Settings.IsValid())
+		{
+			Named->Settings = MakeShared<FOnlineSessionSettings>();
+		}
+
+		*Named->Settings = Named->InFlightSettings.GetValue();
+	}
+	else
+	{
+		UE_LOG(LogCustomSessions, Warning, TEXT("Failed to update the settings of session %s"), *SessionName.ToString());
+
+		// backends apply the settings when asked, the session advertises what it had until the change goes out again
+		FOnlineSessionSettings* BackendSettings = OnlineSession.IsValid() ? OnlineSession->GetSessionSettings(SessionName) : nullptr;
+		if (BackendSettings != nullptr)
+		{
+			*BackendSettings = Named->PreviousSettings.GetValue();
+		}
+
+		FCustomSessionSettingsChange RequeuedChange = MoveTemp(Named->InFlightSettingsChange);
+		RequeuedChange.Merge(Named->PendingSettingsChange);
+		Named->PendingSettingsChange = MoveTemp(RequeuedChange);
+	}
+
+	Named->InFlightSettingsChange = FCustomSessionSettingsChange();
+	Named->InFlightSettings.Reset();
+	Named->PreviousSettings.Reset();
+	EndOperation(ECustomSessionOperation::Update, bWasSuccessful, INDEX_NONE, SessionName);
+
+	BroadcastOperationCompleted(ECustomSessionOperation::Update, SessionName, bWasSuccessful);
+
+	// whatever changed while this one was in flight goes out in the next window
+	if (bHasPendingChange)
+	{
+		ScheduleSessionSettingsUpdate();
+	}
+}
+
+void UCustomSessionSubsystem::StartSessionCompleted(FName SessionName, bool bWasSuccessful)
+{
+	if (GetNamedSessionState(SessionName) != ECustomSessionState::Starting)
+	{
+		return;
+	}
+
+	EndOperation(ECustomSessionOperation::Start, bWasSuccessful, INDEX_NONE, SessionName);
+	if (!bWasSuccessful)
+	{
+		UE_LOG(LogCustomSessions, Warning, TEXT("Failed to start session %s"), *SessionName.ToString());
+	}
+
+	SetSessionState(SessionName, GetSettledState(SessionName));
+	BroadcastOperationCompleted(ECustomSessionOperation::Start, SessionName, bWasSuccessful);
+	ProcessPendingOperations();
+}
+
+void UCustomSessionSubsystem::EndSessionCompleted(FName SessionName, bool bWasSuccessful)
+{
+	if (GetNamedSessionState(SessionName) != ECustomSessionState::Ending)
+	{
+		return;
+	}
+
+	EndOperation(ECustomSessionOperation::End, bWasSuccessful, INDEX_NONE, SessionName);
+	SetSessionState(SessionName, GetSettledState(SessionName));
+	BroadcastOperationCompleted(ECustomSessionOperation::End, SessionName, bWasSuccessful);
+	ProcessPendingOperations();
+}
+
+void UCustomSessionSubsystem::DestroySessionCompleted(FName SessionName, bool bWasSuccessful)
+{
+	// a join retry destroys the half joined session on its own, that one is still Joining here
+	if (GetNamedSessionState(SessionName) != ECustomSessionState::Destroying)
+	{
+		return;
+	}
+
+	EndOperation(ECustomSessionOperation::Destroy, bWasSuccessful, INDEX_NONE, SessionName);
+	SetSessionState(SessionName, GetSettledState(SessionName));
+	BroadcastOperationCompleted(ECustomSessionOperation::Destroy, SessionName, bWasSuccessful);
+	ProcessPendingOperations();
+}
+
+bool FCustomSessionSettingsChange::IsEmpty() const
+{
+	return !bOverride_NumPublicConnections && !bOverride_MatchType && !bOverride_AllowJoinInProgress && !bOverride_ShouldAdvertise && Values.IsEmpty();
+}
+
+void FCustomSessionSettingsChange::Merge(const FCustomSessionSettingsChange& Newer)
+{
+	if (Newer.bOverride_NumPublicConnections)
+	{
+		bOverride_NumPublicConnections = true;
+		NumPublicConnections = Newer.NumPublicConnections;
+	}
+
+	if (Newer.bOverride_MatchType)
+	{
+		bOverride_MatchType = true;
+		MatchType = Newer.MatchType;
+	}
+
+	if (Newer.bOverride_AllowJoinInProgress)
+	{
+		bOverride_AllowJoinInProgress = true;
+		bAllowJoinInProgress = Newer.bAllowJoinInProgress;
+	}
+
+	if (Newer.bOverride_ShouldAdvertise)
+	{
+		bOverride_ShouldAdvertise = true;
+		bShouldAdvertise = Newer.bShouldAdvertise;
+	}
+
+	Values.Append(Newer.Values);
+}
+
+TArray<FName> FCustomSessionSettingsChange::ApplyTo(FOnlineSessionSettings& Settings) const
+{
+	TArray<FName> ChangedKeys;
+	if (bOverride_NumPublicConnections && Settings.NumPublicConnections != NumPublicConnections)
+	{
+		Settings.NumPublicConnections = NumPublicConnections;
+		ChangedKeys.Add(TEXT("NumPublicConnections"));
+	}
+
+	if (bOverride_AllowJoinInProgress && Settings.bAllowJoinInProgress != bAllowJoinInProgress)
+	{
+		Settings.bAllowJoinInProgress = bAllowJoinInProgress;
+		ChangedKeys.Add(TEXT("AllowJoinInProgress"));
+	}
+
+	if (bOverride_ShouldAdvertise && Settings.bShouldAdvertise != bShouldAdvertise)
+	{
+		Settings.bShouldAdvertise = bShouldAdvertise;
+		ChangedKeys.Add(TEXT("ShouldAdvertise"));
+	}
+
+	const auto ApplyValue = [&Settings, &ChangedKeys](const FName Key, const FString& Value)
+	{
+		FString CurrentValue;
+		if (Settings.Get(Key, CurrentValue) && CurrentValue == Value)
+		{
+			return;
+		}
+
+		Settings.Set(Key, Value, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+		ChangedKeys.Add(Key);
+	};
+
+	if (bOverride_MatchType)
+	{
+		ApplyValue(CustomSessionsApi::MatchTypeKey, MatchType);
+	}
+
+	for (const TPair<FName, FString>& Value : Values)
 	{
-		OnlineSession->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegate_Handle);
-		OnlineSession->ClearOnDestroySessionCompleteDelegate_Handle(DestroySessionCompleteDelegateLambda_Handle);
-		OnDestroySessionCompleteLambdaDelegate.Unbind();
+		ApplyValue(Value.Key, Value.Value);
 	}
 
-	OnCustomSessionDestroySessionCompleted.Broadcast(bWasSuccessful);
+	return ChangedKeys;
 }
@@ -2,6 +2,8 @@
 
 
 #include "MenuWidget.h"
+#include "CustomSessionBrowserWidget.h"
+#include "CustomSessionDiagnostics.h"
 #include "CustomSessionSubsystem.h"
 #include "OnlineSessionSettings.h"
 #include "Components/Button.h"
@@ -18,6 +20,10 @@ void UMenuWidget::MenuSetup()
 	if (IsValid(World))
 	{
 		CustomSessionSubsystem = World->GetGameInstance()->GetSubsystem<UCustomSessionSubsystem>();
+		if (IsValid(CustomSessionSubsystem))
+		{
+			CustomSessionSubsystem->PrewarmHostSession();
+		}
 
 		APlayerController* PlayerController = World->GetFirstPlayerController();
 		if (IsValid(PlayerController))
@@ -64,17 +70,25 @@ void UMenuWidget::EnableDisableInputs(bool bEnable)
 	{
 		SpinBox_NumConnections->SetIsEnabled(bEnable);
 	}
+
+	if (IsValid(SessionBrowser))
+	{
+		SessionBrowser->SetIsEnabled(bEnable);
+	}
 }
 
 void UMenuWidget::ButtonHostClicked()
 {
-	if (GEngine)
-	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, FString(TEXT("Hosting Game...")));
-	}
+	CUSTOMSESSION_EVENT(UI, Log, "HostClicked");
 
 	if (IsValid(CustomSessionSubsystem) && SpinBox_NumConnections && EditableTextBox_MatchType)
 	{
+		// loads while the backend creates the session, the travel then finds it in memory
+		if (!LobbyMap.IsEmpty())
+		{
+			CustomSessionSubsystem->PreloadMap(LobbyMap);
+		}
+
 		CustomSessionSubsystem->OnCustomSessionCreateSessionCompleted.AddUniqueDynamic(this, &ThisClass::OnHostCreated);
 		CustomSessionSubsystem->CreateSession(NAME_GameSession,
 			static_cast<uint8>(SpinBox_NumConnections->Value), 
@@ -94,26 +108,32 @@ void UMenuWidget::OnHostCreated_Implementation(bool bWasSuccessful)
 	}
 
 	UWorld* World = GetWorld();
-	if (!IsValid(World))
+	if (!bWasSuccessful || !IsValid(World))
 	{
 		return;
 	}
 
+	// a standalone world can't travel seamlessly, becoming a listen server needs the full map load
 	World->ServerTravel(LobbyMap + "?listen");
 }
 
 void UMenuWidget::ButtonJoinClicked()
 {
-	if (GEngine)
-	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Yellow, FString(TEXT("Finding and Joining game...")));
-	}
+	CUSTOMSESSION_EVENT(UI, Log, "JoinClicked");
 
 	if (IsValid(CustomSessionSubsystem) && EditableTextBox_MatchType)
 	{
-		CustomSessionSubsystem->OnCustomSessionFindSessionsCompleted.AddUObject(this, &ThisClass::OnFindSessionCompleted);
-		CustomSessionSubsystem->FindSession(MaxSearchResults, NAME_GameSession, EditableTextBox_MatchType->GetText().ToString());
+		// searches started by anyone else complete on the public delegate, the menu only joins from its own
 		EnableDisableInputs(false);
+		CustomSessionSubsystem->FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), MaxSearchResults, NAME_GameSession,
+			EditableTextBox_MatchType->GetText().ToString())
+			.Next([WeakThis = TWeakObjectPtr<ThisClass>(this)](const FCustomSessionFindResult& FindResult)
+			{
+				if (ThisClass* This = WeakThis.Get())
+				{
+					This->OnFindSessionCompleted(FindResult.Snapshot, FindResult.bWasSuccessful);
+				}
+			});
 	}
 }
 
@@ -121,12 +141,7 @@ void UMenuWidget::OnHostJoined_Implementation(bool bWasSuccessful, const FString
 {
 	EnableDisableInputs(!bWasSuccessful);
 
-	if (GEngine)
-	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Emerald,
-			FString::Printf(TEXT("Joined, travel address: %s..."), 
-			*Address));
-	}
+	CUSTOMSESSION_EVENT(UI, Log, "TravelToHost", {TEXT("Success"), bWasSuccessful}, {TEXT("Address"), Address});
 
 	const UWorld* World = GetWorld();
 	if (!IsValid(World))
@@ -143,77 +158,70 @@ void UMenuWidget::OnHostJoined_Implementation(bool bWasSuccessful, const FString
 	PlayerController->ClientTravel(Address, TRAVEL_Absolute);
 }
 
-void UMenuWidget::OnFindSessionCompleted(const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful)
+void UMenuWidget::OnFindSessionCompleted(const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful)
 {
 	if (!IsValid(CustomSessionSubsystem))
 	{
 		return;
 	}
 
-	CustomSessionSubsystem->OnCustomSessionFindSessionsCompleted.RemoveAll(this);
-
-	const FOnlineSessionSearchResult* SessionToJoin = nullptr;
-	for (const FOnlineSessionSearchResult& Result : SessionResults)
+	if (!bWasSuccessful)
 	{
-		if (!Result.IsValid() || !Result.IsSessionInfoValid())
-		{
-			continue;
-		}
+		UE_LOG(LogCustomSessions, Warning, TEXT("Could not find any session of match type: %s"), *CustomSessionSubsystem->CurrentMatchType);
+		EnableDisableInputs(true);
 
-		const FString IdStr = Result.GetSessionIdStr();
-		const FString& User = Result.Session.OwningUserName;
-		FString MatchType;
-		Result.Session.SessionSettings.Get(CustomSessionsApi::MatchTypeKey, MatchType);
-		if (GEngine)
-		{
-			GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Green,
-				FString::Printf(TEXT("Session Id: %s, owner: %s, Type: %s"), 
-				*IdStr, *User, *MatchType));
-		}
+		return;
+	}
 
-		if (!SessionToJoin && MatchType.Equals(CustomSessionSubsystem->CurrentMatchType))
+	// results are already filtered by match type, on the backend or by the subsystem, and get ranked there
+	CustomSessionSubsystem->JoinBestSessionAsync(Snapshot)
+		.Next([WeakThis = TWeakObjectPtr<ThisClass>(this)](const FCustomSessionJoinResult& JoinResult)
 		{
-			SessionToJoin = &Result;
-		}
-	}
+			if (ThisClass* This = WeakThis.Get())
+			{
+				This->OnJoinSessionCompleted(JoinResult.JoinResult);
+			}
+		});
+}
 
-	if (SessionToJoin != nullptr)
-	{
-		CustomSessionSubsystem->OnCustomsessionJoinSessionCompleted.AddUObject(this, &UMenuWidget::OnJoinSessionCompleted);
-		CustomSessionSubsystem->JoinSession(*SessionToJoin);
-	}
-	else
+void UMenuWidget::OnBrowserSessionChosen(const FOnlineSessionSearchResult& SearchResult)
+{
+	if (!IsValid(CustomSessionSubsystem))
 	{
-		UE_LOG(LogOnlineSession, Warning, TEXT("Could not find any session of match type: %s"), *CustomSessionSubsystem->CurrentMatchType);
+		return;
 	}
+
+	EnableDisableInputs(false);
+	CustomSessionSubsystem->JoinSessionAsync(SearchResult)
+		.Next([WeakThis = TWeakObjectPtr<ThisClass>(this)](const FCustomSessionJoinResult& JoinResult)
+		{
+			if (ThisClass* This = WeakThis.Get())
+			{
+				This->OnJoinSessionCompleted(JoinResult.JoinResult);
+			}
+		});
 }
 
 void UMenuWidget::OnJoinSessionCompleted(EOnJoinSessionCompleteResult::Type JoinResult)
 {
 	if (!IsValid(CustomSessionSubsystem) || !CustomSessionSubsystem->OnlineSession.IsValid())
 	{
-		UE_LOG(LogOnlineSession, Error, TEXT("Could not get the Online session"));
+		UE_LOG(LogCustomSessions, Error, TEXT("Could not get the Online session"));
 		OnHostJoined(false, "");
 		return;
 	}
 
-	CustomSessionSubsystem->OnCustomsessionJoinSessionCompleted.RemoveAll(this);
-
-	if (GEngine)
-	{
-		GEngine->AddOnScreenDebugMessage(-1, 15.0f, FColor::Emerald,
-			FString::Printf(TEXT("Join Session [%s] completed with Result: %d"),
-			*CustomSessionSubsystem->CurrentGameSession.ToString(), static_cast<uint8>(JoinResult)));
-	}
+	CUSTOMSESSION_EVENT(Join, Log, "JoinCompleted", {TEXT("Session"), CustomSessionSubsystem->CurrentGameSession},
+		{TEXT("Result"), LexToString(JoinResult)});
 	
 	switch (JoinResult)
 	{
 		case EOnJoinSessionCompleteResult::Success:
 		{
 			FString Address;
-			if (!CustomSessionSubsystem->OnlineSession->GetResolvedConnectString(CustomSessionSubsystem->CurrentGameSession, Address))
+			if (!CustomSessionSubsystem->ResolveConnectString(Address))
 			{
-				UE_LOG(LogOnlineSession, Error, TEXT("Could not get the address to travel to"));
+				UE_LOG(LogCustomSessions, Error, TEXT("Could not get the address to travel to"));
 				OnHostJoined(false, "");
 
 				return;
@@ -248,5 +256,10 @@ bool UMenuWidget::Initialize()
 		Button_Join->OnClicked.AddUniqueDynamic(this, &ThisClass::ButtonJoinClicked);
 	}
 
+	if (SessionBrowser)
+	{
+		SessionBrowser->OnSessionChosen.AddUObject(this, &ThisClass::OnBrowserSessionChosen);
+	}
+
 	return true;
 }
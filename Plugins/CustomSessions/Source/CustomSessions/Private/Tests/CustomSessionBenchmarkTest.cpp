@@ -0,0 +1,90 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionBenchmark.h"
+#include "CustomSessionSubsystem.h"
+#include "CustomSessionTestHarness.h"
+#include "Misc/App.h"
+#include "Misc/AutomationTest.h"
+#include "UObject/StrongObjectPtr.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/** Ticks the harness until the benchmark wrote its report, then checks every phase produced samples */
+class FWaitForCustomSessionBenchmark : public IAutomationLatentCommand
+{
+public:
+	FWaitForCustomSessionBenchmark(FAutomationTestBase& InTest, TSharedRef<FCustomSessionTestHarness> InHarness, UCustomSessionBenchmark* InBenchmark)
+		: Test(InTest)
+		, Harness(InHarness)
+		, Benchmark(InBenchmark)
+	{
+	}
+
+	virtual bool Update() override
+	{
+		if (UCustomSessionBenchmark::IsRunning() && GetCurrentRunTime() < 60.0)
+		{
+			Harness->Tick(FApp::GetDeltaTime());
+
+			return false;
+		}
+
+		if (!Test.TestFalse(TEXT("Benchmark still running"), UCustomSessionBenchmark::IsRunning()))
+		{
+			return true;
+		}
+
+		const auto FindMetric = [this](const TCHAR* Name)
+		{
+			return Benchmark->GetMetrics().FindByPredicate([Name](const FCustomSessionBenchmarkMetric& Metric) { return Metric.Name == Name; });
+		};
+
+		static const TCHAR* SampledMetrics[] = { TEXT("TimeToFirstResult"), TEXT("TimeToAllResults"), TEXT("SearchAllocations"), TEXT("TimeToJoin"), TEXT("ProcessResults10"),
+			TEXT("ProcessResults100"), TEXT("ProcessResults1000"), TEXT("CreateDestroyCycle"), TEXT("CreateDestroyThroughput") };
+		for (const TCHAR* Name : SampledMetrics)
+		{
+			const FCustomSessionBenchmarkMetric* Metric = FindMetric(Name);
+			Test.TestTrue(FString::Printf(TEXT("%s sampled"), Name), Metric != nullptr && !Metric->Samples.IsEmpty());
+		}
+
+		static const TCHAR* FailureMetrics[] = { TEXT("SearchFailures"), TEXT("JoinFailures"), TEXT("CreateDestroyFailures") };
+		for (const TCHAR* Name : FailureMetrics)
+		{
+			const FCustomSessionBenchmarkMetric* Metric = FindMetric(Name);
+			Test.TestTrue(FString::Printf(TEXT("No %s"), Name), Metric != nullptr && Metric->Samples.Num() == 1 && Metric->Samples[0] == 0.0);
+		}
+
+		return true;
+	}
+
+private:
+	FAutomationTestBase& Test;
+	TSharedRef<FCustomSessionTestHarness> Harness;
+	TStrongObjectPtr<UCustomSessionBenchmark> Benchmark;
+};
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FCustomSessionBenchmarkTest, "CustomSessions.Benchmark",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FCustomSessionBenchmarkTest::RunTest(const FString& Parameters)
+{
+	const TSharedRef<FCustomSessionTestHarness> Harness = MakeShared<FCustomSessionTestHarness>(FCustomSessionTestHarness::MakeFastMockSettings());
+
+	// small enough for every CI run, the console command takes larger runs
+	FCustomSessionBenchmarkOptions Options;
+	Options.Iterations = 5;
+	Options.CreateDestroyCycles = 10;
+	Options.NumSyntheticSessions = 500;
+
+	UCustomSessionBenchmark* Benchmark = UCustomSessionBenchmark::Run(&Harness->GetSubsystem(), Options);
+	if (!TestNotNull(TEXT("Benchmark started"), Benchmark))
+	{
+		return false;
+	}
+
+	ADD_LATENT_AUTOMATION_COMMAND(FWaitForCustomSessionBenchmark(*this, Harness, Benchmark));
+
+	return true;
+}
+
+#endif
@@ -0,0 +1,63 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionDiagnostics.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FCustomSessionDiagnosticsSpec, "CustomSessions.Diagnostics",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	IConsoleVariable* MaxEventsPerSecond = nullptr;
+	float PreviousMaxEventsPerSecond = 0.0f;
+
+	/** Consumes until the bucket refuses, at most Attempts times, returning how many events got through */
+	static int32 Flood(ECustomSessionDiagnostics Category, ELogVerbosity::Type Verbosity, int32 Attempts)
+	{
+		int32 Emitted = 0;
+		int32 Suppressed = 0;
+		for (int32 Attempt = 0; Attempt < Attempts; ++Attempt)
+		{
+			Emitted += FCustomSessionDiagnostics::TryConsume(Category, Verbosity, Suppressed) ? 1 : 0;
+		}
+
+		return Emitted;
+	}
+
+END_DEFINE_SPEC(FCustomSessionDiagnosticsSpec)
+
+void FCustomSessionDiagnosticsSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		MaxEventsPerSecond = IConsoleManager::Get().FindConsoleVariable(TEXT("CustomSessions.Diagnostics.MaxEventsPerSecond"));
+		PreviousMaxEventsPerSecond = MaxEventsPerSecond->GetFloat();
+		MaxEventsPerSecond->Set(10.0f, ECVF_SetByConsole);
+	});
+
+	AfterEach([this]()
+	{
+		MaxEventsPerSecond->Set(PreviousMaxEventsPerSecond, ECVF_SetByConsole);
+	});
+
+	Describe("TryConsume", [this]()
+	{
+		It("should suppress a flood of informational events", [this]()
+		{
+			TestTrue(TEXT("Emitted of the flood"), Flood(ECustomSessionDiagnostics::UI, ELogVerbosity::Verbose, 1000) < 1000);
+		});
+
+		It("should let an error through a category flooded with informational events", [this]()
+		{
+			Flood(ECustomSessionDiagnostics::Join, ELogVerbosity::Log, 1000);
+
+			int32 Suppressed = 0;
+			TestFalse(TEXT("Log after the flood"), FCustomSessionDiagnostics::TryConsume(ECustomSessionDiagnostics::Join, ELogVerbosity::Log, Suppressed));
+			TestTrue(TEXT("Error after the flood"), FCustomSessionDiagnostics::TryConsume(ECustomSessionDiagnostics::Join, ELogVerbosity::Error, Suppressed));
+			TestTrue(TEXT("Warning after the flood"), FCustomSessionDiagnostics::TryConsume(ECustomSessionDiagnostics::Join, ELogVerbosity::Warning, Suppressed));
+		});
+	});
+}
+
+#endif
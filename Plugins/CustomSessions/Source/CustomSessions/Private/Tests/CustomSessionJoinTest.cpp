@@ -0,0 +1,250 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionMockSession.h"
+#include "CustomSessionSubsystem.h"
+#include "CustomSessionTestHarness.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FCustomSessionJoinSpec, "CustomSessions.Join",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	TUniquePtr<FCustomSessionTestHarness> Harness;
+	TArray<EOnJoinSessionCompleteResult::Type> JoinResults;
+	FCustomSessionSearchSnapshotPtr Found;
+	TOptional<FCustomSessionJoinResult> FirstJoin;
+	TOptional<FCustomSessionJoinResult> SecondJoin;
+
+	static FOnlineSessionSearchResult MakeJoinableResult(int32 Index)
+	{
+		FRandomStream RandomStream(Index);
+		FOnlineSessionSearchResult Result = FCustomSessionMockSession::MakeSyntheticResult(FCustomSessionTestHarness::MakeFastMockSettings(), RandomStream, Index);
+		Result.Session.NumOpenPublicConnections = 1;
+
+		return Result;
+	}
+
+	void MakeHarness(const FCustomSessionMockSettings& MockSettings)
+	{
+		Harness = MakeUnique<FCustomSessionTestHarness>(MockSettings);
+		Harness->GetSubsystem().OnCustomsessionJoinSessionCompleted.AddLambda([this](EOnJoinSessionCompleteResult::Type JoinResult)
+		{
+			JoinResults.Add(JoinResult);
+		});
+	}
+
+END_DEFINE_SPEC(FCustomSessionJoinSpec)
+
+void FCustomSessionJoinSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		JoinResults.Reset();
+		Found.Reset();
+		FirstJoin.Reset();
+		SecondJoin.Reset();
+		MakeHarness(FCustomSessionTestHarness::MakeFastMockSettings());
+	});
+
+	AfterEach([this]()
+	{
+		Harness.Reset();
+	});
+
+	LatentIt("should complete once when the backend completes within JoinSession and returns false", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		Subsystem.CreateSession(TEXT("Match"), 4);
+		Harness->WaitUntil([&Subsystem]() { return Subsystem.GetNamedSessionState(TEXT("Match")) == ECustomSessionState::InSession; }, 5.0f,
+			[this, &Subsystem, Done](bool bCreated)
+			{
+				TestTrue(TEXT("Created"), bCreated);
+
+				// the mock reports AlreadyInSession from inside the call and then returns false
+				Subsystem.JoinSession(MakeJoinableResult(0), TEXT("Match"));
+
+				TestEqual(TEXT("Join completions"), JoinResults.Num(), 1);
+				TestFalse(TEXT("Still joining"), Subsystem.IsJoining());
+				TestEqual(TEXT("Join operations"), Subsystem.GetOperationStats(ECustomSessionOperation::Join).Count, 1);
+				Done.Execute();
+			});
+	});
+
+	LatentIt("should fail a join under a name held by another session and keep that session", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		Subsystem.CreateSession(TEXT("Match"), 4);
+		Harness->WaitUntil([&Subsystem]() { return Subsystem.GetNamedSessionState(TEXT("Match")) == ECustomSessionState::InSession; }, 5.0f,
+			[this, &Subsystem, Done](bool bCreated)
+			{
+				TestTrue(TEXT("Created"), bCreated);
+
+				Subsystem.JoinSessionAsync(MakeJoinableResult(0), TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { FirstJoin = JoinResult; });
+
+				if (TestTrue(TEXT("Join resolved"), FirstJoin.IsSet()))
+				{
+					TestEqual(TEXT("Join result"), FirstJoin->JoinResult, EOnJoinSessionCompleteResult::AlreadyInSession);
+					TestEqual(TEXT("Result"), FirstJoin->Result, ECustomSessionResult::Failed);
+				}
+
+				TestEqual(TEXT("Join failures"), Subsystem.GetOperationStats(ECustomSessionOperation::Join).Failures, 1);
+				TestEqual(TEXT("Match state"), Subsystem.GetNamedSessionState(TEXT("Match")), ECustomSessionState::InSession);
+				TestNotNull(TEXT("Hosted session kept"), Harness->GetMock().GetNamedSession(TEXT("Match")));
+				Done.Execute();
+			});
+	});
+
+	LatentIt("should resolve each join future with the result of its own request", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		Subsystem.FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, TEXT("Match")).Next([this](const FCustomSessionFindResult& FindResult)
+		{
+			Found = FindResult.Snapshot;
+		});
+
+		Harness->WaitUntil([this]() { return Found.IsValid(); }, 5.0f, [this, &Subsystem, Done](bool bFound)
+		{
+			const FOnlineSessionSearchResult* Joinable = bFound ? Found->GetResults().FindByPredicate([](const FOnlineSessionSearchResult& Result)
+			{
+				return Result.Session.NumOpenPublicConnections > 0;
+			}) : nullptr;
+
+			if (!TestNotNull(TEXT("Joinable result"), Joinable))
+			{
+				Done.Execute();
+
+				return;
+			}
+
+			// the second one waits for the first, nothing in its snapshot is joinable
+			Subsystem.JoinSessionAsync(*Joinable, TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { FirstJoin = JoinResult; });
+			Subsystem.JoinBestSessionAsync(FCustomSessionSearchSnapshot::Empty(), 1, TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { SecondJoin = JoinResult; });
+
+			Harness->WaitUntil([this]() { return FirstJoin.IsSet() && SecondJoin.IsSet(); }, 5.0f, [this, Done](bool bResolved)
+			{
+				if (TestTrue(TEXT("Both resolved"), bResolved))
+				{
+					TestEqual(TEXT("First join"), FirstJoin->JoinResult, EOnJoinSessionCompleteResult::Success);
+					TestEqual(TEXT("Second join"), SecondJoin->JoinResult, EOnJoinSessionCompleteResult::SessionDoesNotExist);
+				}
+
+				Done.Execute();
+			});
+		});
+	});
+
+	LatentIt("should resolve a queued join replaced by a later one as cancelled", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+
+		// joins wait for the search, the second one replaces the first in the queue
+		Subsystem.FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, TEXT("Match"));
+		Subsystem.JoinSessionAsync(MakeJoinableResult(0), TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { FirstJoin = JoinResult; });
+		Subsystem.JoinSessionAsync(MakeJoinableResult(1), TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { SecondJoin = JoinResult; });
+
+		if (TestTrue(TEXT("Replaced join resolved"), FirstJoin.IsSet()))
+		{
+			TestEqual(TEXT("Replaced join"), FirstJoin->Result, ECustomSessionResult::Cancelled);
+		}
+
+		TestFalse(TEXT("Latest join resolved before running"), SecondJoin.IsSet());
+		Harness->WaitUntil([this]() { return SecondJoin.IsSet(); }, 5.0f, [this, Done](bool bResolved)
+		{
+			TestTrue(TEXT("Latest join resolved"), bResolved);
+			Done.Execute();
+		});
+	});
+
+	Describe("with a backend slower than the join timeouts", [this]()
+	{
+		BeforeEach([this]()
+		{
+			FCustomSessionMockSettings SlowSettings = FCustomSessionTestHarness::MakeFastMockSettings();
+			SlowSettings.MinLatencyMs = 500.0f;
+			MakeHarness(SlowSettings);
+			Harness->GetSubsystem().JoinAttemptTimeout = 0.05f;
+			Harness->GetSubsystem().JoinTotalDeadline = 0.2f;
+		});
+
+		LatentIt("should resolve a join the backend never answers as timed out", [this](const FDoneDelegate& Done)
+		{
+			UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+			Subsystem.JoinSessionAsync(MakeJoinableResult(0), TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { FirstJoin = JoinResult; });
+
+			// the mock opens the session when it answers, after the subsystem gave up on it
+			TSharedRef<int32> LateCompletions = MakeShared<int32>(0);
+			Harness->GetMock().AddOnJoinSessionCompleteDelegate_Handle(FOnJoinSessionCompleteDelegate::CreateLambda(
+				[LateCompletions](FName SessionName, EOnJoinSessionCompleteResult::Type JoinResult) { ++*LateCompletions; }));
+
+			Harness->WaitUntil([this]() { return FirstJoin.IsSet(); }, 1.0f, [this, &Subsystem, Done, LateCompletions](bool bResolved)
+			{
+				if (!TestTrue(TEXT("Join resolved"), bResolved))
+				{
+					Done.Execute();
+
+					return;
+				}
+
+				TestEqual(TEXT("Result"), FirstJoin->Result, ECustomSessionResult::TimedOut);
+				TestEqual(TEXT("Join completions"), JoinResults.Num(), 1);
+				TestFalse(TEXT("Still joining"), Subsystem.IsJoining());
+				TestEqual(TEXT("Join time outs"), Subsystem.GetOperationStats(ECustomSessionOperation::Join).TimeOuts, 1);
+
+				Harness->WaitUntil([this, LateCompletions]() { return *LateCompletions > 0 && Harness->GetMock().GetNamedSession(TEXT("Match")) == nullptr; }, 3.0f,
+					[this, &Subsystem, Done](bool bDestroyed)
+					{
+						TestTrue(TEXT("Late session destroyed"), bDestroyed);
+
+						Subsystem.JoinAttemptTimeout = 10.0f;
+						Subsystem.JoinTotalDeadline = 20.0f;
+						Subsystem.JoinSessionAsync(MakeJoinableResult(1), TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { SecondJoin = JoinResult; });
+						Harness->WaitUntil([this]() { return SecondJoin.IsSet(); }, 3.0f, [this, &Subsystem, Done](bool bJoined)
+						{
+							if (TestTrue(TEXT("Follow-up join resolved"), bJoined))
+							{
+								TestEqual(TEXT("Follow-up join"), SecondJoin->JoinResult, EOnJoinSessionCompleteResult::Success);
+								TestEqual(TEXT("Match state"), Subsystem.GetNamedSessionState(TEXT("Match")), ECustomSessionState::InSession);
+							}
+
+							Done.Execute();
+						});
+					});
+			});
+		});
+
+		It("should resolve a cancelled join as cancelled", [this]()
+		{
+			UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+			Subsystem.JoinSessionAsync(MakeJoinableResult(0), TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { FirstJoin = JoinResult; });
+
+			TestTrue(TEXT("Joining"), Subsystem.IsJoining());
+			TestTrue(TEXT("Cancelled"), Subsystem.CancelJoinSession());
+			TestFalse(TEXT("Cancelled twice"), Subsystem.CancelJoinSession());
+			TestFalse(TEXT("Still joining"), Subsystem.IsJoining());
+			if (TestTrue(TEXT("Join resolved"), FirstJoin.IsSet()))
+			{
+				TestEqual(TEXT("Result"), FirstJoin->Result, ECustomSessionResult::Cancelled);
+			}
+		});
+
+		It("should resolve a cancelled search as cancelled with nothing found", [this]()
+		{
+			UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+			TOptional<FCustomSessionFindResult> FindResult;
+			Subsystem.FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, TEXT("Match")).Next([&FindResult](const FCustomSessionFindResult& Result) { FindResult = Result; });
+
+			TestTrue(TEXT("Searching"), Subsystem.IsSearching());
+			TestTrue(TEXT("Cancelled"), Subsystem.CancelFindSessions());
+			TestFalse(TEXT("Still searching"), Subsystem.IsSearching());
+			if (TestTrue(TEXT("Search resolved"), FindResult.IsSet()))
+			{
+				TestEqual(TEXT("Result"), FindResult->Result, ECustomSessionResult::Cancelled);
+				TestFalse(TEXT("Successful"), FindResult->bWasSuccessful);
+				TestEqual(TEXT("Results"), FindResult->Snapshot->Num(), 0);
+			}
+		});
+	});
+}
+
+#endif
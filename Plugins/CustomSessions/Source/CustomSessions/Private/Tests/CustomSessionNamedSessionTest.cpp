@@ -0,0 +1,163 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionMockSession.h"
+#include "CustomSessionSubsystem.h"
+#include "CustomSessionTestHarness.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FCustomSessionNamedSessionSpec, "CustomSessions.NamedSessions",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	TUniquePtr<FCustomSessionTestHarness> Harness;
+	TOptional<bool> PartyCreated;
+	TOptional<bool> MatchCreated;
+	TOptional<FCustomSessionFindResult> FindResult;
+	TOptional<FCustomSessionJoinResult> PartyJoin;
+	TOptional<FCustomSessionJoinResult> MatchJoin;
+
+	static FOnlineSessionSearchResult MakeJoinableResult(int32 Index)
+	{
+		FRandomStream RandomStream(Index);
+		FOnlineSessionSearchResult Result = FCustomSessionMockSession::MakeSyntheticResult(FCustomSessionTestHarness::MakeFastMockSettings(), RandomStream, Index);
+		Result.Session.NumOpenPublicConnections = 1;
+
+		return Result;
+	}
+
+END_DEFINE_SPEC(FCustomSessionNamedSessionSpec)
+
+void FCustomSessionNamedSessionSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		PartyCreated.Reset();
+		MatchCreated.Reset();
+		FindResult.Reset();
+		PartyJoin.Reset();
+		MatchJoin.Reset();
+		Harness = MakeUnique<FCustomSessionTestHarness>(FCustomSessionTestHarness::MakeFastMockSettings());
+	});
+
+	AfterEach([this]()
+	{
+		Harness.Reset();
+	});
+
+	LatentIt("should create two named sessions at once and keep both", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		Subsystem.CreateSessionAsync(TEXT("Party"), 4).Next([this](bool bWasSuccessful) { PartyCreated = bWasSuccessful; });
+		Subsystem.CreateSessionAsync(TEXT("Match"), 8).Next([this](bool bWasSuccessful) { MatchCreated = bWasSuccessful; });
+
+		// sessions of different names don't wait for each other
+		TestTrue(TEXT("Party busy"), Subsystem.IsSessionBusy(TEXT("Party")));
+		TestTrue(TEXT("Match busy"), Subsystem.IsSessionBusy(TEXT("Match")));
+
+		Harness->WaitUntil([this]() { return PartyCreated.IsSet() && MatchCreated.IsSet(); }, 5.0f, [this, &Subsystem, Done](bool bResolved)
+		{
+			if (TestTrue(TEXT("Both resolved"), bResolved))
+			{
+				TestTrue(TEXT("Party created"), PartyCreated.GetValue());
+				TestTrue(TEXT("Match created"), MatchCreated.GetValue());
+				TestEqual(TEXT("Party state"), Subsystem.GetNamedSessionState(TEXT("Party")), ECustomSessionState::InSession);
+				TestEqual(TEXT("Match state"), Subsystem.GetNamedSessionState(TEXT("Match")), ECustomSessionState::InSession);
+				TestEqual(TEXT("Named sessions"), Subsystem.GetNamedSessions().Num(), 2);
+				TestNotNull(TEXT("Party on the backend"), Harness->GetMock().GetNamedSession(TEXT("Party")));
+				TestNotNull(TEXT("Match on the backend"), Harness->GetMock().GetNamedSession(TEXT("Match")));
+			}
+
+			Done.Execute();
+		});
+	});
+
+	LatentIt("should keep the other session when one is destroyed", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		Subsystem.CreateSessionAsync(TEXT("Party"), 4).Next([this](bool bWasSuccessful) { PartyCreated = bWasSuccessful; });
+		Subsystem.CreateSessionAsync(TEXT("Match"), 8).Next([this](bool bWasSuccessful) { MatchCreated = bWasSuccessful; });
+
+		Harness->WaitUntil([this]() { return PartyCreated.IsSet() && MatchCreated.IsSet(); }, 5.0f, [this, &Subsystem, Done](bool bCreated)
+		{
+			if (!TestTrue(TEXT("Both created"), bCreated))
+			{
+				Done.Execute();
+
+				return;
+			}
+
+			Subsystem.DestroySession(TEXT("Party"));
+			Harness->WaitUntil([&Subsystem]() { return Subsystem.GetNamedSessionState(TEXT("Party")) == ECustomSessionState::Idle; }, 5.0f,
+				[this, &Subsystem, Done](bool bDestroyed)
+				{
+					TestTrue(TEXT("Party destroyed"), bDestroyed);
+					TestNull(TEXT("Party on the backend"), Harness->GetMock().GetNamedSession(TEXT("Party")));
+					TestEqual(TEXT("Match state"), Subsystem.GetNamedSessionState(TEXT("Match")), ECustomSessionState::InSession);
+					TestEqual(TEXT("Named sessions"), Subsystem.GetNamedSessions(), TArray<FName>({ TEXT("Match") }));
+					Done.Execute();
+				});
+		});
+	});
+
+	LatentIt("should run queued joins of different sessions instead of replacing one with the other", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+
+		// both wait for the search
+		Subsystem.FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, TEXT("Match"));
+		Subsystem.JoinSessionAsync(MakeJoinableResult(0), TEXT("Party")).Next([this](const FCustomSessionJoinResult& JoinResult) { PartyJoin = JoinResult; });
+		Subsystem.JoinSessionAsync(MakeJoinableResult(1), TEXT("Match")).Next([this](const FCustomSessionJoinResult& JoinResult) { MatchJoin = JoinResult; });
+
+		TestFalse(TEXT("Party join resolved while queued"), PartyJoin.IsSet());
+		Harness->WaitUntil([this]() { return PartyJoin.IsSet() && MatchJoin.IsSet(); }, 5.0f, [this, &Subsystem, Done](bool bResolved)
+		{
+			if (TestTrue(TEXT("Both resolved"), bResolved))
+			{
+				TestEqual(TEXT("Party join"), PartyJoin->Result, ECustomSessionResult::Success);
+				TestEqual(TEXT("Match join"), MatchJoin->Result, ECustomSessionResult::Success);
+				TestEqual(TEXT("Party state"), Subsystem.GetNamedSessionState(TEXT("Party")), ECustomSessionState::InSession);
+				TestEqual(TEXT("Match state"), Subsystem.GetNamedSessionState(TEXT("Match")), ECustomSessionState::InSession);
+			}
+
+			Done.Execute();
+		});
+	});
+
+	It("should tell delegate listeners when their queued join is replaced", [this]()
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		TArray<EOnJoinSessionCompleteResult::Type> JoinResults;
+		Subsystem.OnCustomsessionJoinSessionCompleted.AddLambda([&JoinResults](EOnJoinSessionCompleteResult::Type JoinResult) { JoinResults.Add(JoinResult); });
+
+		Subsystem.FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, TEXT("Match"));
+		Subsystem.JoinSession(MakeJoinableResult(0), TEXT("Match"));
+		Subsystem.JoinSession(MakeJoinableResult(1), TEXT("Match"));
+
+		TestEqual(TEXT("Replaced join results"), JoinResults, TArray<EOnJoinSessionCompleteResult::Type>({ EOnJoinSessionCompleteResult::UnknownError }));
+		Subsystem.OnCustomsessionJoinSessionCompleted.Clear();
+	});
+
+	LatentIt("should search while a named session is being created", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		Subsystem.CreateSessionAsync(TEXT("Party"), 4).Next([this](bool bWasSuccessful) { PartyCreated = bWasSuccessful; });
+		Subsystem.FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, TEXT("Match")).Next([this](const FCustomSessionFindResult& Result) { FindResult = Result; });
+
+		TestTrue(TEXT("Searching"), Subsystem.IsSearching());
+		Harness->WaitUntil([this]() { return PartyCreated.IsSet() && FindResult.IsSet(); }, 5.0f, [this, &Subsystem, Done](bool bResolved)
+		{
+			if (TestTrue(TEXT("Both resolved"), bResolved))
+			{
+				TestTrue(TEXT("Party created"), PartyCreated.GetValue());
+				TestTrue(TEXT("Search succeeded"), FindResult->bWasSuccessful);
+				TestTrue(TEXT("Sessions found"), FindResult->Snapshot->Num() > 0);
+				TestEqual(TEXT("Party state"), Subsystem.GetNamedSessionState(TEXT("Party")), ECustomSessionState::InSession);
+			}
+
+			Done.Execute();
+		});
+	});
+}
+
+#endif
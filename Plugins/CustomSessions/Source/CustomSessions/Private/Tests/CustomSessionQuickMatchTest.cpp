@@ -0,0 +1,59 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionSubsystem.h"
+#include "CustomSessionTestHarness.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FCustomSessionQuickMatchSpec, "CustomSessions.QuickMatch",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	TUniquePtr<FCustomSessionTestHarness> Harness;
+	TArray<ECustomSessionQuickMatchResult> QuickMatchResults;
+
+END_DEFINE_SPEC(FCustomSessionQuickMatchSpec)
+
+void FCustomSessionQuickMatchSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		Harness = MakeUnique<FCustomSessionTestHarness>(FCustomSessionTestHarness::MakeFastMockSettings());
+		QuickMatchResults.Reset();
+		Harness->GetSubsystem().OnCustomSessionQuickMatchCompleted.AddLambda([this](ECustomSessionQuickMatchResult Result, const FString&)
+		{
+			QuickMatchResults.Add(Result);
+		});
+	});
+
+	AfterEach([this]()
+	{
+		Harness.Reset();
+	});
+
+	LatentIt("should ignore searches and joins completed for someone else", [this](const FDoneDelegate& Done)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		FCustomSessionQuickMatchOptions Options;
+		Options.SessionName = TEXT("Match");
+		TestTrue(TEXT("Started"), Subsystem.QuickMatch(TEXT("FreeForAll"), Options));
+
+		// what a browser refresh or a menu join elsewhere would broadcast meanwhile
+		Subsystem.OnCustomSessionFindSessionsCompleted.Broadcast(FCustomSessionSearchSnapshot::Empty(), false);
+		Subsystem.OnCustomsessionJoinSessionCompleted.Broadcast(EOnJoinSessionCompleteResult::SessionIsFull);
+		TestTrue(TEXT("Still in progress"), Subsystem.IsQuickMatchInProgress());
+		TestEqual(TEXT("Completions"), QuickMatchResults.Num(), 0);
+
+		Harness->WaitUntil([&Subsystem]() { return !Subsystem.IsQuickMatchInProgress(); }, 10.0f, [this, Done](bool bFinished)
+		{
+			if (TestTrue(TEXT("Finished"), bFinished) && TestEqual(TEXT("Completions"), QuickMatchResults.Num(), 1))
+			{
+				TestEqual(TEXT("Result"), QuickMatchResults[0], ECustomSessionQuickMatchResult::Joined);
+			}
+
+			Done.Execute();
+		});
+	});
+}
+
+#endif
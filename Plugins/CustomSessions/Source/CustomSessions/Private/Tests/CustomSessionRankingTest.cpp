@@ -0,0 +1,188 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionRanking.h"
+#include "CustomSessionMockSession.h"
+#include "CustomSessionSubsystem.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FCustomSessionRankingSpec, "CustomSessions.Ranking",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	FCustomSessionRankingContext Context;
+
+	/** Same result every run, only what the test sets differs between them */
+	static FOnlineSessionSearchResult MakeResult(int32 Index, int32 PingInMs, int32 OpenConnections, int32 MaxConnections = 8,
+		int32 BuildUniqueId = 1, const FString& Region = TEXT("EU"))
+	{
+		FCustomSessionMockSettings MockSettings;
+		FRandomStream RandomStream(Index);
+		FOnlineSessionSearchResult Result = FCustomSessionMockSession::MakeSyntheticResult(MockSettings, RandomStream, Index);
+		Result.PingInMs = PingInMs;
+		Result.Session.NumOpenPublicConnections = OpenConnections;
+		Result.Session.SessionSettings.NumPublicConnections = MaxConnections;
+		Result.Session.SessionSettings.BuildUniqueId = BuildUniqueId;
+		Result.Session.SessionSettings.Set(CustomSessionsApi::RegionKey, Region, EOnlineDataAdvertisementType::ViaOnlineServiceAndPing);
+
+		return Result;
+	}
+
+	TArray<int32> RankedIndices(const TArray<FOnlineSessionSearchResult>& Results) const
+	{
+		TArray<FCustomSessionRankedResult> Ranked;
+		FCustomSessionRanking::Rank(Results, Context, Ranked);
+
+		TArray<int32> Indices;
+		for (const FCustomSessionRankedResult& RankedResult : Ranked)
+		{
+			Indices.Add(RankedResult.Index);
+		}
+
+		return Indices;
+	}
+
+END_DEFINE_SPEC(FCustomSessionRankingSpec)
+
+void FCustomSessionRankingSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		Context = FCustomSessionRankingContext();
+		Context.BuildUniqueId = 1;
+		Context.Region = TEXT("EU");
+	});
+
+	Describe("Rank", [this]()
+	{
+		It("should put the lowest ping first when nothing else differs", [this]()
+		{
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 120, 4), MakeResult(1, 20, 4), MakeResult(2, 60, 4) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 1, 2, 0 }));
+		});
+
+		It("should put fuller sessions first at the same ping", [this]()
+		{
+			Context.Weights.FreeConnections = 0.0f;
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 50, 7), MakeResult(1, 50, 2), MakeResult(2, 50, 5) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 1, 2, 0 }));
+		});
+
+		It("should keep the backend order on ties", [this]()
+		{
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 50, 4), MakeResult(1, 50, 4), MakeResult(2, 50, 4), MakeResult(3, 50, 4) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 0, 1, 2, 3 }));
+		});
+
+		It("should add the build and region weights to matching sessions", [this]()
+		{
+			float Matching = 0.0f;
+			float OtherBuild = 0.0f;
+			float OtherRegion = 0.0f;
+			TestTrue(TEXT("Matching scored"), FCustomSessionRanking::Score(MakeResult(0, 50, 4), Context, Matching));
+			TestTrue(TEXT("Other build scored"), FCustomSessionRanking::Score(MakeResult(1, 50, 4, 8, 2), Context, OtherBuild));
+			TestTrue(TEXT("Other region scored"), FCustomSessionRanking::Score(MakeResult(2, 50, 4, 8, 1, TEXT("US")), Context, OtherRegion));
+
+			TestEqual(TEXT("Build bonus"), Matching - OtherBuild, Context.Weights.BuildMatch, KINDA_SMALL_NUMBER);
+			TestEqual(TEXT("Region bonus"), Matching - OtherRegion, Context.Weights.RegionMatch, KINDA_SMALL_NUMBER);
+		});
+
+		It("should prefer our build over a lower ping", [this]()
+		{
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 10, 4, 8, 2), MakeResult(1, 80, 4) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 1, 0 }));
+		});
+
+		It("should discard other builds when the build is required", [this]()
+		{
+			Context.bRequireBuildMatch = true;
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 10, 4, 8, 2), MakeResult(1, 80, 4) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 1 }));
+		});
+
+		It("should discard sessions pinging over MaxAcceptablePingMs", [this]()
+		{
+			Context.Weights.MaxAcceptablePingMs = 100;
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 101, 4), MakeResult(1, 100, 4), MakeResult(2, 30, 4) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 2, 1 }));
+		});
+
+		It("should keep sessions whose ping is unknown", [this]()
+		{
+			Context.Weights.MaxAcceptablePingMs = 100;
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, MAX_QUERY_PING, 4), MakeResult(1, 30, 4) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 1, 0 }));
+		});
+
+		It("should not give unknown or negative pings any ping score", [this]()
+		{
+			float Unknown = 0.0f;
+			float Negative = 0.0f;
+			float Slowest = 0.0f;
+			TestTrue(TEXT("Unknown scored"), FCustomSessionRanking::Score(MakeResult(0, MAX_QUERY_PING, 4), Context, Unknown));
+			TestTrue(TEXT("Negative scored"), FCustomSessionRanking::Score(MakeResult(0, -1, 4), Context, Negative));
+			TestTrue(TEXT("Slowest scored"), FCustomSessionRanking::Score(MakeResult(0, Context.Weights.MaxAcceptablePingMs, 4), Context, Slowest));
+
+			TestEqual(TEXT("Unknown ping score"), Unknown, Slowest, KINDA_SMALL_NUMBER);
+			TestEqual(TEXT("Negative ping score"), Negative, Slowest, KINDA_SMALL_NUMBER);
+		});
+
+		It("should still rank by ping without a MaxAcceptablePingMs", [this]()
+		{
+			Context.Weights.MaxAcceptablePingMs = 0;
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 600, 4), MakeResult(1, MAX_QUERY_PING, 4), MakeResult(2, 20, 4) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 2, 0, 1 }));
+		});
+
+		It("should use the measured round trip over the backend ping", [this]()
+		{
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 20, 4), MakeResult(1, 80, 4) };
+			Context.MeasuredPingsMs.Add(Results[0].GetSessionIdStr(), 200);
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 1, 0 }));
+		});
+
+		It("should discard sessions without room for the party", [this]()
+		{
+			Context.RequiredConnections = 3;
+			const TArray<FOnlineSessionSearchResult> Results = { MakeResult(0, 20, 2), MakeResult(1, 80, 3) };
+
+			TestEqual(TEXT("Order"), RankedIndices(Results), TArray<int32>({ 1 }));
+		});
+
+		It("should rank 1000 results", [this]()
+		{
+			TArray<FOnlineSessionSearchResult> Results;
+			for (int32 Index = 0; Index < 1000; ++Index)
+			{
+				Results.Add(MakeResult(Index, 5 + Index % 240, 1 + Index % 8, 8, 1 + Index % 2, Index % 3 == 0 ? TEXT("US") : TEXT("EU")));
+			}
+
+			TArray<FCustomSessionRankedResult> Ranked;
+			const double StartTime = FPlatformTime::Seconds();
+			FCustomSessionRanking::Rank(Results, Context, Ranked);
+			AddInfo(FString::Printf(TEXT("Ranked 1000 results in %.3f ms"), (FPlatformTime::Seconds() - StartTime) * 1000.0));
+
+			TestEqual(TEXT("Ranked"), Ranked.Num(), 1000);
+			for (int32 Index = 1; Index < Ranked.Num(); ++Index)
+			{
+				if (Ranked[Index - 1].Score < Ranked[Index].Score)
+				{
+					AddError(FString::Printf(TEXT("Result %d scores higher than the one ranked before it"), Index));
+
+					break;
+				}
+			}
+		});
+	});
+}
+
+#endif
@@ -0,0 +1,102 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionReservation.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FCustomSessionReservationSpec, "CustomSessions.Reservations",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	FCustomSessionSlotReservations Reservations;
+	FGuid Party;
+	FGuid Other;
+
+END_DEFINE_SPEC(FCustomSessionReservationSpec)
+
+void FCustomSessionReservationSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		Reservations.Reset();
+		Party = FGuid::NewGuid();
+		Other = FGuid::NewGuid();
+	});
+
+	Describe("Reserve", [this]()
+	{
+		It("should grant slots next to the other reservations and refuse the rest", [this]()
+		{
+			TestEqual(TEXT("Party"), Reservations.Reserve(Party, 3, 4, 30.0f), ECustomSessionReservationResult::Granted);
+			TestEqual(TEXT("Other"), Reservations.Reserve(Other, 2, 4, 30.0f), ECustomSessionReservationResult::Full);
+			TestEqual(TEXT("Other fitting"), Reservations.Reserve(Other, 1, 4, 30.0f), ECustomSessionReservationResult::Granted);
+			TestEqual(TEXT("Reserved slots"), Reservations.GetReservedSlots(), 4);
+		});
+
+		It("should grant the same token again without counting its slots twice", [this]()
+		{
+			TestEqual(TEXT("First"), Reservations.Reserve(Party, 2, 2, 30.0f), ECustomSessionReservationResult::Granted);
+			TestEqual(TEXT("Again"), Reservations.Reserve(Party, 2, 2, 30.0f), ECustomSessionReservationResult::Granted);
+			TestEqual(TEXT("Reserved slots"), Reservations.GetReservedSlots(), 2);
+		});
+
+		It("should free the slots of a released reservation", [this]()
+		{
+			Reservations.Reserve(Party, 2, 2, 30.0f);
+			Reservations.Release(Party);
+
+			TestFalse(TEXT("Released reserved"), Reservations.IsReserved(Party));
+			TestEqual(TEXT("Other"), Reservations.Reserve(Other, 2, 2, 30.0f), ECustomSessionReservationResult::Granted);
+		});
+	});
+
+	Describe("Consume", [this]()
+	{
+		It("should hand out one slot per player and drop the reservation after the last", [this]()
+		{
+			Reservations.Reserve(Party, 2, 4, 30.0f);
+
+			TestTrue(TEXT("First player"), Reservations.Consume(Party));
+			TestTrue(TEXT("Reserved after the first"), Reservations.IsReserved(Party));
+			TestEqual(TEXT("Reserved slots after the first"), Reservations.GetReservedSlots(), 1);
+			TestTrue(TEXT("Second player"), Reservations.Consume(Party));
+			TestFalse(TEXT("Reserved after the second"), Reservations.IsReserved(Party));
+			TestFalse(TEXT("Third player"), Reservations.Consume(Party));
+			TestEqual(TEXT("Reserved slots"), Reservations.GetReservedSlots(), 0);
+		});
+
+		It("should not consume for players without a token or with an unknown one", [this]()
+		{
+			Reservations.Reserve(Party, 1, 4, 30.0f);
+
+			TestFalse(TEXT("No token"), Reservations.Consume(FGuid()));
+			TestFalse(TEXT("Unknown token"), Reservations.Consume(Other));
+			TestTrue(TEXT("Party still reserved"), Reservations.IsReserved(Party));
+		});
+	});
+
+	Describe("Expiry", [this]()
+	{
+		// a reservation without any lifetime has expired by the next call
+		It("should drop expired reservations and free their slots", [this]()
+		{
+			TestEqual(TEXT("Party"), Reservations.Reserve(Party, 4, 4, 0.0f), ECustomSessionReservationResult::Granted);
+
+			TestEqual(TEXT("Reserved slots"), Reservations.GetReservedSlots(), 0);
+			TestFalse(TEXT("Expired reserved"), Reservations.IsReserved(Party));
+			TestFalse(TEXT("Expired consumed"), Reservations.Consume(Party));
+			TestEqual(TEXT("Other"), Reservations.Reserve(Other, 4, 4, 30.0f), ECustomSessionReservationResult::Granted);
+		});
+
+		It("should keep a reservation asked for again alive", [this]()
+		{
+			Reservations.Reserve(Party, 2, 4, 0.0f);
+			TestEqual(TEXT("Asked again"), Reservations.Reserve(Party, 2, 4, 30.0f), ECustomSessionReservationResult::Granted);
+
+			TestTrue(TEXT("Reserved"), Reservations.IsReserved(Party));
+			TestEqual(TEXT("Reserved slots"), Reservations.GetReservedSlots(), 2);
+		});
+	});
+}
+
+#endif
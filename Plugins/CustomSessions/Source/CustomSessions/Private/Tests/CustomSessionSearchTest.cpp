@@ -0,0 +1,109 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionMockSession.h"
+#include "CustomSessionSearchFilter.h"
+#include "CustomSessionSubsystem.h"
+#include "CustomSessionTestHarness.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+BEGIN_DEFINE_SPEC(FCustomSessionSearchSpec, "CustomSessions.Search",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+	TUniquePtr<FCustomSessionTestHarness> Harness;
+	TOptional<FCustomSessionFindResult> FirstFind;
+	TOptional<FCustomSessionFindResult> SecondFind;
+
+	void SearchTwice(const FDoneDelegate& Done, TFunction<void()>&& Check)
+	{
+		UCustomSessionSubsystem& Subsystem = Harness->GetSubsystem();
+		Subsystem.FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, TEXT("Match")).Next([this](const FCustomSessionFindResult& Result) { FirstFind = Result; });
+		Harness->WaitUntil([this]() { return FirstFind.IsSet(); }, 5.0f, [this, &Subsystem, Done, Check = MoveTemp(Check)](bool bFirstResolved) mutable
+		{
+			if (!TestTrue(TEXT("First search resolved"), bFirstResolved))
+			{
+				Done.Execute();
+
+				return;
+			}
+
+			Subsystem.FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, TEXT("Match")).Next([this](const FCustomSessionFindResult& Result) { SecondFind = Result; });
+			Harness->WaitUntil([this]() { return SecondFind.IsSet(); }, 5.0f, [this, Done, Check = MoveTemp(Check)](bool bSecondResolved)
+			{
+				if (TestTrue(TEXT("Second search resolved"), bSecondResolved))
+				{
+					Check();
+				}
+
+				Done.Execute();
+			});
+		});
+	}
+
+END_DEFINE_SPEC(FCustomSessionSearchSpec)
+
+void FCustomSessionSearchSpec::Define()
+{
+	BeforeEach([this]()
+	{
+		FirstFind.Reset();
+		SecondFind.Reset();
+	});
+
+	AfterEach([this]()
+	{
+		Harness.Reset();
+	});
+
+	Describe("cache", [this]()
+	{
+		LatentIt("should serve a repeated search from the cache", [this](const FDoneDelegate& Done)
+		{
+			Harness = MakeUnique<FCustomSessionTestHarness>(FCustomSessionTestHarness::MakeFastMockSettings());
+			SearchTwice(Done, [this]()
+			{
+				TestTrue(TEXT("Sessions found"), SecondFind->bWasSuccessful);
+				TestTrue(TEXT("Same snapshot"), SecondFind->Snapshot == FirstFind->Snapshot);
+				TestEqual(TEXT("Backend searches"), Harness->GetSubsystem().GetOperationStats(ECustomSessionOperation::Find).Count, 1);
+			});
+		});
+
+		LatentIt("should ask the backend again after a search found nothing", [this](const FDoneDelegate& Done)
+		{
+			FCustomSessionMockSettings MockSettings = FCustomSessionTestHarness::MakeFastMockSettings();
+			MockSettings.NumSyntheticSessions = 0;
+			Harness = MakeUnique<FCustomSessionTestHarness>(MockSettings);
+			SearchTwice(Done, [this]()
+			{
+				TestFalse(TEXT("Sessions found"), SecondFind->bWasSuccessful);
+				TestEqual(TEXT("Backend searches"), Harness->GetSubsystem().GetOperationStats(ECustomSessionOperation::Find).Count, 2);
+			});
+		});
+	});
+
+	Describe("filters", [this]()
+	{
+		It("should check In and NotIn lists locally and leave single value comparisons to the backend", [this]()
+		{
+			TestTrue(TEXT("In"), FCustomSessionSearchFilter(CustomSessionsApi::RegionKey, FString(TEXT("EU,US")), EOnlineComparisonOp::In).IsListComparison());
+			TestTrue(TEXT("NotIn"), FCustomSessionSearchFilter(CustomSessionsApi::RegionKey, FString(TEXT("EU,US")), EOnlineComparisonOp::NotIn).IsListComparison());
+			TestFalse(TEXT("Equals"), FCustomSessionSearchFilter(CustomSessionsApi::RegionKey, FString(TEXT("EU")), EOnlineComparisonOp::Equals).IsListComparison());
+			TestFalse(TEXT("NotEquals"), FCustomSessionSearchFilter(CustomSessionsApi::RegionKey, FString(TEXT("EU")), EOnlineComparisonOp::NotEquals).IsListComparison());
+		});
+
+		It("should only match NotIn settings outside the list", [this]()
+		{
+			const FCustomSessionSearchFilter Filter(CustomSessionsApi::RegionKey, FString(TEXT("EU, US")), EOnlineComparisonOp::NotIn);
+			FOnlineSessionSettings Settings;
+			Settings.Set(CustomSessionsApi::RegionKey, FString(TEXT("US")), EOnlineDataAdvertisementType::ViaOnlineService);
+			TestFalse(TEXT("Listed region"), Filter.Matches(Settings));
+
+			Settings.Set(CustomSessionsApi::RegionKey, FString(TEXT("ASIA")), EOnlineDataAdvertisementType::ViaOnlineService);
+			TestTrue(TEXT("Other region"), Filter.Matches(Settings));
+			TestTrue(TEXT("No region"), Filter.Matches(FOnlineSessionSettings()));
+		});
+	});
+}
+
+#endif
@@ -0,0 +1,78 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "CustomSessionTestHarness.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+#include "CustomSessionMockSession.h"
+#include "CustomSessionSubsystem.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+
+FCustomSessionTestHarness::FCustomSessionTestHarness(const FCustomSessionMockSettings& MockSettings)
+	: GameInstance(NewObject<UGameInstance>(GEngine))
+{
+	GameInstance->InitializeStandalone();
+	Subsystem = GameInstance->GetSubsystem<UCustomSessionSubsystem>();
+	check(Subsystem != nullptr);
+
+	Mock = Subsystem->UseMockBackend(MockSettings);
+	check(Mock.IsValid());
+}
+
+FCustomSessionTestHarness::~FCustomSessionTestHarness()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(WaitTickerHandle);
+
+	UWorld* World = GameInstance->GetWorld();
+	GameInstance->Shutdown();
+	if (World != nullptr)
+	{
+		GEngine->DestroyWorldContext(World);
+		World->DestroyWorld(false);
+	}
+}
+
+FCustomSessionMockSettings FCustomSessionTestHarness::MakeFastMockSettings()
+{
+	FCustomSessionMockSettings MockSettings;
+	MockSettings.bEnabled = true;
+	MockSettings.MinLatencyMs = 5.0f;
+	MockSettings.LatencyJitterMs = 0.0f;
+	MockSettings.NumSyntheticSessions = 32;
+	MockSettings.SyntheticMatchTypes.Add(TEXT("FreeForAll"));
+
+	return MockSettings;
+}
+
+void FCustomSessionTestHarness::Tick(float DeltaTime)
+{
+	GameInstance->GetTimerManager().Tick(DeltaTime);
+}
+
+void FCustomSessionTestHarness::WaitUntil(TFunction<bool()>&& Predicate, float TimeoutSeconds, TFunction<void(bool)>&& Then)
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(WaitTickerHandle);
+
+	const double Deadline = FPlatformTime::Seconds() + TimeoutSeconds;
+	WaitTickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda(
+		[this, Predicate = MoveTemp(Predicate), Then = MoveTemp(Then), Deadline](float DeltaTime)
+		{
+			Tick(DeltaTime);
+
+			const bool bHolds = Predicate();
+			if (!bHolds && FPlatformTime::Seconds() < Deadline)
+			{
+				return true;
+			}
+
+			WaitTickerHandle.Reset();
+			Then(bHolds);
+
+			return false;
+		}));
+}
+
+#endif
@@ -0,0 +1,48 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "UObject/StrongObjectPtr.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+class FCustomSessionMockSession;
+class UCustomSessionSubsystem;
+class UGameInstance;
+struct FCustomSessionMockSettings;
+
+/**
+ * Standalone game instance whose UCustomSessionSubsystem talks to an in-process FCustomSessionMockSession,
+ * so specs can drive sessions end to end without a network or a signed in player
+ */
+class FCustomSessionTestHarness
+{
+public:
+	explicit FCustomSessionTestHarness(const FCustomSessionMockSettings& MockSettings);
+	~FCustomSessionTestHarness();
+
+	/** Few sessions and a few milliseconds of latency, fast enough for a latent spec */
+	static FCustomSessionMockSettings MakeFastMockSettings();
+
+	UCustomSessionSubsystem& GetSubsystem() const { return *Subsystem; }
+	FCustomSessionMockSession& GetMock() const { return *Mock; }
+
+	/** Ticks the game instance timers, nothing else does for a standalone one */
+	void Tick(float DeltaTime);
+
+	/**
+	 * Ticks until Predicate holds or TimeoutSeconds pass, then calls Then with whether Predicate held.
+	 * The mock completes on the core ticker
+	 */
+	void WaitUntil(TFunction<bool()>&& Predicate, float TimeoutSeconds, TFunction<void(bool)>&& Then);
+
+private:
+	TStrongObjectPtr<UGameInstance> GameInstance;
+	UCustomSessionSubsystem* Subsystem = nullptr;
+	TSharedPtr<FCustomSessionMockSession, ESPMode::ThreadSafe> Mock;
+	FTSTicker::FDelegateHandle WaitTickerHandle;
+};
+
+#endif
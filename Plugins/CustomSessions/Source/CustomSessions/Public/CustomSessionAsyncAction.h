@@ -0,0 +1,86 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Kismet/BlueprintAsyncActionBase.h"
+#include "CustomSessionAsyncAction.generated.h"
+
+class UCustomSessionSubsystem;
+enum class ECustomSessionOperation : uint8;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FCustomSessionAsyncActionCompleted);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCustomSessionJoinAsyncActionCompleted, const FString&, ConnectString);
+
+/** Latent Blueprint node for one session operation, OnSuccess or OnFailure fires once the backend completes it */
+UCLASS()
+class CUSTOMSESSIONS_API UCustomSessionOperationAsyncAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static UCustomSessionOperationAsyncAction* CreateCustomSession(UObject* WorldContextObject, FName SessionName, int32 NumPublicConnections,
+																	const FString& MatchType = TEXT("FreeForAll"));
+
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static UCustomSessionOperationAsyncAction* StartCustomSession(UObject* WorldContextObject, FName SessionName = NAME_None);
+
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static UCustomSessionOperationAsyncAction* EndCustomSession(UObject* WorldContextObject, FName SessionName = NAME_None);
+
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static UCustomSessionOperationAsyncAction* DestroyCustomSession(UObject* WorldContextObject, FName SessionName = NAME_None);
+
+	virtual void Activate() override;
+
+	UPROPERTY(BlueprintAssignable)
+	FCustomSessionAsyncActionCompleted OnSuccess;
+
+	UPROPERTY(BlueprintAssignable)
+	FCustomSessionAsyncActionCompleted OnFailure;
+
+private:
+	static UCustomSessionOperationAsyncAction* MakeAction(UObject* WorldContextObject, ECustomSessionOperation Operation, FName SessionName);
+
+	void Completed(bool bWasSuccessful);
+
+	UPROPERTY(Transient)
+	UCustomSessionSubsystem* Subsystem = nullptr;
+
+	ECustomSessionOperation Operation{};
+	FName SessionName = NAME_None;
+	int32 NumPublicConnections = 0;
+	FString MatchType;
+};
+
+/** Latent Blueprint node that searches, ranks and joins the best session, OnJoined gives where to travel */
+UCLASS()
+class CUSTOMSESSIONS_API UCustomSessionFindAndJoinAsyncAction : public UBlueprintAsyncActionBase
+{
+	GENERATED_BODY()
+
+public:
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions", meta = (BlueprintInternalUseOnly = "true", WorldContext = "WorldContextObject"))
+	static UCustomSessionFindAndJoinAsyncAction* FindAndJoinCustomSession(UObject* WorldContextObject, const FString& MatchType = TEXT("FreeForAll"),
+																		  int32 RequiredConnections = 1, int32 MaxSearchResults = 1000);
+
+	virtual void Activate() override;
+
+	UPROPERTY(BlueprintAssignable)
+	FCustomSessionJoinAsyncActionCompleted OnJoined;
+
+	/** ConnectString is empty */
+	UPROPERTY(BlueprintAssignable)
+	FCustomSessionJoinAsyncActionCompleted OnFailure;
+
+private:
+	void Completed(bool bJoined);
+
+	UPROPERTY(Transient)
+	UCustomSessionSubsystem* Subsystem = nullptr;
+
+	FString MatchType;
+	int32 RequiredConnections = 1;
+	int32 MaxSearchResults = 1000;
+};
@@ -0,0 +1,120 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CustomSessionSearchSnapshot.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "UObject/Object.h"
+#include "CustomSessionBenchmark.generated.h"
+
+class FCustomSessionMockSession;
+class UCustomSessionSubsystem;
+
+struct CUSTOMSESSIONS_API FCustomSessionBenchmarkOptions
+{
+	/** Searches and joins measured, each one a sample */
+	int32 Iterations = 20;
+
+	/** Create and destroy round trips measured for throughput */
+	int32 CreateDestroyCycles = 50;
+
+	/** Result set sizes the result processing is measured with */
+	TArray<int32> ProcessingSizes = { 10, 100, 1000 };
+
+	/** Latency of the mock backend, 0 measures the subsystem's own overhead only */
+	float MockLatencyMs = 0.0f;
+
+	int32 NumSyntheticSessions = 2000;
+
+	/** Results the mock hands out per tick, so time to first result differs from time to all results */
+	int32 SearchResultsPerTick = 100;
+
+	FString MatchType = TEXT("FreeForAll");
+
+	/** Exits once the report is written, for CI runs started with -ExecCmds */
+	bool bQuitWhenDone = false;
+
+	static FCustomSessionBenchmarkOptions FromCommandArgs(const FString& Args);
+};
+
+struct FCustomSessionBenchmarkMetric
+{
+	FString Name;
+	FString Unit;
+	TArray<double> Samples;
+};
+
+/**
+ * Drives the session subsystem against the mock backend and writes time to first result, time to join,
+ * memory allocated per search, result processing cost and create/destroy throughput as CSV and JSON to
+ * Saved/Profiling/CustomSessions, so regressions show up between builds. The allocations are the growth of the
+ * process' used memory across each search, run under Unreal Insights with -trace=memory to break them down.
+ * Run with the console command: CustomSessions.Benchmark [Iterations=20] [Cycles=50] [LatencyMs=0] [Sessions=2000] [Quit=0],
+ * or as the CustomSessions.Benchmark automation test
+ */
+UCLASS()
+class CUSTOMSESSIONS_API UCustomSessionBenchmark : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** @return nullptr if the subsystem is busy or a benchmark is already running */
+	static UCustomSessionBenchmark* Run(UCustomSessionSubsystem* Subsystem, const FCustomSessionBenchmarkOptions& Options);
+
+	static bool IsRunning() { return RunningBenchmark != nullptr; }
+
+	const TArray<FCustomSessionBenchmarkMetric>& GetMetrics() const { return Metrics; }
+
+private:
+	enum class EPhase : uint8
+	{
+		Search,
+		Join,
+		CreateDestroy,
+		Done
+	};
+
+	void Start();
+	void RunProcessingBenchmarks();
+
+	void StartSearchIteration();
+	void SearchResultsDelivered(int32 NumResults);
+	void SearchCompleted(const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful);
+
+	void StartJoinIteration();
+	void JoinCompleted(EOnJoinSessionCompleteResult::Type JoinResult);
+
+	void StartCreateDestroyCycle();
+
+	UFUNCTION()
+	void CreateCompleted(bool bWasSuccessful);
+
+	UFUNCTION()
+	void DestroyCompleted(bool bWasSuccessful);
+
+	void Finish();
+	void WriteReport() const;
+
+	void AddSample(const FString& Name, const FString& Unit, double Value);
+	void RunNextTick(void (UCustomSessionBenchmark::*Step)());
+
+	static double ElapsedMs(double StartTime);
+
+	static UCustomSessionBenchmark* RunningBenchmark;
+
+	UPROPERTY(Transient)
+	UCustomSessionSubsystem* Subsystem = nullptr;
+
+	FCustomSessionBenchmarkOptions Options;
+	TSharedPtr<FCustomSessionMockSession, ESPMode::ThreadSafe> MockSession;
+	TArray<FCustomSessionBenchmarkMetric> Metrics;
+
+	EPhase Phase = EPhase::Search;
+	int32 Iteration = 0;
+	int32 Failures = 0;
+	double OperationStartTime = 0.0;
+	double FirstResultTime = 0.0;
+	double PhaseStartTime = 0.0;
+	uint64 OperationStartUsedMemory = 0;
+};
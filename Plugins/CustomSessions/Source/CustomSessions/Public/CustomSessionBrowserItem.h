@@ -0,0 +1,52 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CustomSessionSearchSnapshot.h"
+#include "UObject/Object.h"
+#include "CustomSessionBrowserItem.generated.h"
+
+/** One row of the session browser, pooled and reused between searches by UCustomSessionBrowserWidget */
+UCLASS(BlueprintType)
+class CUSTOMSESSIONS_API UCustomSessionBrowserItem : public UObject
+{
+	GENERATED_BODY()
+
+public:
+	/** Copies only what the row displays, the result itself stays in the search */
+	void SetFromResult(const FOnlineSessionSearchResult& Result);
+
+	/** Points the item at its result in a completed search, it can be joined from then on */
+	void BindToSnapshot(const FCustomSessionSearchSnapshotRef& InSnapshot, int32 InResultIndex);
+
+	void Reset();
+
+	/** nullptr until the search the item came from completes */
+	const FOnlineSessionSearchResult* GetSearchResult() const;
+
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions|UI|Browser")
+	bool IsJoinable() const { return Snapshot.IsValid(); }
+
+	UPROPERTY(BlueprintReadOnly, Category = "Custom Sessions|UI|Browser")
+	FString SessionId;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Custom Sessions|UI|Browser")
+	FString OwnerName;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Custom Sessions|UI|Browser")
+	FString MatchType;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Custom Sessions|UI|Browser")
+	int32 PingInMs = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Custom Sessions|UI|Browser")
+	int32 OpenConnections = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Custom Sessions|UI|Browser")
+	int32 MaxConnections = 0;
+
+private:
+	FCustomSessionSearchSnapshotPtr Snapshot;
+	int32 ResultIndex = INDEX_NONE;
+};
@@ -0,0 +1,32 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/IUserObjectListEntry.h"
+#include "Blueprint/UserWidget.h"
+#include "CustomSessionBrowserRow.generated.h"
+
+class UTextBlock;
+
+/** Entry widget of the session browser list, reused by the list view for whichever item scrolls into view */
+UCLASS()
+class CUSTOMSESSIONS_API UCustomSessionBrowserRow : public UUserWidget, public IUserObjectListEntry
+{
+	GENERATED_BODY()
+
+protected:
+	virtual void NativeOnListItemObjectSet(UObject* ListItemObject) override;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* Text_Owner = nullptr;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* Text_MatchType = nullptr;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* Text_Ping = nullptr;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UTextBlock* Text_Players = nullptr;
+};
@@ -0,0 +1,130 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Blueprint/UserWidget.h"
+#include "CustomSessionSearchSnapshot.h"
+#include "CustomSessionBrowserWidget.generated.h"
+
+class UButton;
+class UCustomSessionBrowserItem;
+class UCustomSessionSubsystem;
+class UEditableTextBox;
+class UListView;
+
+UENUM(BlueprintType)
+enum class ECustomSessionBrowserSort : uint8
+{
+	Ping,
+	OpenConnections,
+	OwnerName
+};
+
+DECLARE_MULTICAST_DELEGATE_OneParam(FCustomSessionBrowserSessionChosen, const FOnlineSessionSearchResult& SearchResult);
+
+/**
+ * Session list filled while the search is still running, with sorting and filtering done on the items
+ * only: the list view virtualizes the rows and the items are pooled between searches
+ */
+UCLASS()
+class CUSTOMSESSIONS_API UCustomSessionBrowserWidget : public UUserWidget
+{
+	GENERATED_BODY()
+
+public:
+	/** Searches again, the current items are kept on screen until the new results come in */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions|UI|Browser")
+	void Refresh();
+
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions|UI|Browser")
+	void SetSortMode(ECustomSessionBrowserSort NewSortMode, bool bNewSortDescending = false);
+
+	/** Shows only sessions whose owner or match type contain the text */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions|UI|Browser")
+	void SetTextFilter(const FString& NewTextFilter);
+
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions|UI|Browser")
+	void SetHideFullSessions(bool bHide);
+
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions|UI|Browser")
+	int32 GetNumSessions() const { return Items.Num(); }
+
+	/** Broadcast when a joinable row is clicked, joining is up to the owner of the browser */
+	FCustomSessionBrowserSessionChosen OnSessionChosen;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Search sessions")
+	int32 MaxSearchResults = 1000;
+
+	/** Empty lists every match type */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Search sessions")
+	FString MatchType;
+
+protected:
+	virtual void NativeConstruct() override;
+	virtual void NativeDestruct() override;
+	virtual void NativeTick(const FGeometry& MyGeometry, float InDeltaTime) override;
+
+	void SearchProgress(const TArray<FOnlineSessionSearchResult>& PartialResults, int32 FirstNewResult);
+	void SearchCompleted(const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful);
+
+	void ItemClicked(UObject* Item);
+
+	UFUNCTION()
+	void RefreshClicked();
+
+	UFUNCTION()
+	void TextFilterChanged(const FText& Text);
+
+	UCustomSessionBrowserItem* AcquireItem();
+	void ReleaseItem(UCustomSessionBrowserItem* Item);
+	bool PassesFilter(const UCustomSessionBrowserItem* Item) const;
+
+	/** Rebuilds the visible item list, the row widgets are left to the list view */
+	void ApplySortAndFilter();
+
+	UPROPERTY(meta = (BindWidget))
+	UListView* ListView_Sessions = nullptr;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UEditableTextBox* EditableTextBox_Filter = nullptr;
+
+	UPROPERTY(meta = (BindWidgetOptional))
+	UButton* Button_Refresh = nullptr;
+
+	UPROPERTY(EditAnywhere, Category = "Browser")
+	ECustomSessionBrowserSort SortMode = ECustomSessionBrowserSort::Ping;
+
+	UPROPERTY(EditAnywhere, Category = "Browser")
+	bool bSortDescending = false;
+
+	UPROPERTY(EditAnywhere, Category = "Browser")
+	bool bHideFullSessions = false;
+
+	UPROPERTY(Transient)
+	UCustomSessionSubsystem* CustomSessionSubsystem = nullptr;
+
+	/** Every result of the current search, in the order the backend returned them */
+	UPROPERTY(Transient)
+	TArray<UCustomSessionBrowserItem*> Items;
+
+	UPROPERTY(Transient)
+	TArray<UCustomSessionBrowserItem*> VisibleItems;
+
+	UPROPERTY(Transient)
+	TArray<UCustomSessionBrowserItem*> ItemPool;
+
+	/** Items of the previous search still on screen, replaced once the new search returns anything */
+	UPROPERTY(Transient)
+	TArray<UCustomSessionBrowserItem*> StaleItems;
+
+	TMap<FString, UCustomSessionBrowserItem*> ItemsBySessionId;
+	FString TextFilter;
+	bool bListDirty = false;
+
+	/** Key of the refresh's search, progress of any other search is not ours to show */
+	FString SearchKey;
+
+	/** Bumped by every refresh, a completion from an older one is dropped */
+	uint32 RefreshSerial = 0;
+};
@@ -0,0 +1,84 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include <initializer_list>
+
+/** Most verbose diagnostics compiled in, anything above it costs nothing at all */
+#ifndef CUSTOMSESSIONS_COMPILE_TIME_VERBOSITY
+	#if UE_BUILD_SHIPPING
+		#define CUSTOMSESSIONS_COMPILE_TIME_VERBOSITY Warning
+	#else
+		#define CUSTOMSESSIONS_COMPILE_TIME_VERBOSITY All
+	#endif
+#endif
+
+/** On-screen copies of the diagnostics, for development builds with a viewport only */
+#ifndef CUSTOMSESSIONS_WITH_ONSCREEN_DIAGNOSTICS
+	#define CUSTOMSESSIONS_WITH_ONSCREEN_DIAGNOSTICS (!UE_BUILD_SHIPPING && !UE_BUILD_TEST)
+#endif
+
+CUSTOMSESSIONS_API DECLARE_LOG_CATEGORY_EXTERN(LogCustomSessions, Log, CUSTOMSESSIONS_COMPILE_TIME_VERBOSITY);
+
+/** Each category has its own rate limit, so a join storm can't hide session errors, and warnings and errors have another one */
+enum class ECustomSessionDiagnostics : uint8
+{
+	Session,
+	Search,
+	Join,
+	Players,
+	UI,
+
+	Count
+};
+
+/** A key=value pair of a diagnostics event, only built once the event passed every filter */
+struct CUSTOMSESSIONS_API FCustomSessionDiagnosticField
+{
+	FCustomSessionDiagnosticField(const TCHAR* InKey, const FString& InValue) : Key(InKey), Value(InValue) {}
+	FCustomSessionDiagnosticField(const TCHAR* InKey, const TCHAR* InValue) : Key(InKey), Value(InValue) {}
+	FCustomSessionDiagnosticField(const TCHAR* InKey, FName InValue) : Key(InKey), Value(InValue.ToString()) {}
+	FCustomSessionDiagnosticField(const TCHAR* InKey, bool bInValue) : Key(InKey), Value(bInValue ? TEXT("true") : TEXT("false")) {}
+	FCustomSessionDiagnosticField(const TCHAR* InKey, int32 InValue) : Key(InKey), Value(FString::FromInt(InValue)) {}
+	FCustomSessionDiagnosticField(const TCHAR* InKey, int64 InValue) : Key(InKey), Value(LexToString(InValue)) {}
+	FCustomSessionDiagnosticField(const TCHAR* InKey, double InValue) : Key(InKey), Value(FString::SanitizeFloat(InValue)) {}
+
+	const TCHAR* Key;
+	FString Value;
+};
+
+struct CUSTOMSESSIONS_API FCustomSessionDiagnostics
+{
+	/**
+	 * Logs "event=Name key=value ..." to LogCustomSessions and, in development builds with a viewport, on screen.
+	 * Game thread only; use CUSTOMSESSION_EVENT so the fields aren't built for filtered out events
+	 */
+	static void Emit(ECustomSessionDiagnostics Category, ELogVerbosity::Type Verbosity, const TCHAR* EventName,
+					 std::initializer_list<FCustomSessionDiagnosticField> Fields);
+
+	/**
+	 * Takes a token from the category's bucket for Verbosity, warnings and errors draw from their own so chatty events can't drown them.
+	 * OutSuppressed is how many events of the bucket were dropped since the last one
+	 */
+	static bool TryConsume(ECustomSessionDiagnostics Category, ELogVerbosity::Type Verbosity, int32& OutSuppressed);
+
+	static const TCHAR* GetCategoryName(ECustomSessionDiagnostics Category);
+};
+
+/**
+ * CUSTOMSESSION_EVENT(Join, Warning, "JoinTimedOut", {TEXT("Session"), SessionName}, {TEXT("Attempt"), Attempt});
+ * Compiled out above CUSTOMSESSIONS_COMPILE_TIME_VERBOSITY, and the fields are only evaluated for events that get emitted
+ */
+#define CUSTOMSESSION_EVENT(Category, Verbosity, EventName, ...) \
+	do \
+	{ \
+		if constexpr ((ELogVerbosity::Verbosity & ELogVerbosity::VerbosityMask) <= FLogCategoryLogCustomSessions::CompileTimeVerbosity) \
+		{ \
+			if (!LogCustomSessions.IsSuppressed(ELogVerbosity::Verbosity)) \
+			{ \
+				FCustomSessionDiagnostics::Emit(ECustomSessionDiagnostics::Category, ELogVerbosity::Verbosity, TEXT(EventName), { __VA_ARGS__ }); \
+			} \
+		} \
+	} while (false)
@@ -0,0 +1,145 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CustomSessionReservation.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+
+class FInternetAddr;
+class FSocket;
+
+/** Session id of a candidate and where its host answers latency probes */
+struct FCustomSessionProbeTarget
+{
+	FString Id;
+	FIPv4Endpoint Endpoint;
+};
+
+/** Round trip in ms per target id, negative for targets that never answered */
+DECLARE_DELEGATE_OneParam(FCustomSessionProbesCompleted, const TMap<FString, float>& /*RoundTripMsById*/);
+
+/**
+ * Answers latency probes and slot reservations on a UDP port next to the game port, so clients can measure
+ * the round trip to this host and hold their slots before joining. Polled from the core ticker
+ */
+class CUSTOMSESSIONS_API FCustomSessionProbeResponder
+{
+public:
+	~FCustomSessionProbeResponder();
+
+	/** Binds FirstPort, or the next free one of NumPortsToTry so several hosts can share a machine */
+	bool Start(int32 FirstPort, int32 NumPortsToTry = 16);
+	void Stop();
+
+	bool IsListening() const { return Socket != nullptr; }
+
+	/** Port probes are answered on, 0 when not listening */
+	int32 GetPort() const { return Port; }
+
+	/** Decides reservations, every one is refused as Unavailable while unbound */
+	FCustomSessionReserveSlots OnReserveSlots;
+	FCustomSessionReleaseSlots OnReleaseSlots;
+
+	/** Checked per sender address before OnReserveSlots is asked */
+	FCustomSessionReservationLimits Limits;
+
+private:
+	struct FGrantedReservation
+	{
+		FGuid Token;
+		int32 NumSlots = 0;
+		double ExpiryTime = 0.0;
+	};
+
+	/** Reservations granted to an address and its requests in the current second */
+	struct FSenderReservations
+	{
+		TArray<FGrantedReservation, TInlineAllocator<4>> Granted;
+		double WindowStart = 0.0;
+		int32 NumRequests = 0;
+	};
+
+	bool Tick(float DeltaTime);
+
+	/** @return nullptr if the current sender is over its request rate or no more addresses can be tracked */
+	FSenderReservations* AdmitReserveRequest(double Now);
+	ECustomSessionReservationResult Reserve(FSenderReservations& SenderReservations, const FGuid& Token, int32 NumSlots, double Now);
+	void Release(const FGuid& Token);
+
+	/** Forgets addresses without live reservations whose request window ended */
+	void PruneSenders(double Now);
+
+	/** Spoofed addresses cost a map entry each, past this many new ones are dropped */
+	static constexpr int32 MaxTrackedSenders = 1024;
+
+	FSocket* Socket = nullptr;
+	TSharedPtr<FInternetAddr> Sender;
+	int32 Port = 0;
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	TMap<FString, FSenderReservations> Senders;
+};
+
+/**
+ * Measures the round trip to several hosts in parallel with a few UDP samples each, the median of the
+ * answered samples is reported. Results are cached per host for CacheTime, cached hosts are not probed again
+ */
+class CUSTOMSESSIONS_API FCustomSessionLatencyProbe
+{
+public:
+	FCustomSessionLatencyProbe(int32 InNumSamples, float InTimeout, float InCacheTime);
+	~FCustomSessionLatencyProbe();
+
+	/**
+	 * Probes the targets, OnCompleted runs on the game thread once all of them answered every sample or
+	 * Timeout passed, right away if every target is cached. Starting a round drops the running one
+	 */
+	void Probe(TArray<FCustomSessionProbeTarget>&& Targets, FCustomSessionProbesCompleted&& OnCompleted);
+	void Cancel();
+
+	bool IsProbing() const { return TickerHandle.IsValid(); }
+
+	/** @return false if the host was not measured within CacheTime */
+	bool GetCachedRoundTrip(const FIPv4Endpoint& Endpoint, float& OutRoundTripMs) const;
+
+private:
+	struct FPendingTarget
+	{
+		FCustomSessionProbeTarget Target;
+		TSharedPtr<FInternetAddr> Address;
+		TArray<double> SendTimes;
+		TArray<float> RoundTrips;
+		uint32 AnsweredSamples = 0;
+	};
+
+	struct FCachedRoundTrip
+	{
+		float RoundTripMs = 0.0f;
+		double MeasuredTime = 0.0;
+	};
+
+	bool Tick(float DeltaTime);
+	void SendNextSamples();
+	void ReceiveAnswers();
+	void Complete();
+	bool EnsureSocket();
+
+	int32 NumSamples = 3;
+	float Timeout = 0.5f;
+	float CacheTime = 30.0f;
+
+	FSocket* Socket = nullptr;
+	TSharedPtr<FInternetAddr> Sender;
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	TArray<FPendingTarget> PendingTargets;
+	TMap<FString, float> Results;
+	FCustomSessionProbesCompleted OnProbesCompleted;
+	uint32 Round = 0;
+	int32 NextSample = 0;
+	double Deadline = 0.0;
+
+	TMap<FIPv4Endpoint, FCachedRoundTrip> Cache;
+};
@@ -0,0 +1,124 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "OnlineSessionSettings.h"
+
+/** Read from the [CustomSessions.MockSessionBackend] section of the Engine config */
+struct CUSTOMSESSIONS_API FCustomSessionMockSettings
+{
+	bool bEnabled = false;
+
+	/** Latency of every backend call is MinLatencyMs plus a random amount up to LatencyJitterMs */
+	float MinLatencyMs = 20.0f;
+	float LatencyJitterMs = 30.0f;
+
+	/** Probability in [0, 1] of any create, find or join call failing */
+	float FailureRate = 0.0f;
+
+	/** Sessions advertised by nobody in particular, what FindSessions searches through */
+	int32 NumSyntheticSessions = 2000;
+	int32 SyntheticMaxPublicConnections = 16;
+	/** 0 advertises the local build, see UCustomSessionSubsystem::ResolveBuildUniqueId */
+	int32 SyntheticBuildUniqueId = 0;
+	TArray<FString> SyntheticMatchTypes;
+	TArray<FString> SyntheticRegions;
+
+	/** Results appended to the search per tick, 0 delivers them all at once */
+	int32 SearchResultsPerTick = 0;
+
+	int32 RandomSeed = 1234;
+
+	static FCustomSessionMockSettings LoadFromConfig();
+};
+
+/** Broadcast every time a batch of results is appended to the running search */
+DECLARE_MULTICAST_DELEGATE_OneParam(FCustomSessionMockSearchResultsDelivered, int32 /*NumResults*/);
+
+/**
+ * In-process stand-in for an online session backend, with configurable latency, failures and a synthetic
+ * population of advertised sessions, so the subsystem can be driven at scale without any network
+ */
+class CUSTOMSESSIONS_API FCustomSessionMockSession : public IOnlineSession, public TSharedFromThis<FCustomSessionMockSession, ESPMode::ThreadSafe>
+{
+public:
+	explicit FCustomSessionMockSession(const FCustomSessionMockSettings& InSettings);
+	virtual ~FCustomSessionMockSession() override = default;
+
+	const FCustomSessionMockSettings& GetSettings() const { return Settings; }
+
+	/** A synthetic advertised session, the same the mock builds its population with */
+	static FOnlineSessionSearchResult MakeSyntheticResult(const FCustomSessionMockSettings& InSettings, FRandomStream& RandomStream, int32 Index);
+
+	/** Id the mock gives the local user LocalUserNum, for callers without a signed in player */
+	static FUniqueNetIdRef MakeLocalUserId(int32 LocalUserNum);
+
+	FCustomSessionMockSearchResultsDelivered OnSearchResultsDelivered;
+
+	// IOnlineSession
+	virtual FUniqueNetIdPtr CreateSessionIdFromString(const FString& SessionIdStr) override;
+	virtual FNamedOnlineSession* GetNamedSession(FName SessionName) override;
+	virtual void RemoveNamedSession(FName SessionName) override;
+	virtual EOnlineSessionState::Type GetSessionState(FName SessionName) const override;
+	virtual bool HasPresenceSession() override;
+	virtual bool CreateSession(int32 HostingPlayerNum, FName SessionName, const FOnlineSessionSettings& NewSessionSettings) override;
+	virtual bool CreateSession(const FUniqueNetId& HostingPlayerId, FName SessionName, const FOnlineSessionSettings& NewSessionSettings) override;
+	virtual bool StartSession(FName SessionName) override;
+	virtual bool UpdateSession(FName SessionName, FOnlineSessionSettings& UpdatedSessionSettings, bool bShouldRefreshOnlineData = true) override;
+	virtual bool EndSession(FName SessionName) override;
+	virtual bool DestroySession(FName SessionName, const FOnDestroySessionCompleteDelegate& CompletionDelegate = FOnDestroySessionCompleteDelegate()) override;
+	virtual bool IsPlayerInSession(FName SessionName, const FUniqueNetId& UniqueId) override;
+	virtual bool StartMatchmaking(const TArray<FUniqueNetIdRef>& LocalPlayers, FName SessionName, const FOnlineSessionSettings& NewSessionSettings, TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool CancelMatchmaking(int32 SearchingPlayerNum, FName SessionName) override;
+	virtual bool CancelMatchmaking(const FUniqueNetId& SearchingPlayerId, FName SessionName) override;
+	virtual bool FindSessions(int32 SearchingPlayerNum, const TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool FindSessions(const FUniqueNetId& SearchingPlayerId, const TSharedRef<FOnlineSessionSearch>& SearchSettings) override;
+	virtual bool FindSessionById(const FUniqueNetId& SearchingUserId, const FUniqueNetId& SessionId, const FUniqueNetId& FriendId, const FOnSingleSessionResultCompleteDelegate& CompletionDelegate) override;
+	virtual bool CancelFindSessions() override;
+	virtual bool PingSearchResults(const FOnlineSessionSearchResult& SearchResult) override;
+	virtual bool JoinSession(int32 LocalUserNum, FName SessionName, const FOnlineSessionSearchResult& DesiredSession) override;
+	virtual bool JoinSession(const FUniqueNetId& LocalUserId, FName SessionName, const FOnlineSessionSearchResult& DesiredSession) override;
+	virtual bool FindFriendSession(int32 LocalUserNum, const FUniqueNetId& Friend) override;
+	virtual bool FindFriendSession(const FUniqueNetId& LocalUserId, const FUniqueNetId& Friend) override;
+	virtual bool FindFriendSession(const FUniqueNetId& LocalUserId, const TArray<FUniqueNetIdRef>& FriendList) override;
+	virtual bool SendSessionInviteToFriend(int32 LocalUserNum, FName SessionName, const FUniqueNetId& Friend) override;
+	virtual bool SendSessionInviteToFriend(const FUniqueNetId& LocalUserId, FName SessionName, const FUniqueNetId& Friend) override;
+	virtual bool SendSessionInviteToFriends(int32 LocalUserNum, FName SessionName, const TArray<FUniqueNetIdRef>& Friends) override;
+	virtual bool SendSessionInviteToFriends(const FUniqueNetId& LocalUserId, FName SessionName, const TArray<FUniqueNetIdRef>& Friends) override;
+	virtual bool GetResolvedConnectString(FName SessionName, FString& ConnectInfo, FName PortType = NAME_GamePort) override;
+	virtual bool GetResolvedConnectString(const FOnlineSessionSearchResult& SearchResult, FName PortType, FString& ConnectInfo) override;
+	virtual FOnlineSessionSettings* GetSessionSettings(FName SessionName) override;
+	virtual bool RegisterPlayer(FName SessionName, const FUniqueNetId& PlayerId, bool bWasInvited) override;
+	virtual bool RegisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players, bool bWasInvited = false) override;
+	virtual bool UnregisterPlayer(FName SessionName, const FUniqueNetId& PlayerId) override;
+	virtual bool UnregisterPlayers(FName SessionName, const TArray<FUniqueNetIdRef>& Players) override;
+	virtual void RegisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnRegisterLocalPlayerCompleteDelegate& Delegate) override;
+	virtual void UnregisterLocalPlayer(const FUniqueNetId& PlayerId, FName SessionName, const FOnUnregisterLocalPlayerCompleteDelegate& Delegate) override;
+	virtual void RemovePlayerFromSession(int32 LocalUserNum, FName SessionName, const FUniqueNetId& TargetPlayerId) override;
+	virtual int32 GetNumSessions() override;
+	virtual void DumpSessionState() override;
+
+protected:
+	virtual FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSessionSettings& SessionSettings) override;
+	virtual FNamedOnlineSession* AddNamedSession(FName SessionName, const FOnlineSession& Session) override;
+
+private:
+	/** Runs Callback on the game thread after a simulated backend round trip */
+	void RunAfterLatency(TFunction<void(FCustomSessionMockSession&)>&& Callback);
+
+	bool ShouldFail();
+
+	void DeliverSearchResults(TSharedRef<FOnlineSessionSearch> Search, int32 SearchId, int32 NextCandidate);
+
+	FCustomSessionMockSettings Settings;
+	FRandomStream RandomStream;
+
+	TArray<FNamedOnlineSession> Sessions;
+	TArray<FOnlineSessionSearchResult> AdvertisedSessions;
+
+	/** Bumped on every search and cancel, stale deliveries compare against it */
+	int32 CurrentSearchId = 0;
+	TSharedPtr<FOnlineSessionSearch> CurrentSearch;
+};
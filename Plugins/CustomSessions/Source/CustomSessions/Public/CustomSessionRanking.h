@@ -0,0 +1,81 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+#include "CustomSessionRanking.generated.h"
+
+/** Optional extra score for a search result, added on top of the weighted terms */
+DECLARE_DELEGATE_RetVal_OneParam(float, FCustomSessionScoreDelegate, const FOnlineSessionSearchResult& /*Result*/);
+
+/** Relative importance of each term when ranking search results, every term is normalized to [0, 1] */
+USTRUCT(BlueprintType)
+struct CUSTOMSESSIONS_API FCustomSessionRankingWeights
+{
+	GENERATED_BODY()
+
+	/** Lower ping scores higher, down to zero at MaxAcceptablePingMs, or MAX_QUERY_PING without one. Unknown pings score zero */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ranking")
+	float Ping = 1.0f;
+
+	/** Sessions that keep free public connections after we join score higher, up to FreeConnectionsSaturation */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ranking")
+	float FreeConnections = 0.25f;
+
+	/** Fuller sessions score higher, so lobbies fill up before new ones get players */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ranking")
+	float FillRatio = 0.5f;
+
+	/** Sessions advertising our BuildUniqueId score higher */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ranking")
+	float BuildMatch = 2.0f;
+
+	/** Sessions advertising our region score higher */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ranking")
+	float RegionMatch = 0.5f;
+
+	/** Sessions pinging over this are discarded, unknown pings (MAX_QUERY_PING) are kept with a zero ping score. 0 accepts any */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ranking")
+	int32 MaxAcceptablePingMs = 250;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Ranking")
+	int32 FreeConnectionsSaturation = 4;
+};
+
+struct FCustomSessionRankedResult
+{
+	/** Index in the ranked search results array */
+	int32 Index = INDEX_NONE;
+	float Score = 0.0f;
+};
+
+/** Everything the ranking needs to know about the local player, so it can run without a subsystem */
+struct FCustomSessionRankingContext
+{
+	FCustomSessionRankingWeights Weights;
+	int32 BuildUniqueId = 0;
+
+	/** Sessions of other builds are discarded instead of only scoring lower */
+	bool bRequireBuildMatch = false;
+
+	FString Region;
+
+	/** Connections the joining party needs, sessions with fewer open slots are discarded */
+	int32 RequiredConnections = 1;
+
+	/** Round trips measured by probing the hosts, by session id, used instead of the backend ping when present */
+	TMap<FString, int32> MeasuredPingsMs;
+
+	FCustomSessionScoreDelegate ScoreDelegate;
+};
+
+struct CUSTOMSESSIONS_API FCustomSessionRanking
+{
+	/** Scores a single result, or returns false if it can't be joined at all */
+	static bool Score(const FOnlineSessionSearchResult& Result, const FCustomSessionRankingContext& Context, float& OutScore);
+
+	/** Fills OutRanked with the joinable results, best first; ties keep the backend order */
+	static void Rank(const TArray<FOnlineSessionSearchResult>& Results, const FCustomSessionRankingContext& Context,
+					 TArray<FCustomSessionRankedResult>& OutRanked);
+};
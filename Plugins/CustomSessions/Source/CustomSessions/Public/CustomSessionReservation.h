@@ -0,0 +1,130 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/Ticker.h"
+#include "Interfaces/IPv4/IPv4Endpoint.h"
+#include "CustomSessionReservation.generated.h"
+
+class FInternetAddr;
+class FSocket;
+
+UENUM(BlueprintType)
+enum class ECustomSessionReservationResult : uint8
+{
+	Granted,
+	/** Not enough free slots next to the players and the other reservations */
+	Full,
+	/** The host is not taking players, e.g. travelling or not running a game mode that takes reservations */
+	Unavailable,
+	/** The host never answered, only ever reported on the client */
+	TimedOut
+};
+
+/** What one address may ask of a host's probe responder, reservation requests are not authenticated */
+USTRUCT(BlueprintType)
+struct CUSTOMSESSIONS_API FCustomSessionReservationLimits
+{
+	GENERATED_BODY()
+
+	/** Slots one request may ask for, the largest party joining together, larger requests are refused as Full */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Reservations")
+	int32 MaxSlotsPerRequest = 4;
+
+	/** Reservations one address may hold at once, players behind the same NAT share it */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Reservations")
+	int32 MaxReservationsPerAddress = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Reservations")
+	int32 MaxSlotsPerAddress = 8;
+
+	/** Reserve requests answered per address and second, the rest are dropped unanswered */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Reservations")
+	int32 MaxRequestsPerSecond = 8;
+
+	/** Seconds a granted reservation counts against its address, the host's reservation lifetime */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Reservations")
+	float Lifetime = 30.0f;
+};
+
+/** Host side decision on a reservation request, run on the game thread */
+DECLARE_DELEGATE_RetVal_TwoParams(ECustomSessionReservationResult, FCustomSessionReserveSlots, const FGuid& /*Token*/, int32 /*NumSlots*/);
+DECLARE_DELEGATE_OneParam(FCustomSessionReleaseSlots, const FGuid& /*Token*/);
+DECLARE_DELEGATE_OneParam(FCustomSessionReservationCompleted, ECustomSessionReservationResult /*Result*/);
+
+/**
+ * Slots held by clients that are on their way, so a host can turn players away before they load the map.
+ * A reservation covers several players logging in with the same token, e.g. a party, and expires on its own
+ */
+class CUSTOMSESSIONS_API FCustomSessionSlotReservations
+{
+public:
+	/**
+	 * Grants NumSlots if FreeSlots still has room for them next to the other reservations. Asking again with
+	 * the same token is granted as long as it holds enough slots, and keeps it alive for another Lifetime
+	 */
+	ECustomSessionReservationResult Reserve(const FGuid& Token, int32 NumSlots, int32 FreeSlots, float Lifetime);
+
+	/** @return true if the token holds a slot for a player logging in with it */
+	bool IsReserved(const FGuid& Token);
+
+	/** Hands one slot of the reservation to a player that logged in with it, @return false if there was none */
+	bool Consume(const FGuid& Token);
+
+	void Release(const FGuid& Token);
+	void Reset() { Reservations.Reset(); }
+
+	/** Slots held for players that did not log in yet, expired reservations are dropped first */
+	int32 GetReservedSlots();
+
+private:
+	void RemoveExpired();
+
+	struct FReservation
+	{
+		int32 NumSlots = 0;
+		double ExpiryTime = 0.0;
+	};
+
+	TMap<FGuid, FReservation> Reservations;
+};
+
+/** Asks a host's probe responder for slots, resending the request until it is answered or Timeout passes */
+class CUSTOMSESSIONS_API FCustomSessionReservationClient
+{
+public:
+	FCustomSessionReservationClient(float InTimeout, int32 InMaxRequests);
+	~FCustomSessionReservationClient();
+
+	/** OnCompleted runs on the game thread, a reservation already running is dropped without completing */
+	void Reserve(const FIPv4Endpoint& Host, const FGuid& Token, int32 NumSlots, FCustomSessionReservationCompleted&& OnCompleted);
+
+	/** Tells the host it can give the slots away, fire and forget: unanswered releases expire on the host */
+	void Release(const FIPv4Endpoint& Host, const FGuid& Token);
+
+	void Cancel();
+
+	bool IsReserving() const { return TickerHandle.IsValid(); }
+
+private:
+	bool Tick(float DeltaTime);
+	void SendRequest();
+	bool EnsureSocket();
+
+	float Timeout = 1.0f;
+	int32 MaxRequests = 4;
+
+	FSocket* Socket = nullptr;
+	TSharedPtr<FInternetAddr> Sender;
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	TSharedPtr<FInternetAddr> HostAddress;
+	FGuid Token;
+	uint8 NumSlots = 1;
+	uint32 Sequence = 0;
+	int32 NumRequests = 0;
+	double StartTime = 0.0;
+	double NextRequestTime = 0.0;
+	FCustomSessionReservationCompleted OnReservationCompleted;
+};
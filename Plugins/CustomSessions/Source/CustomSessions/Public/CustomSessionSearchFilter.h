@@ -0,0 +1,35 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+
+/**
+ * A typed key/op/value condition pushed into FOnlineSessionSearch::QuerySettings so the backend can prune
+ * results, and evaluated locally for subsystems that ignore custom query settings (e.g. NULL)
+ */
+struct CUSTOMSESSIONS_API FCustomSessionSearchFilter
+{
+	FCustomSessionSearchFilter() = default;
+
+	template<typename ValueType>
+	FCustomSessionSearchFilter(FName InKey, const ValueType& InValue, EOnlineComparisonOp::Type InComparisonOp = EOnlineComparisonOp::Equals)
+		: Key(InKey)
+		, Value(InValue)
+		, ComparisonOp(InComparisonOp)
+	{
+	}
+
+	/** Evaluates the filter against the advertised settings of a search result */
+	bool Matches(const FOnlineSessionSettings& Settings) const;
+
+	/** In and NotIn, comma separated lists that lobby services compare as a single value, so they are checked locally */
+	bool IsListComparison() const { return ComparisonOp == EOnlineComparisonOp::In || ComparisonOp == EOnlineComparisonOp::NotIn; }
+
+	FString ToString() const;
+
+	FName Key = NAME_None;
+	FVariantData Value;
+	EOnlineComparisonOp::Type ComparisonOp = EOnlineComparisonOp::Equals;
+};
@@ -0,0 +1,46 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "OnlineSessionSettings.h"
+
+class FCustomSessionSearchSnapshot;
+
+using FCustomSessionSearchSnapshotRef = TSharedRef<const FCustomSessionSearchSnapshot, ESPMode::ThreadSafe>;
+using FCustomSessionSearchSnapshotPtr = TSharedPtr<const FCustomSessionSearchSnapshot, ESPMode::ThreadSafe>;
+
+/**
+ * Immutable results of one completed search, shared by the subsystem, its cache and every listener,
+ * so they can be kept around and handed to UI or ranking without copying a single result
+ */
+class CUSTOMSESSIONS_API FCustomSessionSearchSnapshot
+{
+public:
+	FCustomSessionSearchSnapshot() = default;
+	FCustomSessionSearchSnapshot(TArray<FOnlineSessionSearchResult>&& InResults, uint64 InGeneration, double InCompletedTime)
+		: Results(MoveTemp(InResults))
+		, Generation(InGeneration)
+		, CompletedTime(InCompletedTime)
+	{
+	}
+
+	const TArray<FOnlineSessionSearchResult>& GetResults() const { return Results; }
+	const FOnlineSessionSearchResult& operator[](int32 Index) const { return Results[Index]; }
+	int32 Num() const { return Results.Num(); }
+	bool IsEmpty() const { return Results.IsEmpty(); }
+
+	/** Increases with every search answered by the backend, a snapshot served again from the cache keeps its own */
+	uint64 GetGeneration() const { return Generation; }
+
+	/** FPlatformTime::Seconds() when the backend answered */
+	double GetCompletedTime() const { return CompletedTime; }
+
+	/** Shared by every failed or empty search, generation 0 */
+	static const FCustomSessionSearchSnapshotRef& Empty();
+
+private:
+	TArray<FOnlineSessionSearchResult> Results;
+	uint64 Generation = 0;
+	double CompletedTime = 0.0;
+};
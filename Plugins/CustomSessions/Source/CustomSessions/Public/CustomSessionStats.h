@@ -0,0 +1,126 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Containers/SortedMap.h"
+#include "Containers/StaticArray.h"
+#include "CustomSessionStats.generated.h"
+
+enum class ECustomSessionOperation : uint8;
+
+/**
+ * Fixed size latency histogram with logarithmic buckets from 1ms to about a minute, recording a sample never allocates.
+ * Percentiles are interpolated within a bucket, so they are accurate to the bucket width (25%)
+ */
+struct CUSTOMSESSIONS_API FCustomSessionLatencyHistogram
+{
+	static constexpr int32 NumBuckets = 52;
+
+	FCustomSessionLatencyHistogram();
+
+	void Add(double LatencyMs);
+	void Reset();
+
+	/** @param Percentile in [0, 1] */
+	double GetPercentile(double Percentile) const;
+
+	int64 GetCount() const { return Count; }
+	double GetMin() const { return Count > 0 ? Min : 0.0; }
+	double GetMax() const { return Count > 0 ? Max : 0.0; }
+	double GetMean() const { return Count > 0 ? Sum / Count : 0.0; }
+
+private:
+	static int32 GetBucket(double LatencyMs);
+	static double GetBucketLowerBound(int32 Bucket);
+
+	TStaticArray<uint32, NumBuckets> Buckets;
+	int64 Count = 0;
+	double Sum = 0.0;
+	double Min = 0.0;
+	double Max = 0.0;
+};
+
+/** Latency and outcome of one kind of session operation since the subsystem started or the stats were reset */
+USTRUCT(BlueprintType)
+struct CUSTOMSESSIONS_API FCustomSessionOperationStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	int32 Count = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	int32 Failures = 0;
+
+	/** Failures that came from giving up on the backend, counted in Failures too */
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	int32 TimeOuts = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	float LastMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	float MinMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	float MeanMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	float P50Ms = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	float P95Ms = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	float P99Ms = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	float MaxMs = 0.0f;
+
+	/** Results returned by the last search, only searches report results */
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	int32 LastResults = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Session stats")
+	int64 TotalResults = 0;
+};
+
+/**
+ * Times one kind of operation from the backend call to its completion delegate. Operations on different
+ * sessions run side by side, each one is timed on its own under the session name
+ */
+struct CUSTOMSESSIONS_API FCustomSessionOperationRecorder
+{
+	/** Starts timing, an operation already being timed on that session is restarted */
+	void Begin(ECustomSessionOperation Operation, FName SessionName = NAME_None);
+
+	/** @return false if the operation was not being timed, e.g. it failed before reaching the backend */
+	bool End(ECustomSessionOperation Operation, bool bWasSuccessful, int32 NumResults = INDEX_NONE, FName SessionName = NAME_None);
+
+	/** Records the running operation as a failure that ran out of time */
+	bool TimedOut(ECustomSessionOperation Operation, FName SessionName = NAME_None);
+
+	/** Drops the running operation without recording it, e.g. a cancelled search */
+	void Cancel(ECustomSessionOperation Operation, FName SessionName = NAME_None);
+
+	bool IsRunning(FName SessionName = NAME_None) const { return StartTimes.Contains(SessionName); }
+
+	FCustomSessionOperationStats ToStats() const;
+
+	void Reset();
+
+	/** Region shown in Unreal Insights while the operation runs */
+	static const TCHAR* GetTraceRegionName(ECustomSessionOperation Operation);
+
+private:
+	static FString GetTraceRegionName(ECustomSessionOperation Operation, FName SessionName);
+
+	TSortedMap<FName, double, TInlineAllocator<2>, FNameFastLess> StartTimes;
+	int32 Failures = 0;
+	int32 TimeOuts = 0;
+	int32 LastResults = 0;
+	int64 TotalResults = 0;
+	double LastMs = 0.0;
+	FCustomSessionLatencyHistogram Latency;
+};
@@ -3,22 +3,277 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "CustomSessionRanking.h"
+#include "CustomSessionReservation.h"
+#include "CustomSessionSearchFilter.h"
+#include "CustomSessionSearchSnapshot.h"
+#include "CustomSessionStats.h"
+#include "Async/Future.h"
+#include "Containers/Ticker.h"
+#include "Engine/EngineTypes.h"
+#include "GameFramework/OnlineReplStructs.h"
 #include "Interfaces/OnlineSessionInterface.h"
+#include "Misc/Optional.h"
 #include "Subsystems/GameInstanceSubsystem.h"
 #include "CustomSessionSubsystem.generated.h"
 
+class FCustomSessionLatencyProbe;
+class FCustomSessionMockSession;
+class FCustomSessionProbeResponder;
+class FCustomSessionReservationClient;
+class UPackage;
+struct FCustomSessionMockSettings;
+struct FCustomSessionProbeTarget;
+
 namespace CustomSessionsApi
 {
 	const FName MatchTypeKey("MatchType");
+	const FName RegionKey("Region");
+
+	/** Build id of the host, sessions of other builds are filtered out of searches */
+	const FName BuildKey("BuildId");
+
+	/** Travel URL option carrying the slot reservation token, see UCustomSessionSubsystem::SetSlotReservationHandler */
+	constexpr const TCHAR* ReservationOption = TEXT("Reservation");
+
+	/** UDP port the host answers latency probes on, next to the game port */
+	const FName ProbePortKey("ProbePort");
 }
 
+UENUM(BlueprintType)
+enum class ECustomSessionState : uint8
+{
+	Idle,
+	Creating,
+	Searching,
+	Joining,
+	InSession,
+	Starting,
+	Ending,
+	Destroying
+};
+
+UENUM(BlueprintType)
+enum class ECustomSessionOperation : uint8
+{
+	Create,
+	Find,
+	Join,
+	Start,
+	End,
+	Destroy,
+	/** GetResolvedConnectString, never queued, only timed */
+	Resolve,
+	/** UpdateSessionSettings, debounced instead of queued */
+	Update
+};
+
+/** How an operation ended, so giving up on a stalled backend can be told apart from the backend refusing */
+UENUM(BlueprintType)
+enum class ECustomSessionResult : uint8
+{
+	Success,
+	Failed,
+	TimedOut,
+	Cancelled
+};
+
+/** How far from SessionRegion a search looks, widened one step at a time while it finds too little */
+UENUM(BlueprintType)
+enum class ECustomSessionSearchScope : uint8
+{
+	Region,
+	/** SessionRegion and its RegionNeighbors */
+	Neighbors,
+	Global
+};
+
+/** Regions worth searching when the own one has too few sessions, e.g. the ones with acceptable ping */
+USTRUCT(BlueprintType)
+struct CUSTOMSESSIONS_API FCustomSessionRegionNeighbors
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Regions")
+	FString Region;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Regions")
+	TArray<FString> Neighbors;
+};
+
+UENUM(BlueprintType)
+enum class ECustomSessionQuickMatchResult : uint8
+{
+	/** Joined an existing session, the connect string is where to travel */
+	Joined,
+	/** Nothing suitable was found and a session was created, the caller should travel as listen server */
+	Hosted,
+	Failed
+};
+
+USTRUCT(BlueprintType)
+struct CUSTOMSESSIONS_API FCustomSessionQuickMatchOptions
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quick match")
+	FName SessionName = NAME_GameSession;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quick match")
+	int32 MaxSearchResults = 100;
+
+	/** Open connections a session needs to be considered, e.g. the party size */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quick match")
+	int32 RequiredConnections = 1;
+
+	/** Host a new session when searching and joining gave nothing */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quick match")
+	bool bHostIfNoneFound = true;
+
+	/** Seconds to search before giving up on joining and hosting instead */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quick match")
+	float HostDeadline = 5.0f;
+
+	/** Public connections of the session hosted as fallback */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Quick match")
+	int32 NumPublicConnections = 4;
+};
+
+/** Changes to the hosted session, only what is overridden is compared against the current settings */
+USTRUCT(BlueprintType)
+struct CUSTOMSESSIONS_API FCustomSessionSettingsChange
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings", meta = (InlineEditConditionToggle))
+	bool bOverride_NumPublicConnections = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings", meta = (EditCondition = "bOverride_NumPublicConnections"))
+	int32 NumPublicConnections = 4;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings", meta = (InlineEditConditionToggle))
+	bool bOverride_MatchType = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings", meta = (EditCondition = "bOverride_MatchType"))
+	FString MatchType;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings", meta = (InlineEditConditionToggle))
+	bool bOverride_AllowJoinInProgress = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings", meta = (EditCondition = "bOverride_AllowJoinInProgress"))
+	bool bAllowJoinInProgress = true;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings", meta = (InlineEditConditionToggle))
+	bool bOverride_ShouldAdvertise = false;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings", meta = (EditCondition = "bOverride_ShouldAdvertise"))
+	bool bShouldAdvertise = true;
+
+	/** Advertised key/values, e.g. the lobby map or phase */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Session settings")
+	TMap<FName, FString> Values;
+
+	bool IsEmpty() const;
+
+	/** Overrides everything Newer overrides, keeping the rest */
+	void Merge(const FCustomSessionSettingsChange& Newer);
+
+	/**
+	 * Applies the values that differ from Settings
+	 * @return the keys that changed, empty if Settings already matched
+	 */
+	TArray<FName> ApplyTo(FOnlineSessionSettings& Settings) const;
+};
+
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCustomSessionCreateSessionCompleted, bool, bWasSuccessful);
-DECLARE_MULTICAST_DELEGATE_TwoParams(FCustomSessionFindSessionsCompleted, const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful);
+/** Listeners may keep the snapshot as long as they need, the next search never touches it */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FCustomSessionFindSessionsCompleted, const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful);
+/** Results the backend returned so far for the running search, the array is only valid during the broadcast */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FCustomSessionSearchProgress, const TArray<FOnlineSessionSearchResult>& PartialResults, int32 FirstNewResult);
 DECLARE_MULTICAST_DELEGATE_OneParam(FCustomsessionJoinSessionCompleted, EOnJoinSessionCompleteResult::Type SessionResult);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCustomSessionStartSessionCompleted, bool, bWasSuccessful);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCustomSessionEndSessionCompleted, bool, bWasSuccessful);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCustomSessionDestroySessionCompleted, bool, bWasSuccessful);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FCustomSessionUpdateSessionCompleted, bool, bWasSuccessful);
+DECLARE_MULTICAST_DELEGATE_OneParam(FCustomSessionStateChanged, ECustomSessionState NewState);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FCustomSessionNamedStateChanged, FName SessionName, ECustomSessionState NewState);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FCustomSessionOperationTimedOut, ECustomSessionOperation Operation, FName SessionName);
+DECLARE_MULTICAST_DELEGATE_TwoParams(FCustomSessionQuickMatchCompleted, ECustomSessionQuickMatchResult Result, const FString& ConnectString);
+
+/** Request received while another operation was running, executed once the subsystem settles */
+struct FCustomSessionPendingOperation
+{
+	ECustomSessionOperation Operation = ECustomSessionOperation::Find;
+
+	/** Requests of the same operation and key are merged, e.g. the session name or the search cache key */
+	FString Key;
+
+	/** Session the request waits for, searches wait for the running search instead */
+	FName SessionName = NAME_None;
+
+	TFunction<void()> Execute;
+
+	/** Join future waiting on this request, resolved as cancelled when a later request replaces it. 0 if none */
+	uint32 RequestId = 0;
+};
+
+/** Join the subsystem gave up on while the backend may still complete it and open the session */
+struct FCustomSessionAbandonedJoin
+{
+	FDelegateHandle JoinSessionCompleteHandle;
+	FTimerHandle GracePeriodTimerHandle;
+};
 
-UCLASS()
+/** What FindSessionsAsync resolves to, the same OnCustomSessionFindSessionsCompleted receives */
+struct FCustomSessionFindResult
+{
+	FCustomSessionSearchSnapshotRef Snapshot = FCustomSessionSearchSnapshot::Empty();
+	bool bWasSuccessful = false;
+	ECustomSessionResult Result = ECustomSessionResult::Failed;
+};
+
+/** What JoinSessionAsync and JoinBestSessionAsync resolve to, the same OnCustomsessionJoinSessionCompleted receives */
+struct FCustomSessionJoinResult
+{
+	EOnJoinSessionCompleteResult::Type JoinResult = EOnJoinSessionCompleteResult::UnknownError;
+
+	/** Cancelled as well when a later join queued before this one ran replaced it */
+	ECustomSessionResult Result = ECustomSessionResult::Failed;
+};
+
+/** Promise handed out by one of the Async calls, resolved by the completion of that operation on that key */
+template <typename ResultType>
+struct TCustomSessionWaiter
+{
+	ECustomSessionOperation Operation = ECustomSessionOperation::Find;
+
+	/** Session name, or the search cache key for searches */
+	FString Key;
+
+	/** Set for joins, only the completion of that one request resolves them */
+	uint32 RequestId = 0;
+
+	TPromise<ResultType> Promise;
+};
+
+/** What the subsystem keeps about one named session, the backend owns the session itself */
+struct FCustomSessionNamedState
+{
+	ECustomSessionState State = ECustomSessionState::Idle;
+
+	/** What the session was created with or last updated to */
+	TSharedPtr<FOnlineSessionSettings> Settings;
+
+	FCustomSessionSettingsChange PendingSettingsChange;
+	bool bSettingsUpdateInFlight = false;
+
+	/** What the running update sends and what the backend had before, committed or restored by its completion */
+	FCustomSessionSettingsChange InFlightSettingsChange;
+	TOptional<FOnlineSessionSettings> InFlightSettings;
+	TOptional<FOnlineSessionSettings> PreviousSettings;
+};
+
+UCLASS(config = Game)
 class CUSTOMSESSIONS_API UCustomSessionSubsystem : public UGameInstanceSubsystem
 {
 	GENERATED_BODY()
@@ -31,58 +286,671 @@ public:
 		return true;
 	}
 	
+	/**
+	 * Replaces the online subsystem's session interface with an in-process mock, e.g. for benchmarks
+	 * @return nullptr if an operation is running
+	 */
+	TSharedPtr<FCustomSessionMockSession, ESPMode::ThreadSafe> UseMockBackend(const FCustomSessionMockSettings& MockSettings);
+
+	/**
+	 * Creates the session, or promotes the warm session of that name with a single settings update when
+	 * PrewarmHostSession prepared one
+	 */
 	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
 	void CreateSession(FName SessionName, int32 NumPublicConnections, const FString& MatchType = TEXT("FreeForAll"));
 
+	/**
+	 * Creates an unadvertised session named WarmSessionName and preloads PrewarmLobbyMap, so hosting later is
+	 * one UpdateSession instead of destroy, create and a cold map load. Does nothing unless bPrewarmHostSession
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	void PrewarmHostSession();
+
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions")
+	bool HasWarmSession() const { return WarmSessionName != NAME_None; }
+
+	/**
+	 * Loads a map package in the background and keeps it in memory across travels, so travelling there later
+	 * finds it loaded instead of hitching on the load. Released once that map is loaded or by ReleasePreloadedMaps
+	 * @param MapName long package name, e.g. /Game/Maps/Arena, travel options are ignored
+	 * @return false if MapName is not a valid long package name
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	bool PreloadMap(const FString& MapName);
+
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions")
+	bool IsMapPreloaded(const FString& MapName) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	void ReleasePreloadedMaps();
+
 	UFUNCTION(BlueprintCallable, BlueprintPure = false, Category = "Custom Sessions", meta = (AdvancedDisplay = true))
 	bool FindSession(int32 MaxSearchResults = 1000, 
 					 FName SessionName = TEXT("GameSession"), 
 					 const FString& MatchType = TEXT("FreeForAll"));
 
+	/** Same as FindSession, with extra filters pushed to the backend on top of the match type */
+	bool FindSessionWithFilters(const TArray<FCustomSessionSearchFilter>& Filters,
+								int32 MaxSearchResults = 1000,
+								FName SessionName = TEXT("GameSession"),
+								const FString& MatchType = TEXT("FreeForAll"));
 
-	void JoinSession(const FOnlineSessionSearchResult& SearchResult);
+	/** Drops every cached search, next FindSession calls will always query the backend */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	void InvalidateSearchCache();
 
-	void StartSession();
-	
-	void DestroySession();
+	/**
+	 * Removes the results not matching every filter, what a search completion runs with the filters the backend
+	 * could not apply
+	 * @return how many were removed
+	 */
+	static int32 FilterSearchResults(TArray<FOnlineSessionSearchResult>& SearchResults, const TArray<FCustomSessionSearchFilter>& Filters);
+
+	/** Joinable results sorted best first by RankingWeights and the optional ScoreDelegate */
+	TArray<FCustomSessionRankedResult> RankSessions(const TArray<FOnlineSessionSearchResult>& SearchResults, int32 RequiredConnections = 1) const;
+
+	FCustomSessionRankingContext MakeRankingContext(int32 RequiredConnections = 1) const;
+
+	/** Build hosted sessions advertise and searches look for */
+	int32 GetSessionBuildUniqueId() const { return ResolveBuildUniqueId(BuildUniqueId); }
+
+	/** @return ConfiguredId, or the online subsystem's build id when it is 0 */
+	static int32 ResolveBuildUniqueId(int32 ConfiguredId);
+
+	/**
+	 * Stops the running search, listeners get a failure with no results
+	 * @return false if nothing was being searched
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	bool CancelFindSessions();
+
+	/** Joins under SessionName, or under the name the last FindSession was given if None */
+	void JoinSession(const FOnlineSessionSearchResult& SearchResult, FName SessionName = NAME_None);
+
+	/**
+	 * Joins the best ranked result of the last search, under the name that search was given, falling back to the next candidates
+	 * (up to MaxJoinAttempts, within JoinTotalDeadline) before broadcasting a failure
+	 * @return false if there was nothing to join, no delegate is broadcast then
+	 */
+	bool JoinBestSession(int32 RequiredConnections = 1);
+
+	/**
+	 * Stops the running join and the remaining candidates, listeners get UnknownError. A session the backend
+	 * already opened for it is destroyed
+	 * @return false if nothing was being joined
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	bool CancelJoinSession();
+
+	/**
+	 * Token the slots of the last join were reserved with, party members travel with it to use the slots
+	 * reserved for them. Invalid if the host did not take reservations
+	 */
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions")
+	FGuid GetSlotReservationToken() const { return ReservedSessionName != NAME_None ? JoinReservationToken : FGuid(); }
+
+	/**
+	 * Lets the game mode of this host decide on the slot reservations clients send before travelling, so a full
+	 * or travelling host turns them away in a round trip instead of after a map load. Unbound, every one is refused
+	 */
+	void SetSlotReservationHandler(FCustomSessionReserveSlots&& OnReserve, FCustomSessionReleaseSlots&& OnRelease);
+
+	/** Unbinds the handler if Owner bound it */
+	void ClearSlotReservationHandler(const UObject* Owner);
+
+	/**
+	 * Finds, ranks and joins a session of MatchType without any UI, joining as soon as an acceptable result
+	 * shows up while the backend is still searching, and optionally hosting one when nothing is found in time
+	 * @return false if a quick match is already running, OnCustomSessionQuickMatchCompleted is broadcast otherwise
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	bool QuickMatch(const FString& MatchType, const FCustomSessionQuickMatchOptions& Options);
+
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions")
+	bool IsQuickMatchInProgress() const { return bQuickMatchInProgress; }
+
+	/** Moves the session to InProgress, the current one if None */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	void StartSession(FName SessionName = NAME_None);
+
+	/** Moves the session back to Ended, it can be started again afterwards. The current one if None */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	void EndSession(FName SessionName = NAME_None);
+
+	/** Destroys the session, the current one if None */
+	void DestroySession(FName SessionName = NAME_None);
+
+	/**
+	 * Changes the hosted session in place, keeping its advertisement. Changes received within
+	 * SessionSettingsUpdateDebounce are merged, then a single UpdateSession is sent if anything differs.
+	 * A failed update keeps the previous settings and its change pending, it goes out again with the next one
+	 * @return false if there is no hosted session to update, the current one if SessionName is None
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	bool UpdateSessionSettings(const FCustomSessionSettingsChange& Change, FName SessionName = NAME_None);
+
+	/** Sends the pending settings changes of every session right away */
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	void FlushSessionSettingsUpdate();
+
+	/**
+	 * Future based versions of the calls above, for chaining operations with Then instead of binding delegates.
+	 * Requests are queued and merged like the others, and each future is resolved on the game thread right
+	 * before the matching delegate is broadcast, or with a failure when the subsystem shuts down
+	 */
+	TFuture<bool> CreateSessionAsync(FName SessionName, int32 NumPublicConnections, const FString& MatchType = TEXT("FreeForAll"));
+	TFuture<FCustomSessionFindResult> FindSessionsAsync(const TArray<FCustomSessionSearchFilter>& Filters,
+														int32 MaxSearchResults = 1000,
+														FName SessionName = TEXT("GameSession"),
+														const FString& MatchType = TEXT("FreeForAll"));
+	TFuture<FCustomSessionJoinResult> JoinSessionAsync(const FOnlineSessionSearchResult& SearchResult, FName SessionName = NAME_None);
+
+	/** Joins the best ranked result of Snapshot, resolves with SessionDoesNotExist if nothing in it is joinable */
+	TFuture<FCustomSessionJoinResult> JoinBestSessionAsync(const FCustomSessionSearchSnapshotRef& Snapshot, int32 RequiredConnections = 1,
+																	 FName SessionName = NAME_None);
+	TFuture<bool> StartSessionAsync(FName SessionName = NAME_None);
+	TFuture<bool> EndSessionAsync(FName SessionName = NAME_None);
+	TFuture<bool> DestroySessionAsync(FName SessionName = NAME_None);
+
+	/** Travel address of the session, the current one if None, timed like the other operations. Carries the reservation token if slots were reserved */
+	bool ResolveConnectString(FString& OutConnectString, FName SessionName = NAME_None);
+
+	/**
+	 * Registers a player in the current session, batched with the other registrations received during
+	 * PlayerRegistrationBatchWindow so a lobby rush costs one backend call instead of one per player
+	 */
+	void QueueRegisterPlayer(const FUniqueNetIdRepl& PlayerId);
+	void QueueUnregisterPlayer(const FUniqueNetIdRepl& PlayerId);
+
+	/** Sends the queued registrations right away */
+	void FlushPlayerRegistrations();
 
-	TSharedRef<FOnlineSessionSettings> GetSessionSettings() const { return SessionSettings.ToSharedRef(); }
+	/** Summary of every session and the search: the first one in transition, else Searching, InSession or Idle */
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions")
+	ECustomSessionState GetSessionState() const { return State; }
+
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions")
+	ECustomSessionState GetNamedSessionState(FName SessionName) const;
+
+	/** Names of the sessions created or joined and not destroyed yet, the warm one included */
+	TArray<FName> GetNamedSessions() const;
+
+	/**
+	 * Dedicated servers host without a local player, the backend is called for the server's own identity and
+	 * sessions are created without presence or lobbies, which belong to a user
+	 */
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions")
+	bool IsDedicatedServer() const;
+
+	/** Whether any operation or search is running */
+	bool IsBusy() const { return State != ECustomSessionState::Idle && State != ECustomSessionState::InSession; }
+
+	/** Whether an operation on that session is running, requests for it are queued until it completes */
+	bool IsSessionBusy(FName SessionName) const;
+
+	bool IsSearching() const { return SessionSearch.IsValid(); }
+
+	/** Key a search with these filters and match type is merged and cached under */
+	FString GetSearchKey(const TArray<FCustomSessionSearchFilter>& Filters, const FString& MatchType) const;
+
+	/** Whether the search the backend is running is the one SearchKey names, progress is only reported for that one */
+	bool IsSearchInFlight(const FString& SearchKey) const { return IsSearching() && InFlightSearchKey == SearchKey; }
+	bool IsJoining() const { return JoinSessionName != NAME_None; }
+
+	/** Settings of the session, the current one if None */
+	TSharedPtr<FOnlineSessionSettings> GetSessionSettings(FName SessionName = NAME_None) const;
+
+	/** Count, failures and latency percentiles of an operation, measured from the backend call to its completion */
+	UFUNCTION(BlueprintPure, Category = "Custom Sessions")
+	FCustomSessionOperationStats GetOperationStats(ECustomSessionOperation Operation) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Custom Sessions")
+	void ResetOperationStats();
+
+	/** Last successful search broadcast to listeners, what JoinBestSession picks from */
+	FCustomSessionSearchSnapshotPtr GetLastSearchSnapshot() const { return LastSnapshot; }
 	
 	FCustomSessionCreateSessionCompleted OnCustomSessionCreateSessionCompleted;
 	FCustomSessionFindSessionsCompleted OnCustomSessionFindSessionsCompleted;
+
+	/** Polled every tick while searching, only when something is bound before the search starts */
+	FCustomSessionSearchProgress OnCustomSessionSearchProgress;
 	FCustomsessionJoinSessionCompleted OnCustomsessionJoinSessionCompleted;
 	FCustomSessionStartSessionCompleted OnCustomSessionStartSessionCompleted;
+	FCustomSessionEndSessionCompleted OnCustomSessionEndSessionCompleted;
 	FCustomSessionDestroySessionCompleted OnCustomSessionDestroySessionCompleted;
 
+	/** Broadcast once per UpdateSession sent, not per UpdateSessionSettings call */
+	FCustomSessionUpdateSessionCompleted OnCustomSessionUpdateSessionCompleted;
+	FCustomSessionQuickMatchCompleted OnCustomSessionQuickMatchCompleted;
+
+	/** Broadcast right before the failure of a search or join that ran out of time */
+	FCustomSessionOperationTimedOut OnCustomSessionOperationTimedOut;
+	FCustomSessionStateChanged OnCustomSessionStateChanged;
+	FCustomSessionNamedStateChanged OnCustomSessionNamedStateChanged;
+
+	/** Last session created or joined, what calls without a session name apply to */
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Session")
 	FName CurrentGameSession = NAME_None;
 
 	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Session")
 	FString CurrentMatchType = "";
 
+	/** How far the last search had to look to find MinRegionSearchResults */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Session")
+	ECustomSessionSearchScope LastSearchScope = ECustomSessionSearchScope::Global;
+
+	/** Results the backend returned but that had to be discarded locally in the last search */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Session")
+	int32 LastDiscardedSearchResults = 0;
+
+	/** Results discarded locally since the subsystem started, what server-side filtering would have saved */
+	UPROPERTY(BlueprintReadOnly, VisibleAnywhere, Category = "Session")
+	int64 TotalDiscardedSearchResults = 0;
+
+	/** Seconds a search may take before it is cancelled and reported as timed out, per scope when it widens. 0 waits forever */
+	UPROPERTY(Config, EditAnywhere, Category = "Search sessions")
+	float FindSessionsTimeout = 15.0f;
+
+	/** Seconds a search result set is served from the cache without querying the backend again. Searches finding nothing aren't cached */
+	UPROPERTY(Config, EditAnywhere, Category = "Search sessions")
+	float SearchCacheTimeToLive = 10.0f;
+
+	/** Seconds an expired result set is still served while a background search refreshes it */
+	UPROPERTY(Config, EditAnywhere, Category = "Search sessions")
+	float SearchCacheMaxStaleAge = 60.0f;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Search sessions")
+	FCustomSessionRankingWeights RankingWeights;
+
+	/** Region advertised by hosted sessions, searched first and preferred when ranking search results */
+	UPROPERTY(Config, EditAnywhere, Category = "Sessions")
+	FString SessionRegion;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Sessions")
+	TArray<FCustomSessionRegionNeighbors> RegionNeighbors;
+
+	/** Searches finding fewer sessions than this in SessionRegion look in its neighbors, then everywhere. 0 never widens */
+	UPROPERTY(Config, EditAnywhere, Category = "Search sessions")
+	int32 MinRegionSearchResults = 5;
+
+	/** Build advertised by hosted sessions, 0 uses the online subsystem's id derived from the network version */
+	UPROPERTY(Config, EditAnywhere, Category = "Sessions")
+	int32 BuildUniqueId = 0;
+
+	/** Only find sessions of our own build, joining any other fails the network version check */
+	UPROPERTY(Config, EditAnywhere, Category = "Search sessions")
+	bool bFilterSearchByBuild = true;
+
+	/** Search dedicated servers instead of player hosted sessions, backends like Steam list them apart */
+	UPROPERTY(Config, EditAnywhere, Category = "Search sessions")
+	bool bSearchDedicatedServers = false;
+
+	/** Ranked candidates tried by JoinBestSession before giving up */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	int32 MaxJoinAttempts = 3;
+
+	/** Seconds to wait for a single join before moving to the next candidate */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	float JoinAttemptTimeout = 10.0f;
+
+	/** Seconds after which JoinBestSession stops trying new candidates */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	float JoinTotalDeadline = 20.0f;
+
+	/** Seconds a timed out or cancelled join may still complete, joins and creates under its name wait for it meanwhile */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	float AbandonedJoinGracePeriod = 15.0f;
+
+	/** Measure the round trip to the best candidates before joining, instead of trusting the backend ping */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	bool bProbeLatencyBeforeJoin = false;
+
+	/** Best ranked candidates probed, the rest keep the backend ping */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	int32 NumLatencyProbeCandidates = 4;
+
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	int32 LatencyProbeSamples = 3;
+
+	/** Seconds probing may delay the join, hosts that did not answer by then rank as unreachable */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	float LatencyProbeTimeout = 0.5f;
+
+	/** Seconds a measured round trip is reused instead of probing the host again */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	float LatencyProbeCacheTime = 30.0f;
+
+	/** First UDP port hosted sessions answer latency probes on, 0 to not answer them */
+	UPROPERTY(Config, EditAnywhere, Category = "Host sessions")
+	int32 LatencyProbePort = 7787;
+
+	/** What each address may reserve at a hosted session, requests over them are refused or dropped */
+	UPROPERTY(Config, EditAnywhere, Category = "Host sessions")
+	FCustomSessionReservationLimits SlotReservationLimits;
+
+	/** Reserve the joining slots at hosts answering on their probe port before joining, full hosts are skipped right away */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	bool bReserveSlotsBeforeJoin = true;
+
+	/** Seconds to wait for a host to answer a reservation, hosts that don't are joined without one */
+	UPROPERTY(Config, EditAnywhere, Category = "Join sessions")
+	float SlotReservationTimeout = 1.0f;
+
+	/** Seconds settings changes are accumulated before a single UpdateSession is sent */
+	UPROPERTY(Config, EditAnywhere, Category = "Host sessions")
+	float SessionSettingsUpdateDebounce = 1.0f;
+
+	/** Keep a session created ahead of time, see PrewarmHostSession */
+	UPROPERTY(Config, EditAnywhere, Category = "Host sessions")
+	bool bPrewarmHostSession = false;
+
+	/** Name the warm session is created with, CreateSession with any other name creates from scratch */
+	UPROPERTY(Config, EditAnywhere, Category = "Host sessions")
+	FName PrewarmSessionName = NAME_GameSession;
+
+	/** Package of the lobby map kept loaded next to the warm session, e.g. /Game/ThirdPerson/Maps/ThirdPersonMap. Empty to skip */
+	UPROPERTY(Config, EditAnywhere, Category = "Host sessions")
+	FString PrewarmLobbyMap;
+
+	/** Seconds player registrations are accumulated before being sent in a single call */
+	UPROPERTY(Config, EditAnywhere, Category = "Sessions")
+	float PlayerRegistrationBatchWindow = 0.25f;
+
+	/** Game specific scoring on top of RankingWeights */
+	FCustomSessionScoreDelegate ScoreDelegate;
+
 	IOnlineSessionPtr OnlineSession = nullptr;
 
+	/** True when [CustomSessions.MockSessionBackend] replaced the online subsystem's session interface */
+	UPROPERTY(BlueprintReadOnly, Category = "Custom Sessions")
+	bool bUsingMockBackend = false;
+
 private:
+	void ExecuteCreateSession(FName SessionName, int32 NumPublicConnections, const FString& MatchType, bool bDestroyedExisting);
+	void ExecuteDestroySession(FName SessionName);
+
+	/** JoinSession for the join future RequestId, 0 when nobody waits on a future */
+	void ExecuteJoinSession(const FOnlineSessionSearchResult& SearchResult, FName SessionName, uint32 RequestId);
+
+	/** Settles the warm session as the hosted one, falls back to creating from scratch if the update fails */
+	void PromoteWarmSession(int32 NumPublicConnections, const FString& MatchType);
+
+	void ExecuteSessionSettingsUpdate(FName SessionName, FCustomSessionNamedState& Named);
+
+	/**
+	 * Destroys the warm session, e.g. before joining someone else's
+	 * @return false if there was none
+	 */
+	bool ReleaseWarmSession();
+
+	void MapPreloaded(const FName& PackageName, UPackage* LoadedPackage, EAsyncLoadingResult::Type Result, double StartTime);
+	void PostLoadMapWithWorld(UWorld* LoadedWorld);
+
+	/** @return NAME_None if MapName is not a valid long package name */
+	static FName GetMapPackageName(const FString& MapName);
+
+	/** Starts answering latency probes and reservations if hosting enables them, before the settings advertise the port */
+	void EnsureProbeResponder();
+	ECustomSessionReservationResult ReserveSlots(const FGuid& Token, int32 NumSlots);
+	void ReleaseSlots(const FGuid& Token);
+
+	/** Probes the best join candidates, then joins them ranked by the measured round trips */
+	void ProbeJoinCandidates(int32 RequiredConnections);
+	bool MakeProbeTarget(const FOnlineSessionSearchResult& SearchResult, FCustomSessionProbeTarget& OutTarget) const;
+
+	/** Fills Settings the way every hosted session is advertised */
+	void ApplyHostSettings(FOnlineSessionSettings& Settings, int32 NumPublicConnections, const FString& MatchType) const;
+
+	/** Create and update are routed by session name, so they stay bound for as long as the backend is used */
+	void BindBackendDelegates();
+	void UnbindBackendDelegates();
+
+	FName ResolveSessionName(FName SessionName) const { return SessionName != NAME_None ? SessionName : CurrentGameSession; }
+
+	/** Idle or InSession, whichever matches what the backend has under that name */
+	ECustomSessionState GetSettledState(FName SessionName) const;
+	void SetSessionState(FName SessionName, ECustomSessionState NewState);
+
+	/** Recomputes the summary State from the named sessions and the search */
+	void RefreshState();
+
+	/** The warm session, or the one being created as it, which callers are not told about */
+	bool IsWarmSession(FName SessionName) const;
+
+	void BeginOperation(ECustomSessionOperation Operation, FName SessionName = NAME_None);
+	void EndOperation(ECustomSessionOperation Operation, bool bWasSuccessful, int32 NumResults = INDEX_NONE, FName SessionName = NAME_None);
+
+	/**
+	 * Operations on a session wait for the one running on it; searches wait for the running search and join,
+	 * joins also wait for the search. Anything else runs side by side
+	 */
+	bool IsOperationBlocked(ECustomSessionOperation Operation, FName SessionName) const;
+
+	/** Queues a request for when the operation blocking it completes, merging it with an equivalent queued one */
+	void EnqueueOperation(ECustomSessionOperation Operation, const FString& Key, FName SessionName, TFunction<void()>&& Execute, uint32 RequestId = 0);
+	void ProcessPendingOperations();
+
+	/** NULL subsystem sessions are LAN only; never true for the mock backend */
+	bool IsLanSubsystem() const;
+
+	/** Id of the first local player, the mock's user 0 without one, null on a dedicated server */
+	FUniqueNetIdPtr GetLocalUserId() const;
+
+	/** Whether the current online subsystem applies custom QuerySettings on its side */
+	bool CanFilterSearchOnBackend() const;
+
+	/** Whether the backend is sent the filter, lobby services compare single values so In and NotIn lists are checked here */
+	bool IsFilterAppliedByBackend(const FCustomSessionSearchFilter& Filter) const;
+
+	/** Drops results not matching the active filters when the backend could not apply them */
+	void FilterSearchResultsLocally();
+
+	/** Sends SessionSearch to the backend with the request filters and the region filter of SearchScope */
+	bool StartBackendSearch();
+
+	/** Runs the search again over the next scope if the current one found too little, its results kept as fallback */
+	bool WidenSearch();
+
+	FCustomSessionSearchFilter MakeScopeFilter(ECustomSessionSearchScope Scope) const;
+	const TArray<FString>* FindNeighborRegions() const;
+
+	bool JoinBestSessionFrom(const FCustomSessionSearchSnapshotRef& Snapshot, int32 RequiredConnections, FName SessionName, uint32 RequestId = 0);
+	/** Reserves the slots at the host first when it takes reservations, then joins it on the backend */
+	bool StartJoinAttempt(const FOnlineSessionSearchResult& SearchResult);
+	bool StartBackendJoin(const FOnlineSessionSearchResult& SearchResult);
+	void SlotReservationCompleted(const FOnlineSessionSearchResult& SearchResult, const FIPv4Endpoint& Host, ECustomSessionReservationResult Result);
+
+	/** Gives back the slots held at the candidate that could not be joined */
+	void ReleaseSlotReservation();
+	void TryNextJoinCandidate(EOnJoinSessionCompleteResult::Type LastResult);
+	void FinishJoin(EOnJoinSessionCompleteResult::Type JoinResult);
+
+	void SchedulePlayerRegistrationFlush();
+	void ScheduleSessionSettingsUpdate();
+	void JoinAttemptTimedOut();
+
+	/** Destroys the session a join given up on opens, now or when the backend completes it late */
+	void AbandonJoin(FName SessionName);
+	void AbandonedJoinCompleted(FName SessionName, EOnJoinSessionCompleteResult::Type JoinResult);
+	void DestroyAbandonedSession(FName SessionName);
+	void ForgetAbandonedJoin(FName SessionName);
+	void FindSessionsTimedOut();
+
+	/**
+	 * Stops waiting for the running search, its results are not cached. Listeners are told with Reason
+	 * if bBroadcast and the search was not a background refresh
+	 */
+	void CancelInFlightSearch(ECustomSessionResult Reason, bool bBroadcast);
+
+	/** Reports the results of the running search as they arrive, while anyone listens to OnCustomSessionSearchProgress */
+	void StartSearchProgressTicker();
+	bool PollSearchProgress(float DeltaTime);
+	bool PollQuickMatchSearch(float DeltaTime);
+	void QuickMatchSearchCompleted(const FCustomSessionFindResult& FindResult);
+	void QuickMatchJoin(const FCustomSessionSearchSnapshotRef& Snapshot);
+	void QuickMatchJoinCompleted(const FCustomSessionJoinResult& JoinResult);
+	void QuickMatchDeadlineReached();
+	void QuickMatchHost();
+
+	/** Whether the quick match that sent a request is still the one running, completions of an older one are dropped */
+	bool IsCurrentQuickMatch(uint32 Serial) const { return bQuickMatchInProgress && Serial == QuickMatchSerial; }
+
+	void FinishQuickMatch(ECustomSessionQuickMatchResult Result, const FString& ConnectString = FString());
+
+	void BroadcastSearchResults(const FString& SearchKey, const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful);
+
+	/** Resolves the futures waiting on the operation, then broadcasts its delegate */
+	void BroadcastOperationCompleted(ECustomSessionOperation Operation, FName SessionName, bool bWasSuccessful);
+	void BroadcastFindCompleted(const FString& SearchKey, const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful,
+								ECustomSessionResult FailureReason = ECustomSessionResult::Failed);
+	/** Resolves the future of RequestId only, joins queued or started by others are not its business */
+	void BroadcastJoinCompleted(FName SessionName, EOnJoinSessionCompleteResult::Type JoinResult, uint32 RequestId,
+								ECustomSessionResult Result = ECustomSessionResult::Failed);
+
+	/** Builds the filters a search is sent with, the match type and build first, without the region scope */
+	TArray<FCustomSessionSearchFilter> MakeSearchFilters(const TArray<FCustomSessionSearchFilter>& Filters, const FString& MatchType) const;
+
+	/** Moves the results out of the search, it must not be used by the backend anymore */
+	FCustomSessionSearchSnapshotRef MakeSnapshot(TArray<FOnlineSessionSearchResult>&& Results);
+
+	static FString MakeSearchCacheKey(const TArray<FCustomSessionSearchFilter>& Filters, bool bIsLanQuery);
+	void AddToSearchCache(const FString& SearchKey, const FCustomSessionSearchSnapshotRef& Snapshot);
+
 	void CreateSessionCompleted(FName SessionName, bool bWasSuccessful);
 	void FindSessionCompleted(bool bWasSuccessful);
 	void JoinSessionCompleted(FName SessionName, EOnJoinSessionCompleteResult::Type JoinResult);
 	void StartSessionCompleted(FName SessionName, bool bWasSuccessful);
+	void EndSessionCompleted(FName SessionName, bool bWasSuccessful);
 	void DestroySessionCompleted(FName SessionName, bool bWasSuccessful);
+	void UpdateSessionCompleted(FName SessionName, bool bWasSuccessful);
 	
 	FDelegateHandle CreateSessionCompleteDelegate_Handle,
 					FindSessionsCompleteDelegate_Handle,
 					JoinSessionCompleteDelegate_Handle,
 					StartSessionCompleteDelegate_Handle,
+					EndSessionCompleteDelegate_Handle,
 					DestroySessionCompleteDelegate_Handle,
-					DestroySessionCompleteDelegateLambda_Handle;
+					UpdateSessionCompleteDelegate_Handle;
 
 	FOnCreateSessionCompleteDelegate OnCreateSessionCompleteDelegate;
 	FOnFindSessionsCompleteDelegate OnFindSessionsCompleteDelegate;
 	FOnJoinSessionCompleteDelegate OnJoinSessionCompleteDelegate;
 	FOnStartSessionCompleteDelegate OnStartSessionCompleteDelegate;
-	FOnDestroySessionCompleteDelegate OnDestroySessionCompleteDelegate,
-									  OnDestroySessionCompleteLambdaDelegate;
+	FOnEndSessionCompleteDelegate OnEndSessionCompleteDelegate;
+	FOnDestroySessionCompleteDelegate OnDestroySessionCompleteDelegate;
+	FOnUpdateSessionCompleteDelegate OnUpdateSessionCompleteDelegate;
 	
-	TSharedPtr<FOnlineSessionSettings> SessionSettings;
+	ECustomSessionState State = ECustomSessionState::Idle;
+
+	/** A handful of sessions at most, a sorted array is smaller and faster than a hash map here */
+	TSortedMap<FName, FCustomSessionNamedState, FDefaultAllocator, FNameFastLess> NamedSessions;
+
+	TMap<ECustomSessionOperation, FCustomSessionOperationRecorder> OperationRecorders;
+	TArray<FCustomSessionPendingOperation> PendingOperations;
+	bool bProcessingOperations = false;
+
+	TArray<TCustomSessionWaiter<bool>> OperationWaiters;
+	TArray<TCustomSessionWaiter<FCustomSessionFindResult>> SearchWaiters;
+	TArray<TCustomSessionWaiter<FCustomSessionJoinResult>> JoinWaiters;
+
+	/** Last id handed to a join future */
+	uint32 LastJoinRequestId = 0;
+
+	TArray<FUniqueNetIdRef> PendingRegisterPlayers;
+	TArray<FUniqueNetIdRef> PendingUnregisterPlayers;
+	FTimerHandle PlayerRegistrationTimerHandle;
+
+	/** Created by PrewarmHostSession and not hosted yet, NAME_None when there is none */
+	FName WarmSessionName = NAME_None;
+	bool bCreatingWarmSession = false;
+
+	/**
+	 * Kept referenced until that map is loaded, so the travel finds it in memory. A transition map being loaded
+	 * keeps them, any other map releases them all
+	 */
+	UPROPERTY(Transient)
+	TMap<FName, UPackage*> PreloadedMaps;
+
+	TSet<FName> PreloadingMaps;
+
+	FDelegateHandle PostLoadMapDelegateHandle;
+
+	FTimerHandle SettingsUpdateTimerHandle;
+
+	/** Valid while a search runs, the backend keeps writing into it until it completes */
 	TSharedPtr<FOnlineSessionSearch> SessionSearch;
+	FTimerHandle FindSessionsTimerHandle;
+
+	/** Name the last FindSession was given, what its results are joined under */
+	FName SearchSessionName = NAME_GameSession;
+
+	/** Filters of the running search, RequestSearchFilters plus the region filter of SearchScope */
+	TArray<FCustomSessionSearchFilter> ActiveSearchFilters;
+	TArray<FCustomSessionSearchFilter> RequestSearchFilters;
+	int32 RequestMaxSearchResults = 0;
+	ECustomSessionSearchScope SearchScope = ECustomSessionSearchScope::Global;
+
+	/** What the narrower scope found, returned if widening the search fails */
+	TArray<FOnlineSessionSearchResult> NarrowerScopeResults;
+
+	TMap<FString, FCustomSessionSearchSnapshotRef> SearchCache;
+	FString InFlightSearchKey;
+	bool bInFlightSearchIsBackground = false;
+	int32 ReportedSearchResults = 0;
+	FTSTicker::FDelegateHandle SearchProgressTickerHandle;
+
+	FCustomSessionSearchSnapshotPtr LastSnapshot;
+	uint64 SearchGeneration = 0;
+
+	FCustomSessionSearchSnapshotPtr JoinCandidatesSnapshot;
+	TArray<FCustomSessionRankedResult> JoinCandidates;
+	int32 NextJoinCandidate = 0;
+
+	/** Session the running join completes into, None when not joining */
+	FName JoinSessionName = NAME_None;
+	double JoinDeadline = 0.0;
+	FTimerHandle JoinAttemptTimerHandle;
+
+	TMap<FName, FCustomSessionAbandonedJoin> AbandonedJoins;
+
+	/** Why the running join attempt failed, set when it timed out or was cancelled */
+	ECustomSessionResult JoinFailureReason = ECustomSessionResult::Failed;
+
+	/** Bumped by every join, completions of an older one arriving late are dropped */
+	uint32 JoinSerial = 0;
+
+	/** Join future the running join resolves, 0 if it was not started through one */
+	uint32 JoinRequestId = 0;
+
+	/** Bumped by every join completion, tells a JoinSession call whether the backend completed within it */
+	uint32 JoinCompletionCount = 0;
+
+	TSharedPtr<FCustomSessionLatencyProbe> LatencyProbe;
+	TSharedPtr<FCustomSessionProbeResponder> ProbeResponder;
+
+	TSharedPtr<FCustomSessionReservationClient> ReservationClient;
+	FCustomSessionReserveSlots ReserveSlotsHandler;
+	FCustomSessionReleaseSlots ReleaseSlotsHandler;
+
+	/** New for every join, every candidate is asked with the same one */
+	FGuid JoinReservationToken;
+	int32 JoinRequiredConnections = 1;
+
+	/** Host holding slots for the running join, unset if none did */
+	TOptional<FIPv4Endpoint> ReservedHost;
+
+	/** Session the last join reserved slots for, its connect string carries the token */
+	FName ReservedSessionName = NAME_None;
+
+	bool bQuickMatchInProgress = false;
+
+	/** Until the quick match joins off its search or gives up on it, it only listens to its own requests */
+	bool bQuickMatchSearching = false;
+	uint32 QuickMatchSerial = 0;
+	FString QuickMatchSearchKey;
+	FString QuickMatchType;
+	FCustomSessionQuickMatchOptions QuickMatchOptions;
+	FTimerHandle QuickMatchTimerHandle;
+	FTSTicker::FDelegateHandle QuickMatchTickerHandle;
 };
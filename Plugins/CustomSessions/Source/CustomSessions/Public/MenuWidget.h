@@ -4,10 +4,12 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
+#include "CustomSessionSearchSnapshot.h"
 #include "Interfaces/OnlineSessionInterface.h"
 #include "MenuWidget.generated.h"
 
 class UButton;
+class UCustomSessionBrowserWidget;
 class UEditableTextBox;
 class USpinBox;
 
@@ -39,10 +41,12 @@ protected:
 	UFUNCTION(BlueprintNativeEvent, Category = "Custom Sessions", meta = (AllowPrivateAccess = true, Tooltip = "When a host is created, the BP code should contain a client travel to the address")) 
 	void OnHostJoined(bool bWasSuccessful, const FString& Address);
 
-	virtual void OnFindSessionCompleted(const TArray<FOnlineSessionSearchResult>& SessionResults, bool bWasSuccessful);
+	virtual void OnFindSessionCompleted(const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful);
 
 	virtual void OnJoinSessionCompleted(EOnJoinSessionCompleteResult::Type SessionResult);
 
+	virtual void OnBrowserSessionChosen(const FOnlineSessionSearchResult& SearchResult);
+
 	virtual bool Initialize() override;
 
 	virtual void NativeDestruct() override
@@ -55,6 +59,7 @@ public:
 	UPROPERTY(EditAnywhere, Category = "Search sessions")
 	int32 MaxSearchResults = 32;
 
+	/** Long package name of the map hosts travel to, preloaded while the session is created */
 	UPROPERTY(EditAnywhere, Category = "Sessions")
 	FString LobbyMap{TEXT("")};
 
@@ -71,6 +76,10 @@ protected:
 	UPROPERTY(meta = (BindWidget))
 	USpinBox* SpinBox_NumConnections = nullptr;
 
+	/** Optional list of sessions to pick from, next to the Join button that picks the best one */
+	UPROPERTY(meta = (BindWidgetOptional))
+	UCustomSessionBrowserWidget* SessionBrowser = nullptr;
+
 	UPROPERTY(Transient)
 	class UCustomSessionSubsystem* CustomSessionSubsystem = nullptr;
 };
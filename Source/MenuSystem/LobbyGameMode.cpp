@@ -1,3 +1,184 @@
 // Custom Sessions plugin by juaxix - 2022-2023 - MIT License
 
 #include "LobbyGameMode.h"
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionSubsystem.h"
+#include "TimerManager.h"
+#include "Engine/GameInstance.h"
+#include "GameFramework/PlayerController.h"
+
+ALobbyGameMode::ALobbyGameMode()
+{
+	// players travel into the match with their connections and player states
+	bUseSeamlessTravel = true;
+}
+
+void ALobbyGameMode::BeginPlay()
+{
+	Super::BeginPlay();
+
+	// on the next tick, preloads still held when this map finishes loading are let go
+	GetWorldTimerManager().SetTimerForNextTick(this, &ThisClass::PreloadMatchMap);
+}
+
+void ALobbyGameMode::PostLogin(APlayerController* NewPlayer)
+{
+	Super::PostLogin(NewPlayer);
+
+	UpdateMatchStart();
+}
+
+void ALobbyGameMode::Logout(AController* Exiting)
+{
+	Super::Logout(Exiting);
+
+	// the leaving player is still counted until its controller goes away
+	GetWorldTimerManager().SetTimerForNextTick(this, &ThisClass::UpdateMatchStart);
+}
+
+void ALobbyGameMode::StartMatchCountdown()
+{
+	if (IsCountingDown() || bTravellingToMatch)
+	{
+		return;
+	}
+
+	bCountdownForced = GetNumPlayers() < MinPlayersToStart;
+	MatchStartTime = FPlatformTime::Seconds() + MatchStartCountdown;
+	LastAnnouncedSeconds = INDEX_NONE;
+	GetWorldTimerManager().SetTimer(MatchCountdownTimerHandle, this, &ThisClass::MatchCountdownTick, 1.0f, true, 0.0f);
+
+	// in case the lobby went unnoticed until now
+	PreloadMatchMap();
+
+	CUSTOMSESSION_EVENT(Session, Log, "MatchCountdownStarted", {TEXT("Players"), GetNumPlayers()},
+		{TEXT("Seconds"), MatchStartCountdown}, {TEXT("Forced"), bCountdownForced});
+}
+
+void ALobbyGameMode::CancelMatchCountdown()
+{
+	if (!IsCountingDown() || bTravellingToMatch)
+	{
+		return;
+	}
+
+	GetWorldTimerManager().ClearTimer(MatchCountdownTimerHandle);
+	bCountdownForced = false;
+
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		if (APlayerController* PlayerController = Iterator->Get())
+		{
+			PlayerController->ClientMessage(TEXT("Waiting for players"));
+		}
+	}
+
+	CUSTOMSESSION_EVENT(Session, Log, "MatchCountdownCancelled", {TEXT("Players"), GetNumPlayers()});
+}
+
+float ALobbyGameMode::GetMatchCountdownRemaining() const
+{
+	return IsCountingDown() ? static_cast<float>(FMath::Max(MatchStartTime - FPlatformTime::Seconds(), 0.0)) : 0.0f;
+}
+
+void ALobbyGameMode::PreloadMatchMap()
+{
+	UCustomSessionSubsystem* CustomSessionSubsystem = GetCustomSessionSubsystem();
+	if (IsValid(CustomSessionSubsystem) && !MatchMap.IsEmpty())
+	{
+		CustomSessionSubsystem->PreloadMap(MatchMap);
+	}
+}
+
+void ALobbyGameMode::UpdateMatchStart()
+{
+	if (bTravellingToMatch)
+	{
+		return;
+	}
+
+	const int32 NumPlayers = GetNumPlayers();
+	if (!IsCountingDown())
+	{
+		if (NumPlayers >= MinPlayersToStart)
+		{
+			StartMatchCountdown();
+		}
+
+		return;
+	}
+
+	if (NumPlayers < MinPlayersToStart && !bCountdownForced)
+	{
+		CancelMatchCountdown();
+
+		return;
+	}
+
+	if (NumPlayers >= GetPlayerCapacity())
+	{
+		MatchStartTime = FMath::Min(MatchStartTime, FPlatformTime::Seconds() + FullLobbyCountdown);
+	}
+}
+
+void ALobbyGameMode::MatchCountdownTick()
+{
+	const double Remaining = MatchStartTime - FPlatformTime::Seconds();
+	if (Remaining <= 0.0)
+	{
+		TravelToMatch();
+
+		return;
+	}
+
+	// the start and the last seconds only, every second would flood the chat
+	const int32 Seconds = FMath::CeilToInt32(Remaining);
+	if (Seconds == LastAnnouncedSeconds || (LastAnnouncedSeconds != INDEX_NONE && Seconds > 5))
+	{
+		return;
+	}
+
+	LastAnnouncedSeconds = Seconds;
+	const FString Message = FString::Printf(TEXT("Match starts in %d"), Seconds);
+	for (FConstPlayerControllerIterator Iterator = GetWorld()->GetPlayerControllerIterator(); Iterator; ++Iterator)
+	{
+		if (APlayerController* PlayerController = Iterator->Get())
+		{
+			PlayerController->ClientMessage(Message);
+		}
+	}
+}
+
+void ALobbyGameMode::TravelToMatch()
+{
+	UWorld* World = GetWorld();
+	if (MatchMap.IsEmpty() || !IsValid(World))
+	{
+		UE_LOG(LogGameMode, Warning, TEXT("No MatchMap to travel to from the lobby"));
+		CancelMatchCountdown();
+
+		return;
+	}
+
+	// a countdown nearly always covers the load, a slow disk gets a little longer instead of a hitch
+	const UCustomSessionSubsystem* CustomSessionSubsystem = GetCustomSessionSubsystem();
+	const bool bPreloaded = IsValid(CustomSessionSubsystem) && CustomSessionSubsystem->IsMapPreloaded(MatchMap);
+	const double PreloadWait = FPlatformTime::Seconds() - MatchStartTime;
+	if (!bPreloaded && PreloadWait < MaxPreloadWait)
+	{
+		return;
+	}
+
+	bTravellingToMatch = true;
+	GetWorldTimerManager().ClearTimer(MatchCountdownTimerHandle);
+
+	CUSTOMSESSION_EVENT(Session, Log, "MatchTravel", {TEXT("Map"), MatchMap}, {TEXT("Players"), GetNumPlayers()},
+		{TEXT("Preloaded"), bPreloaded}, {TEXT("PreloadWaitMs"), FMath::Max(PreloadWait, 0.0) * 1000.0});
+
+	World->ServerTravel(MatchMap + MatchTravelOptions);
+}
+
+UCustomSessionSubsystem* ALobbyGameMode::GetCustomSessionSubsystem() const
+{
+	return GetGameInstance() ? GetGameInstance()->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+}
@@ -6,10 +6,74 @@
 #include "MenuSystemGameModeBase.h"
 #include "LobbyGameMode.generated.h"
 
+class UCustomSessionSubsystem;
 
+/**
+ * Counts down to the match once enough players are in, preloading the match map while they wait, then travels
+ * there seamlessly so everyone keeps their connection. Leaving TransitionMap empty in the game maps settings
+ * makes the engine travel through a blank world, the lightest transition there is
+ */
 UCLASS()
 class MENUSYSTEM_API ALobbyGameMode : public AMenuSystemGameModeBase
 {
 	GENERATED_BODY()
 
+public:
+	ALobbyGameMode();
+
+	virtual void BeginPlay() override;
+	virtual void PostLogin(APlayerController* NewPlayer) override;
+	virtual void Logout(AController* Exiting) override;
+
+	/** Starts the countdown even below MinPlayersToStart, e.g. when the host chooses to start */
+	UFUNCTION(BlueprintCallable, Category = "Lobby")
+	void StartMatchCountdown();
+
+	UFUNCTION(BlueprintCallable, Category = "Lobby")
+	void CancelMatchCountdown();
+
+	UFUNCTION(BlueprintPure, Category = "Lobby")
+	bool IsCountingDown() const { return MatchCountdownTimerHandle.IsValid(); }
+
+	/** @return seconds until the travel to the match, 0 when not counting down */
+	UFUNCTION(BlueprintPure, Category = "Lobby")
+	float GetMatchCountdownRemaining() const;
+
+protected:
+	/** Long package name of the map the match is played on */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	FString MatchMap;
+
+	/** Appended to MatchMap when travelling */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	FString MatchTravelOptions = TEXT("?listen");
+
+	/** Players in the lobby, the host included, that start the countdown */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	int32 MinPlayersToStart = 2;
+
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	float MatchStartCountdown = 10.0f;
+
+	/** Countdown left once the lobby is full, nobody else can join so there is no point waiting longer */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	float FullLobbyCountdown = 3.0f;
+
+	/** Seconds the travel is held back past the countdown for the match map to finish preloading */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Lobby")
+	float MaxPreloadWait = 5.0f;
+
+private:
+	void PreloadMatchMap();
+	void UpdateMatchStart();
+	void MatchCountdownTick();
+	void TravelToMatch();
+
+	UCustomSessionSubsystem* GetCustomSessionSubsystem() const;
+
+	FTimerHandle MatchCountdownTimerHandle;
+	double MatchStartTime = 0.0;
+	int32 LastAnnouncedSeconds = INDEX_NONE;
+	bool bCountdownForced = false;
+	bool bTravellingToMatch = false;
 };
@@ -12,7 +12,7 @@ public class MenuSystem : ModuleRules
 			"OnlineSubsystem", "OnlineSubsystemSteam"
 		});
 
-		PrivateDependencyModuleNames.AddRange(new string[] { "CustomSessions" });
+		PrivateDependencyModuleNames.AddRange(new string[] { "CustomSessions", "Json" });
 
 		// Uncomment if you are using Slate UI
 		// PrivateDependencyModuleNames.AddRange(new string[] { "Slate", "SlateCore" });
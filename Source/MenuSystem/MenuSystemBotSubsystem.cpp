@@ -0,0 +1,426 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "MenuSystemBotSubsystem.h"
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionSubsystem.h"
+#include "MenuSystemCharacter.h"
+#include "OnlineSubsystem.h"
+#include "Dom/JsonObject.h"
+#include "Engine/Engine.h"
+#include "Engine/GameInstance.h"
+#include "Engine/World.h"
+#include "GameFramework/GameModeBase.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+FMenuSystemBotOptions FMenuSystemBotOptions::FromCommandLine(const TCHAR* CommandLine)
+{
+	FMenuSystemBotOptions Options;
+	Options.bIsBot = FParse::Param(CommandLine, TEXT("Bot"));
+	FParse::Value(CommandLine, TEXT("BotServerReport="), Options.ServerReportDir);
+	FParse::Value(CommandLine, TEXT("BotId="), Options.BotId);
+	FParse::Value(CommandLine, TEXT("BotMatchType="), Options.MatchType);
+	FParse::Value(CommandLine, TEXT("BotHost="), Options.HostOverride);
+	FParse::Value(CommandLine, TEXT("BotDuration="), Options.Duration);
+	FParse::Value(CommandLine, TEXT("BotJoinTimeout="), Options.JoinTimeout);
+	FParse::Value(CommandLine, TEXT("BotSearchAttempts="), Options.MaxSearchAttempts);
+	FParse::Value(CommandLine, TEXT("BotReportDir="), Options.ReportDir);
+
+	if (Options.ReportDir.IsEmpty())
+	{
+		Options.ReportDir = FPaths::ProfilingDir() / TEXT("CustomSessions") / TEXT("Bots");
+	}
+
+	return Options;
+}
+
+bool UMenuSystemBotSubsystem::ShouldCreateSubsystem(UObject* Outer) const
+{
+	const FMenuSystemBotOptions CommandLineOptions = FMenuSystemBotOptions::FromCommandLine(FCommandLine::Get());
+
+	return CommandLineOptions.bIsBot || !CommandLineOptions.ServerReportDir.IsEmpty();
+}
+
+void UMenuSystemBotSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	// searches through it, it has to be up first
+	Collection.InitializeDependency<UCustomSessionSubsystem>();
+	Super::Initialize(Collection);
+
+	Options = FMenuSystemBotOptions::FromCommandLine(FCommandLine::Get());
+	StartTime = FPlatformTime::Seconds();
+	ServerSecondStart = StartTime;
+	RandomStream.Initialize(Options.BotId);
+
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &ThisClass::Tick));
+	if (!Options.bIsBot)
+	{
+		return;
+	}
+
+	PostLoadMapDelegateHandle = FCoreUObjectDelegates::PostLoadMapWithWorld.AddUObject(this, &ThisClass::PostLoadMapWithWorld);
+	if (GEngine)
+	{
+		NetworkFailureDelegateHandle = GEngine->OnNetworkFailure().AddUObject(this, &ThisClass::NetworkFailure);
+		TravelFailureDelegateHandle = GEngine->OnTravelFailure().AddUObject(this, &ThisClass::TravelFailure);
+	}
+
+	CUSTOMSESSION_EVENT(Session, Display, "BotStarted", {TEXT("BotId"), Options.BotId}, {TEXT("MatchType"), Options.MatchType});
+}
+
+void UMenuSystemBotSubsystem::Deinitialize()
+{
+	if (TickerHandle.IsValid())
+	{
+		FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+		TickerHandle.Reset();
+	}
+
+	FCoreUObjectDelegates::PostLoadMapWithWorld.Remove(PostLoadMapDelegateHandle);
+	if (GEngine)
+	{
+		GEngine->OnNetworkFailure().Remove(NetworkFailureDelegateHandle);
+		GEngine->OnTravelFailure().Remove(TravelFailureDelegateHandle);
+	}
+
+	// quitting halfway still tells how far the bot got
+	if (Options.bIsBot && Phase != EPhase::Done)
+	{
+		Result = TEXT("Quit");
+		WriteBotReport();
+	}
+
+	if (!Options.ServerReportDir.IsEmpty())
+	{
+		WriteServerReport();
+	}
+
+	Super::Deinitialize();
+}
+
+bool UMenuSystemBotSubsystem::Tick(float DeltaTime)
+{
+	if (Options.bIsBot)
+	{
+		TickBot(DeltaTime);
+	}
+	else
+	{
+		TickServer(DeltaTime);
+	}
+
+	return true;
+}
+
+void UMenuSystemBotSubsystem::TickBot(float DeltaTime)
+{
+	const double Now = FPlatformTime::Seconds();
+	switch (Phase)
+	{
+		case EPhase::WaitingForWorld:
+		{
+			const UGameInstance* GameInstance = GetGameInstance();
+			if (IsValid(GameInstance->GetFirstLocalPlayerController()) && Now >= NextSearchTime)
+			{
+				StartSearch();
+			}
+		}
+		break;
+		case EPhase::Travelling:
+		{
+			// the login queue may hold us without a pawn for a while, that is part of the time to play
+			const APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
+			if (IsValid(PlayerController) && PlayerController->GetNetMode() == NM_Client && IsValid(Cast<AMenuSystemCharacter>(PlayerController->GetPawn())))
+			{
+				PlayingTime = Now;
+				NextJumpTime = Now + RandomStream.FRandRange(1.0f, 4.0f);
+				Phase = EPhase::Playing;
+				CUSTOMSESSION_EVENT(Join, Display, "BotPlaying", {TEXT("BotId"), Options.BotId}, {TEXT("TimeToPlayMs"), ElapsedMs(StartTime, Now)});
+			}
+		}
+		break;
+		case EPhase::Playing:
+		{
+			ClientFrameTimes.Add(DeltaTime * 1000.0);
+			DriveCharacter(DeltaTime);
+			if (Now - PlayingTime >= Options.Duration)
+			{
+				Finish(TEXT("Played"));
+			}
+
+			return;
+		}
+		default:
+		break;
+	}
+
+	if (Phase != EPhase::Done && Phase != EPhase::Playing && Now - StartTime > Options.JoinTimeout)
+	{
+		Finish(TEXT("TimedOut"));
+	}
+}
+
+void UMenuSystemBotSubsystem::TickServer(float DeltaTime)
+{
+	const UWorld* World = GetGameInstance()->GetWorld();
+	const AGameModeBase* GameMode = IsValid(World) ? World->GetAuthGameMode() : nullptr;
+	const int32 NumPlayers = IsValid(GameMode) ? GameMode->GetNumPlayers() : 0;
+	PeakPlayers = FMath::Max(PeakPlayers, NumPlayers);
+
+	const double FrameMs = DeltaTime * 1000.0;
+	ServerFrameTimes.Add(FrameMs);
+	ServerSecondFrameMs += FrameMs;
+	ServerSecondMaxFrameMs = FMath::Max(ServerSecondMaxFrameMs, FrameMs);
+	++ServerSecondFrames;
+
+	const double Now = FPlatformTime::Seconds();
+	if (Now - ServerSecondStart >= 1.0)
+	{
+		ServerTimeline.Add(FString::Printf(TEXT("%.0f,%d,%.3f,%.3f"), Now - StartTime, NumPlayers,
+			ServerSecondFrameMs / ServerSecondFrames, ServerSecondMaxFrameMs));
+		ServerSecondStart = Now;
+		ServerSecondFrameMs = 0.0;
+		ServerSecondMaxFrameMs = 0.0;
+		ServerSecondFrames = 0;
+	}
+
+	const UCustomSessionSubsystem* CustomSessionSubsystem = GetCustomSessionSubsystem();
+	const ECustomSessionState SessionState = IsValid(CustomSessionSubsystem) ? CustomSessionSubsystem->GetNamedSessionState(NAME_GameSession) : ECustomSessionState::Idle;
+	const bool bSessionCreated = SessionState != ECustomSessionState::Idle && SessionState != ECustomSessionState::Creating;
+
+	// the launcher kills servers that outlive the run, so the report can't wait for Deinitialize
+	if (Now >= NextServerReportTime || bSessionCreated != bServerSessionCreated)
+	{
+		NextServerReportTime = Now + 5.0;
+		bServerSessionCreated = bSessionCreated;
+		WriteServerReport();
+	}
+
+	if (Options.Duration > 0.0f && Now - StartTime >= Options.Duration && !IsEngineExitRequested())
+	{
+		FPlatformMisc::RequestExit(false);
+	}
+}
+
+void UMenuSystemBotSubsystem::StartSearch()
+{
+	UCustomSessionSubsystem* CustomSessionSubsystem = GetCustomSessionSubsystem();
+	if (!IsValid(CustomSessionSubsystem))
+	{
+		Finish(TEXT("NoSessionSubsystem"));
+
+		return;
+	}
+
+	Phase = EPhase::Searching;
+	++SearchAttempts;
+	if (SearchStartTime == 0.0)
+	{
+		SearchStartTime = FPlatformTime::Seconds();
+	}
+
+	// searches started by anyone else complete on the public delegate, the bot only joins from its own
+	CustomSessionSubsystem->FindSessionsAsync(TArray<FCustomSessionSearchFilter>(), 100, NAME_GameSession, Options.MatchType)
+		.Next([WeakThis = TWeakObjectPtr<ThisClass>(this)](const FCustomSessionFindResult& FindResult)
+		{
+			if (ThisClass* This = WeakThis.Get())
+			{
+				This->SearchCompleted(FindResult.Snapshot, FindResult.bWasSuccessful);
+			}
+		});
+}
+
+void UMenuSystemBotSubsystem::SearchCompleted(const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful)
+{
+	UCustomSessionSubsystem* CustomSessionSubsystem = GetCustomSessionSubsystem();
+	if (!IsValid(CustomSessionSubsystem) || Phase != EPhase::Searching)
+	{
+		return;
+	}
+
+	NumSearchResults = Snapshot->Num();
+	if (!bWasSuccessful || Snapshot->IsEmpty())
+	{
+		if (SearchAttempts >= Options.MaxSearchAttempts)
+		{
+			Finish(TEXT("NoSessionFound"));
+
+			return;
+		}
+
+		// the server may not be advertising yet
+		NextSearchTime = FPlatformTime::Seconds() + 1.0;
+		Phase = EPhase::WaitingForWorld;
+
+		return;
+	}
+
+	SearchEndTime = FPlatformTime::Seconds();
+	Phase = EPhase::Joining;
+	CustomSessionSubsystem->JoinBestSessionAsync(Snapshot, 1, NAME_GameSession)
+		.Next([WeakThis = TWeakObjectPtr<ThisClass>(this)](const FCustomSessionJoinResult& JoinResult)
+		{
+			if (ThisClass* This = WeakThis.Get())
+			{
+				This->JoinCompleted(JoinResult.JoinResult);
+			}
+		});
+}
+
+void UMenuSystemBotSubsystem::JoinCompleted(EOnJoinSessionCompleteResult::Type JoinResult)
+{
+	UCustomSessionSubsystem* CustomSessionSubsystem = GetCustomSessionSubsystem();
+	if (!IsValid(CustomSessionSubsystem) || Phase != EPhase::Joining)
+	{
+		return;
+	}
+
+	if (JoinResult != EOnJoinSessionCompleteResult::Success)
+	{
+		Finish(FString::Printf(TEXT("JoinFailed:%s"), LexToString(JoinResult)));
+
+		return;
+	}
+
+	FString Address = Options.HostOverride;
+	if (Address.IsEmpty() && !CustomSessionSubsystem->ResolveConnectString(Address))
+	{
+		Finish(TEXT("NoConnectString"));
+
+		return;
+	}
+
+	APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
+	if (!IsValid(PlayerController))
+	{
+		Finish(TEXT("NoPlayerController"));
+
+		return;
+	}
+
+	JoinEndTime = FPlatformTime::Seconds();
+	Phase = EPhase::Travelling;
+	PlayerController->ClientTravel(Address, TRAVEL_Absolute);
+}
+
+void UMenuSystemBotSubsystem::DriveCharacter(float DeltaTime)
+{
+	const APlayerController* PlayerController = GetGameInstance()->GetFirstLocalPlayerController();
+	AMenuSystemCharacter* Character = IsValid(PlayerController) ? Cast<AMenuSystemCharacter>(PlayerController->GetPawn()) : nullptr;
+	if (!IsValid(Character))
+	{
+		return;
+	}
+
+	// wide circles that differ per bot, so they spread over the map instead of piling up on the spawn
+	const double Now = FPlatformTime::Seconds();
+	const float Yaw = Options.BotId * 37.0f + static_cast<float>(Now - PlayingTime) * 30.0f;
+	Character->AddMovementInput(FRotator(0.0f, Yaw, 0.0f).Vector(), 1.0f);
+	if (Now >= NextJumpTime)
+	{
+		NextJumpTime = Now + RandomStream.FRandRange(1.0f, 4.0f);
+		Character->Jump();
+	}
+	else
+	{
+		Character->StopJumping();
+	}
+}
+
+void UMenuSystemBotSubsystem::PostLoadMapWithWorld(UWorld* LoadedWorld)
+{
+	if (Phase == EPhase::Travelling && IsValid(LoadedWorld) && LoadedWorld->GetNetMode() == NM_Client)
+	{
+		MapLoadedTime = FPlatformTime::Seconds();
+	}
+}
+
+void UMenuSystemBotSubsystem::NetworkFailure(UWorld* World, UNetDriver* NetDriver, ENetworkFailure::Type FailureType, const FString& ErrorString)
+{
+	if (Phase == EPhase::Travelling || Phase == EPhase::Playing)
+	{
+		Finish(FString::Printf(TEXT("NetworkFailure:%s:%s"), ENetworkFailure::ToString(FailureType), *ErrorString));
+	}
+}
+
+void UMenuSystemBotSubsystem::TravelFailure(UWorld* World, ETravelFailure::Type FailureType, const FString& ErrorString)
+{
+	if (Phase == EPhase::Travelling)
+	{
+		Finish(FString::Printf(TEXT("TravelFailure:%s:%s"), ETravelFailure::ToString(FailureType), *ErrorString));
+	}
+}
+
+void UMenuSystemBotSubsystem::Finish(const FString& InResult)
+{
+	if (Phase == EPhase::Done)
+	{
+		return;
+	}
+
+	Phase = EPhase::Done;
+	Result = InResult;
+	WriteBotReport();
+	CUSTOMSESSION_EVENT(Session, Display, "BotFinished", {TEXT("BotId"), Options.BotId}, {TEXT("Result"), Result});
+
+	FPlatformMisc::RequestExit(false);
+}
+
+void UMenuSystemBotSubsystem::WriteBotReport() const
+{
+	const TSharedRef<FJsonObject> JsonReport = MakeShared<FJsonObject>();
+	JsonReport->SetNumberField(TEXT("botId"), Options.BotId);
+	JsonReport->SetStringField(TEXT("result"), Result);
+	JsonReport->SetBoolField(TEXT("played"), PlayingTime > 0.0);
+	JsonReport->SetStringField(TEXT("backend"), IOnlineSubsystem::Get() ? IOnlineSubsystem::Get()->GetSubsystemName().ToString() : FString());
+	JsonReport->SetNumberField(TEXT("searchAttempts"), SearchAttempts);
+	JsonReport->SetNumberField(TEXT("searchResults"), NumSearchResults);
+	JsonReport->SetNumberField(TEXT("searchMs"), ElapsedMs(SearchStartTime, SearchEndTime));
+	JsonReport->SetNumberField(TEXT("joinMs"), ElapsedMs(SearchEndTime, JoinEndTime));
+	JsonReport->SetNumberField(TEXT("mapLoadMs"), ElapsedMs(JoinEndTime, MapLoadedTime));
+	JsonReport->SetNumberField(TEXT("timeToPawnMs"), ElapsedMs(JoinEndTime, PlayingTime));
+	JsonReport->SetNumberField(TEXT("timeToPlayMs"), ElapsedMs(StartTime, PlayingTime));
+	JsonReport->SetNumberField(TEXT("clientFrameP50Ms"), ClientFrameTimes.GetPercentile(0.5));
+	JsonReport->SetNumberField(TEXT("clientFrameP99Ms"), ClientFrameTimes.GetPercentile(0.99));
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(JsonReport, JsonWriter);
+
+	const FString Path = Options.ReportDir / FString::Printf(TEXT("Bot-%d.json"), Options.BotId);
+	FFileHelper::SaveStringToFile(Json, *Path);
+}
+
+void UMenuSystemBotSubsystem::WriteServerReport() const
+{
+	const TSharedRef<FJsonObject> JsonReport = MakeShared<FJsonObject>();
+	JsonReport->SetNumberField(TEXT("seconds"), FPlatformTime::Seconds() - StartTime);
+	JsonReport->SetBoolField(TEXT("sessionCreated"), bServerSessionCreated);
+	JsonReport->SetNumberField(TEXT("peakPlayers"), PeakPlayers);
+	JsonReport->SetNumberField(TEXT("frames"), ServerFrameTimes.GetCount());
+	JsonReport->SetNumberField(TEXT("frameMeanMs"), ServerFrameTimes.GetMean());
+	JsonReport->SetNumberField(TEXT("frameP50Ms"), ServerFrameTimes.GetPercentile(0.5));
+	JsonReport->SetNumberField(TEXT("frameP95Ms"), ServerFrameTimes.GetPercentile(0.95));
+	JsonReport->SetNumberField(TEXT("frameP99Ms"), ServerFrameTimes.GetPercentile(0.99));
+	JsonReport->SetNumberField(TEXT("frameMaxMs"), ServerFrameTimes.GetMax());
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(JsonReport, JsonWriter);
+
+	FFileHelper::SaveStringToFile(Json, *(Options.ServerReportDir / TEXT("Server.json")));
+	FFileHelper::SaveStringToFile(TEXT("Seconds,Players,FrameMeanMs,FrameMaxMs\n") + FString::Join(ServerTimeline, TEXT("\n")),
+		*(Options.ServerReportDir / TEXT("Server.csv")));
+}
+
+UCustomSessionSubsystem* UMenuSystemBotSubsystem::GetCustomSessionSubsystem() const
+{
+	return GetGameInstance() ? GetGameInstance()->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+}
+
+double UMenuSystemBotSubsystem::ElapsedMs(double From, double To)
+{
+	return From > 0.0 && To >= From ? (To - From) * 1000.0 : 0.0;
+}
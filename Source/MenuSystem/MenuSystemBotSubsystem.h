@@ -0,0 +1,128 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "CustomSessionSearchSnapshot.h"
+#include "CustomSessionStats.h"
+#include "Containers/Ticker.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Interfaces/OnlineSessionInterface.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "MenuSystemBotSubsystem.generated.h"
+
+class UCustomSessionSubsystem;
+class UNetDriver;
+
+/** Read from the command line of a bot client or of the server it plays on, see UMenuSystemBotsCommandlet */
+struct FMenuSystemBotOptions
+{
+	/** -Bot, this process is a simulated player */
+	bool bIsBot = false;
+
+	/** -BotServerReport=<Dir>, this process is the server and reports its frame times there */
+	FString ServerReportDir;
+
+	int32 BotId = 0;
+	FString MatchType = TEXT("FreeForAll");
+
+	/** Address travelled to instead of the joined session's, the mock backend only knows made up hosts */
+	FString HostOverride;
+
+	/** Seconds each bot moves around once in the lobby, and seconds the server runs for when reporting */
+	float Duration = 60.0f;
+
+	/** Seconds a bot may take from its first search until it controls a character */
+	float JoinTimeout = 60.0f;
+
+	/** Searches tried before giving up, the server may not be advertising yet when bots start */
+	int32 MaxSearchAttempts = 10;
+
+	FString ReportDir;
+
+	static FMenuSystemBotOptions FromCommandLine(const TCHAR* CommandLine);
+};
+
+/**
+ * Turns a -nullrhi client into a simulated player: it finds, ranks and joins a session through
+ * UCustomSessionSubsystem, travels to the host and runs around the lobby with its AMenuSystemCharacter,
+ * then writes how long each step took and quits. On the server, -BotServerReport records frame times
+ * against the number of players. Only created with either switch on the command line
+ */
+UCLASS()
+class MENUSYSTEM_API UMenuSystemBotSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool ShouldCreateSubsystem(UObject* Outer) const override;
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+private:
+	enum class EPhase : uint8
+	{
+		WaitingForWorld,
+		Searching,
+		Joining,
+		Travelling,
+		Playing,
+		Done
+	};
+
+	bool Tick(float DeltaTime);
+	void TickBot(float DeltaTime);
+	void TickServer(float DeltaTime);
+
+	void StartSearch();
+	void SearchCompleted(const FCustomSessionSearchSnapshotRef& Snapshot, bool bWasSuccessful);
+	void JoinCompleted(EOnJoinSessionCompleteResult::Type JoinResult);
+	void DriveCharacter(float DeltaTime);
+
+	void PostLoadMapWithWorld(UWorld* LoadedWorld);
+	void NetworkFailure(UWorld* World, UNetDriver* NetDriver, ENetworkFailure::Type FailureType, const FString& ErrorString);
+	void TravelFailure(UWorld* World, ETravelFailure::Type FailureType, const FString& ErrorString);
+
+	void Finish(const FString& InResult);
+	void WriteBotReport() const;
+	void WriteServerReport() const;
+
+	UCustomSessionSubsystem* GetCustomSessionSubsystem() const;
+
+	static double ElapsedMs(double From, double To);
+
+	FMenuSystemBotOptions Options;
+	FTSTicker::FDelegateHandle TickerHandle;
+	FDelegateHandle PostLoadMapDelegateHandle;
+	FDelegateHandle NetworkFailureDelegateHandle;
+	FDelegateHandle TravelFailureDelegateHandle;
+
+	EPhase Phase = EPhase::WaitingForWorld;
+	FString Result;
+	int32 SearchAttempts = 0;
+	int32 NumSearchResults = 0;
+	double NextSearchTime = 0.0;
+
+	double StartTime = 0.0;
+	double SearchStartTime = 0.0;
+	double SearchEndTime = 0.0;
+	double JoinEndTime = 0.0;
+	double MapLoadedTime = 0.0;
+	double PlayingTime = 0.0;
+	double NextJumpTime = 0.0;
+	FRandomStream RandomStream;
+	FCustomSessionLatencyHistogram ClientFrameTimes;
+
+	/** Per second rows of elapsed seconds, players, mean and max frame ms, on the server */
+	TArray<FString> ServerTimeline;
+	FCustomSessionLatencyHistogram ServerFrameTimes;
+	double ServerSecondStart = 0.0;
+	double ServerSecondFrameMs = 0.0;
+	double ServerSecondMaxFrameMs = 0.0;
+	int32 ServerSecondFrames = 0;
+	int32 PeakPlayers = 0;
+	double NextServerReportTime = 0.0;
+
+	/** Whether the hosted session exists, reported as soon as it changes, the launcher checks it after warming up */
+	bool bServerSessionCreated = false;
+};
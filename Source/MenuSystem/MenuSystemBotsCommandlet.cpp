@@ -0,0 +1,230 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#include "MenuSystemBotsCommandlet.h"
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionStats.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/JsonSerializer.h"
+
+namespace MenuSystemBots
+{
+	FProcHandle Launch(const FString& Arguments)
+	{
+		return FPlatformProcess::CreateProc(FPlatformProcess::ExecutablePath(), *Arguments, true, true, true, nullptr, 0, nullptr, nullptr);
+	}
+
+	TSharedPtr<FJsonObject> ReadReport(const FString& Path)
+	{
+		FString Json;
+		TSharedPtr<FJsonObject> Report;
+		if (FFileHelper::LoadFileToString(Json, *Path))
+		{
+			FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(Json), Report);
+		}
+
+		return Report;
+	}
+}
+
+UMenuSystemBotsCommandlet::UMenuSystemBotsCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = false;
+	LogToConsole = true;
+}
+
+int32 UMenuSystemBotsCommandlet::Main(const FString& Params)
+{
+	int32 NumBots = 10;
+	FString Map = TEXT("/Game/ThirdPerson/Maps/ThirdPersonMap");
+	FString Backend = TEXT("Null");
+	FString MatchType = TEXT("FreeForAll");
+	float Duration = 60.0f;
+	float SpawnInterval = 0.25f;
+	float ServerWarmup = 10.0f;
+	float JoinTimeout = 60.0f;
+	int32 Port = 7777;
+	FParse::Value(*Params, TEXT("Bots="), NumBots);
+	FParse::Value(*Params, TEXT("Map="), Map);
+	FParse::Value(*Params, TEXT("Backend="), Backend);
+	FParse::Value(*Params, TEXT("MatchType="), MatchType);
+	FParse::Value(*Params, TEXT("Duration="), Duration);
+	FParse::Value(*Params, TEXT("SpawnInterval="), SpawnInterval);
+	FParse::Value(*Params, TEXT("ServerWarmup="), ServerWarmup);
+	FParse::Value(*Params, TEXT("JoinTimeout="), JoinTimeout);
+	FParse::Value(*Params, TEXT("Port="), Port);
+	const bool bLaunchServer = !FParse::Param(*Params, TEXT("NoServer"));
+
+	const FString ReportDir = FPaths::ConvertRelativePathToFull(FPaths::ProfilingDir() / TEXT("CustomSessions")
+		/ FString::Printf(TEXT("Bots-%s"), *FDateTime::Now().ToString()));
+	IFileManager::Get().MakeDirectory(*ReportDir, true);
+
+	// no Steam on a build box, the Null subsystem finds sessions over LAN and the mock answers in process
+	FString CommonArgs = FString::Printf(TEXT("\"%s\" -nullrhi -nosound -nosplash -unattended -nosteam -ini:Engine:[OnlineSubsystem]:DefaultPlatformService=Null"),
+		*FPaths::ConvertRelativePathToFull(FPaths::GetProjectFilePath()));
+	FString BotArgs;
+	if (Backend.Equals(TEXT("Mock"), ESearchCase::IgnoreCase))
+	{
+		// mock sessions advertise made up hosts, every bot travels to the local server instead
+		BotArgs = FString::Printf(TEXT(" -CustomSessionsMock -BotHost=127.0.0.1:%d"), Port);
+	}
+
+	// it outlives the slowest bot, then quits and writes its report on its own
+	const float RunTime = ServerWarmup + NumBots * SpawnInterval + JoinTimeout + Duration;
+	FProcHandle ServerProcess;
+	if (bLaunchServer)
+	{
+		ServerProcess = MenuSystemBots::Launch(FString::Printf(TEXT("%s %s?MatchType=%s -server -port=%d -BotServerReport=\"%s\" -BotDuration=%.0f -abslog=\"%s\""),
+			*CommonArgs, *Map, *MatchType, Port, *ReportDir, RunTime + 10.0f, *(ReportDir / TEXT("Server.log"))));
+		if (!ServerProcess.IsValid())
+		{
+			UE_LOG(LogCustomSessions, Error, TEXT("Could not start the server"));
+
+			return 1;
+		}
+
+		FPlatformProcess::Sleep(ServerWarmup);
+
+		// bots can't join a server that is not hosting, better to say so now than after every one of them timed out
+		const TSharedPtr<FJsonObject> ServerReport = MenuSystemBots::ReadReport(ReportDir / TEXT("Server.json"));
+		if (!ServerReport.IsValid() || !ServerReport->GetBoolField(TEXT("sessionCreated")))
+		{
+			UE_LOG(LogCustomSessions, Error, TEXT("The server created no session within %.0fs, see %s"), ServerWarmup, *(ReportDir / TEXT("Server.log")));
+			FPlatformProcess::TerminateProc(ServerProcess, true);
+			FPlatformProcess::CloseProc(ServerProcess);
+
+			return 1;
+		}
+	}
+
+	TArray<FProcHandle> BotProcesses;
+	for (int32 BotId = 0; BotId < NumBots; ++BotId)
+	{
+		FProcHandle BotProcess = MenuSystemBots::Launch(FString::Printf(TEXT("%s -game -Bot -BotId=%d -BotMatchType=%s -BotDuration=%.1f -BotJoinTimeout=%.1f -BotReportDir=\"%s\" -abslog=\"%s\"%s"),
+			*CommonArgs, BotId, *MatchType, Duration, JoinTimeout, *ReportDir, *(ReportDir / FString::Printf(TEXT("Bot-%d.log"), BotId)), *BotArgs));
+		if (!BotProcess.IsValid())
+		{
+			UE_LOG(LogCustomSessions, Warning, TEXT("Could not start bot %d"), BotId);
+
+			continue;
+		}
+
+		BotProcesses.Add(BotProcess);
+		FPlatformProcess::Sleep(SpawnInterval);
+	}
+
+	UE_LOG(LogCustomSessions, Display, TEXT("Started %d bots, reports go to %s"), BotProcesses.Num(), *ReportDir);
+
+	// bots quit by themselves once they played or failed, the deadline only catches the stuck ones
+	const double Deadline = FPlatformTime::Seconds() + JoinTimeout + Duration + 30.0;
+	while (FPlatformTime::Seconds() < Deadline && BotProcesses.ContainsByPredicate([](FProcHandle& Process) { return FPlatformProcess::IsProcRunning(Process); }))
+	{
+		FPlatformProcess::Sleep(1.0f);
+	}
+
+	for (FProcHandle& BotProcess : BotProcesses)
+	{
+		if (FPlatformProcess::IsProcRunning(BotProcess))
+		{
+			FPlatformProcess::TerminateProc(BotProcess, true);
+		}
+
+		FPlatformProcess::CloseProc(BotProcess);
+	}
+
+	if (ServerProcess.IsValid())
+	{
+		FPlatformProcess::TerminateProc(ServerProcess, true);
+		FPlatformProcess::CloseProc(ServerProcess);
+	}
+
+	const int32 NumPlayed = WriteSummary(ReportDir, NumBots);
+
+	return NumPlayed == NumBots ? 0 : 1;
+}
+
+int32 UMenuSystemBotsCommandlet::WriteSummary(const FString& ReportDir, int32 NumBots)
+{
+	static const TCHAR* MetricNames[] = { TEXT("searchMs"), TEXT("joinMs"), TEXT("mapLoadMs"), TEXT("timeToPawnMs"), TEXT("timeToPlayMs") };
+	TArray<FCustomSessionLatencyHistogram> Metrics;
+	Metrics.SetNum(UE_ARRAY_COUNT(MetricNames));
+	TMap<FString, int32> Results;
+	int32 NumPlayed = 0;
+
+	for (int32 BotId = 0; BotId < NumBots; ++BotId)
+	{
+		const TSharedPtr<FJsonObject> BotReport = MenuSystemBots::ReadReport(ReportDir / FString::Printf(TEXT("Bot-%d.json"), BotId));
+		if (!BotReport.IsValid())
+		{
+			++Results.FindOrAdd(TEXT("NoReport"));
+
+			continue;
+		}
+
+		++Results.FindOrAdd(BotReport->GetStringField(TEXT("result")));
+		if (!BotReport->GetBoolField(TEXT("played")))
+		{
+			continue;
+		}
+
+		++NumPlayed;
+		for (int32 Index = 0; Index < Metrics.Num(); ++Index)
+		{
+			Metrics[Index].Add(BotReport->GetNumberField(MetricNames[Index]));
+		}
+	}
+
+	FString Csv = TEXT("Metric,Samples,Min,Mean,P50,P95,P99,Max\n");
+	const TSharedRef<FJsonObject> JsonSummary = MakeShared<FJsonObject>();
+	for (int32 Index = 0; Index < Metrics.Num(); ++Index)
+	{
+		const FCustomSessionLatencyHistogram& Metric = Metrics[Index];
+		Csv += FString::Printf(TEXT("%s,%lld,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n"), MetricNames[Index], Metric.GetCount(), Metric.GetMin(),
+			Metric.GetMean(), Metric.GetPercentile(0.5), Metric.GetPercentile(0.95), Metric.GetPercentile(0.99), Metric.GetMax());
+
+		const TSharedRef<FJsonObject> JsonMetric = MakeShared<FJsonObject>();
+		JsonMetric->SetNumberField(TEXT("samples"), Metric.GetCount());
+		JsonMetric->SetNumberField(TEXT("mean"), Metric.GetMean());
+		JsonMetric->SetNumberField(TEXT("p50"), Metric.GetPercentile(0.5));
+		JsonMetric->SetNumberField(TEXT("p95"), Metric.GetPercentile(0.95));
+		JsonMetric->SetNumberField(TEXT("p99"), Metric.GetPercentile(0.99));
+		JsonMetric->SetNumberField(TEXT("max"), Metric.GetMax());
+		JsonSummary->SetObjectField(MetricNames[Index], JsonMetric);
+	}
+
+	const TSharedRef<FJsonObject> JsonResults = MakeShared<FJsonObject>();
+	for (const TPair<FString, int32>& BotResult : Results)
+	{
+		JsonResults->SetNumberField(BotResult.Key, BotResult.Value);
+		Csv += FString::Printf(TEXT("Result %s,%d\n"), *BotResult.Key, BotResult.Value);
+	}
+
+	JsonSummary->SetNumberField(TEXT("bots"), NumBots);
+	JsonSummary->SetNumberField(TEXT("played"), NumPlayed);
+	JsonSummary->SetObjectField(TEXT("results"), JsonResults);
+
+	const TSharedPtr<FJsonObject> ServerReport = MenuSystemBots::ReadReport(ReportDir / TEXT("Server.json"));
+	if (ServerReport.IsValid())
+	{
+		JsonSummary->SetObjectField(TEXT("server"), ServerReport);
+		Csv += FString::Printf(TEXT("Server frame ms at up to %d players,%.3f mean,%.3f p95,%.3f p99,%.3f max\n"),
+			static_cast<int32>(ServerReport->GetNumberField(TEXT("peakPlayers"))), ServerReport->GetNumberField(TEXT("frameMeanMs")),
+			ServerReport->GetNumberField(TEXT("frameP95Ms")), ServerReport->GetNumberField(TEXT("frameP99Ms")), ServerReport->GetNumberField(TEXT("frameMaxMs")));
+	}
+
+	FString Json;
+	const TSharedRef<TJsonWriter<>> JsonWriter = TJsonWriterFactory<>::Create(&Json);
+	FJsonSerializer::Serialize(JsonSummary, JsonWriter);
+
+	FFileHelper::SaveStringToFile(Csv, *(ReportDir / TEXT("Summary.csv")));
+	FFileHelper::SaveStringToFile(Json, *(ReportDir / TEXT("Summary.json")));
+
+	UE_LOG(LogCustomSessions, Display, TEXT("%d of %d bots played, summary written to %s\n%s"), NumPlayed, NumBots, *ReportDir, *Csv);
+
+	return NumPlayed;
+}
@@ -0,0 +1,31 @@
+// Custom Sessions plugin by juaxix - 2022-2023 - MIT License
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "MenuSystemBotsCommandlet.generated.h"
+
+/**
+ * Load test on a single machine: starts a -nullrhi dedicated server on Map and Bots -nullrhi clients run by
+ * UMenuSystemBotSubsystem, waits for them all and summarizes join latency and server frame time to
+ * Saved/Profiling/CustomSessions/Bots-<time>. Map's game mode must host on dedicated servers, see
+ * AMenuSystemGameModeBase; the run fails if no session exists after ServerWarmup. Against the Null subsystem
+ * or the mock backend, no Steam needed:
+ * UnrealEditor-Cmd MenuSystem.uproject -run=MenuSystemBots -Bots=50 [-Map=/Game/ThirdPerson/Maps/ThirdPersonMap] [-Backend=Null|Mock]
+ * [-Duration=60] [-SpawnInterval=0.25] [-ServerWarmup=10] [-Port=7777] [-MatchType=FreeForAll] [-NoServer]
+ */
+UCLASS()
+class UMenuSystemBotsCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UMenuSystemBotsCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	/** @return the number of bots that got to play */
+	static int32 WriteSummary(const FString& ReportDir, int32 NumBots);
+};
@@ -3,11 +3,12 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "GameFramework/GameModeBase.h"
+#include "MenuSystemGameModeBase.h"
 #include "MenuSystemGameMode.generated.h"
 
+/** Game mode of the third person map, a dedicated server started on it hosts a session right away */
 UCLASS(minimalapi)
-class AMenuSystemGameMode : public AGameModeBase
+class AMenuSystemGameMode : public AMenuSystemGameModeBase
 {
 	GENERATED_BODY()
 
@@ -2,51 +2,308 @@
 
 
 #include "MenuSystemGameModeBase.h"
+#include "CustomSessionDiagnostics.h"
+#include "CustomSessionSubsystem.h"
+#include "Engine/GameInstance.h"
+#include "GameFramework/GameSession.h"
 #include "GameFramework/GameStateBase.h"
+#include "GameFramework/PlayerController.h"
 #include "GameFramework/PlayerState.h"
+#include "Kismet/GameplayStatics.h"
+#include "OnlineSessionSettings.h"
+
+DECLARE_STATS_GROUP(TEXT("MenuSystem"), STATGROUP_MenuSystem, STATCAT_Advanced);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Login queue depth"), STAT_MenuSystem_LoginQueueDepth, STATGROUP_MenuSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Login queue peak depth"), STAT_MenuSystem_LoginQueuePeakDepth, STATGROUP_MenuSystem);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Logins rejected as busy"), STAT_MenuSystem_LoginsRejected, STATGROUP_MenuSystem);
+DECLARE_FLOAT_ACCUMULATOR_STAT(TEXT("Login queue max wait (ms)"), STAT_MenuSystem_LoginQueueMaxWait, STATGROUP_MenuSystem);
+
+AMenuSystemGameModeBase::AMenuSystemGameModeBase()
+{
+	// only ticks while players wait in the login queue
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+}
+
+void AMenuSystemGameModeBase::Tick(float DeltaSeconds)
+{
+	Super::Tick(DeltaSeconds);
+
+	StartQueuedPlayers();
+}
+
+void AMenuSystemGameModeBase::InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage)
+{
+	Super::InitGame(MapName, Options, ErrorMessage);
+
+	UCustomSessionSubsystem* CustomSessionSubsystem = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+	if (IsValid(CustomSessionSubsystem) && GetNetMode() != NM_Client)
+	{
+		CustomSessionSubsystem->SetSlotReservationHandler(FCustomSessionReserveSlots::CreateUObject(this, &ThisClass::ReserveSlots),
+			FCustomSessionReleaseSlots::CreateUObject(this, &ThisClass::ReleaseSlots));
+	}
+
+	// nobody is going to press Host on a dedicated server, it hosts as soon as it's up and keeps it across travels
+	if (IsValid(CustomSessionSubsystem) && CustomSessionSubsystem->IsDedicatedServer() && bHostSessionOnDedicatedServer
+		&& !CustomSessionSubsystem->GetSessionSettings(NAME_GameSession).IsValid())
+	{
+		const FString MatchType = UGameplayStatics::ParseOption(Options, TEXT("MatchType"));
+		const int32 NumPublicConnections = GameSession ? GameSession->MaxPlayers : 0;
+		CUSTOMSESSION_EVENT(Session, Display, "DedicatedHosting", {TEXT("Map"), MapName}, {TEXT("Connections"), NumPublicConnections});
+		CustomSessionSubsystem->CreateSession(NAME_GameSession, NumPublicConnections, MatchType.IsEmpty() ? DedicatedServerMatchType : MatchType);
+	}
+}
+
+void AMenuSystemGameModeBase::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UCustomSessionSubsystem* CustomSessionSubsystem = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+	if (IsValid(CustomSessionSubsystem))
+	{
+		CustomSessionSubsystem->ClearSlotReservationHandler(this);
+	}
+
+	SlotReservations.Reset();
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AMenuSystemGameModeBase::PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage)
+{
+	Super::PreLogin(Options, Address, UniqueId, ErrorMessage);
+	if (!ErrorMessage.IsEmpty())
+	{
+		return;
+	}
+
+	// slots of a reservation were counted when it was granted
+	if (SlotReservations.IsReserved(ParseReservationToken(Options)))
+	{
+		return;
+	}
+
+	if (GetNumPlayers() + SlotReservations.GetReservedSlots() >= GetPlayerCapacity())
+	{
+		ErrorMessage = TEXT("Server full");
+		CUSTOMSESSION_EVENT(Players, Log, "LoginRejected", {TEXT("Address"), Address}, {TEXT("Reason"), ErrorMessage});
+
+		return;
+	}
+
+	// cheaper to retry in a moment than to hold a connection that waits longer than the client's timeout
+	if (MaxLoginQueueLength > 0 && LoginQueue.Num() >= MaxLoginQueueLength)
+	{
+		ErrorMessage = TEXT("Server busy, try again");
+		++LoginQueueStats.RejectedLogins;
+		UpdateLoginQueueStats();
+		CUSTOMSESSION_EVENT(Players, Log, "LoginRejected", {TEXT("Address"), Address}, {TEXT("Reason"), ErrorMessage},
+			{TEXT("QueueDepth"), LoginQueue.Num()});
+	}
+}
+
+FString AMenuSystemGameModeBase::InitNewPlayer(APlayerController* NewPlayerController, const FUniqueNetIdRepl& UniqueId, const FString& Options, const FString& Portal)
+{
+	// the player counts in GetNumPlayers from now on, the slot held for it is handed over
+	SlotReservations.Consume(ParseReservationToken(Options));
+
+	return Super::InitNewPlayer(NewPlayerController, UniqueId, Options, Portal);
+}
+
+int32 AMenuSystemGameModeBase::GetPlayerCapacity() const
+{
+	const int32 MaxPlayers = GameSession ? GameSession->MaxPlayers : 0;
+	const UCustomSessionSubsystem* CustomSessionSubsystem = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+	const TSharedPtr<FOnlineSessionSettings> SessionSettings = IsValid(CustomSessionSubsystem) ? CustomSessionSubsystem->GetSessionSettings(NAME_GameSession) : nullptr;
+	if (SessionSettings.IsValid())
+	{
+		return FMath::Min(SessionSettings->NumPublicConnections, MaxPlayers);
+	}
+
+	return MaxPlayers;
+}
+
+bool AMenuSystemGameModeBase::IsTakingPlayers() const
+{
+	const UWorld* World = GetWorld();
+
+	return IsValid(World) && World->NextURL.IsEmpty() && !World->IsInSeamlessTravel();
+}
+
+ECustomSessionReservationResult AMenuSystemGameModeBase::ReserveSlots(const FGuid& Token, int32 NumSlots)
+{
+	if (!IsTakingPlayers())
+	{
+		return ECustomSessionReservationResult::Unavailable;
+	}
+
+	return SlotReservations.Reserve(Token, NumSlots, GetPlayerCapacity() - GetNumPlayers(), ReservationLifetime);
+}
+
+void AMenuSystemGameModeBase::ReleaseSlots(const FGuid& Token)
+{
+	SlotReservations.Release(Token);
+}
+
+FGuid AMenuSystemGameModeBase::ParseReservationToken(const FString& Options)
+{
+	FGuid Token;
+	FGuid::Parse(UGameplayStatics::ParseOption(Options, CustomSessionsApi::ReservationOption), Token);
+
+	return Token;
+}
 
 void AMenuSystemGameModeBase::PostLogin(APlayerController* NewPlayer)
 {
 	Super::PostLogin(NewPlayer);
-	if (GameState)
+
+	const APlayerState* NewPlayerState = NewPlayer->GetPlayerState<APlayerState>();
+	UCustomSessionSubsystem* CustomSessionSubsystem = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+	if (IsValid(CustomSessionSubsystem) && IsValid(NewPlayerState))
+	{
+		CustomSessionSubsystem->QueueRegisterPlayer(NewPlayerState->GetUniqueId());
+	}
+
+	if (GameState && IsValid(NewPlayerState))
+	{
+		CUSTOMSESSION_EVENT(Players, Verbose, "PlayerJoined", {TEXT("Player"), NewPlayerState->GetPlayerName()},
+			{TEXT("Players"), GameState->PlayerArray.Num()});
+	}
+}
+
+void AMenuSystemGameModeBase::Logout(AController* ExitingPlayer)
+{
+	const APlayerState* ExitingPlayerState = ExitingPlayer->GetPlayerState<APlayerState>();
+	UCustomSessionSubsystem* CustomSessionSubsystem = GetGameInstance() ? GetGameInstance()->GetSubsystem<UCustomSessionSubsystem>() : nullptr;
+	if (IsValid(CustomSessionSubsystem) && IsValid(ExitingPlayerState))
+	{
+		CustomSessionSubsystem->QueueUnregisterPlayer(ExitingPlayerState->GetUniqueId());
+	}
+
+	if (GameState && IsValid(ExitingPlayerState))
+	{
+		CUSTOMSESSION_EVENT(Players, Verbose, "PlayerLeft", {TEXT("Player"), ExitingPlayerState->GetPlayerName()},
+			{TEXT("Players"), GameState->PlayerArray.Num()});
+	}
+
+	LoginQueue.RemoveAll([ExitingPlayer](const FQueuedPlayer& Queued) { return Queued.Player == ExitingPlayer; });
+	UpdateLoginQueueStats();
+
+	Super::Logout(ExitingPlayer);
+
+}
+
+void AMenuSystemGameModeBase::HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer)
+{
+	// the host never waits, and nobody overtakes the ones already waiting
+	if (!IsValid(NewPlayer) || NewPlayer->IsLocalController() || (LoginQueue.IsEmpty() && TryStartPlayerThisFrame()))
+	{
+		Super::HandleStartingNewPlayer_Implementation(NewPlayer);
+
+		return;
+	}
+
+	LoginQueue.Add(FQueuedPlayer{NewPlayer, FPlatformTime::Seconds()});
+	++LoginQueueStats.QueuedPlayers;
+	UpdateLoginQueueStats();
+	SetActorTickEnabled(true);
+
+	const APlayerState* NewPlayerState = NewPlayer->GetPlayerState<APlayerState>();
+	CUSTOMSESSION_EVENT(Players, Verbose, "LoginQueued", {TEXT("Player"), IsValid(NewPlayerState) ? NewPlayerState->GetPlayerName() : FString()},
+		{TEXT("Position"), LoginQueue.Num()});
+
+	// told right away, later positions are batched by QueuePositionUpdateInterval
+	LoginQueue.Last().ReportedPosition = LoginQueue.Num();
+	NewPlayer->ClientMessage(FString::Printf(TEXT("Waiting to join, position %d of %d"), LoginQueue.Num(), LoginQueue.Num()));
+}
+
+bool AMenuSystemGameModeBase::TryStartPlayerThisFrame()
+{
+	if (StartFrame != GFrameCounter)
+	{
+		StartFrame = GFrameCounter;
+		PlayersStartedThisFrame = 0;
+	}
+
+	if (PlayersStartedThisFrame >= FMath::Max(MaxPlayersStartedPerFrame, 1))
+	{
+		return false;
+	}
+
+	++PlayersStartedThisFrame;
+
+	return true;
+}
+
+void AMenuSystemGameModeBase::StartQueuedPlayers()
+{
+	int32 NumStarted = 0;
+	while (!LoginQueue.IsEmpty() && TryStartPlayerThisFrame())
 	{
-		const int32 NumPlayers = GameState->PlayerArray.Num();
-		const APlayerState* PlayerState = NewPlayer->GetPlayerState<APlayerState>();
-		if (GEngine)
+		const FQueuedPlayer Queued = LoginQueue[0];
+		LoginQueue.RemoveAt(0, 1, false);
+
+		// left while waiting, Logout already let go of it unless it was destroyed without one
+		APlayerController* Player = Queued.Player.Get();
+		if (!IsValid(Player))
 		{
-			GEngine->AddOnScreenDebugMessage(1, 60.0f, FColor::Purple, 
-				FString::Printf(TEXT("Players in game: %d"), NumPlayers));
-
-			if (IsValid(PlayerState))
-			{
-				GEngine->AddOnScreenDebugMessage(-1, 30.0f, FColor::Cyan, 
-					FString::Printf(TEXT("Player %s joined game"), 
-						*PlayerState->GetPlayerName()));
-			}
+			--PlayersStartedThisFrame;
+
+			continue;
 		}
+
+		LoginQueueStats.LastWaitMs = static_cast<float>((FPlatformTime::Seconds() - Queued.QueuedTime) * 1000.0);
+		LoginQueueStats.MaxWaitMs = FMath::Max(LoginQueueStats.MaxWaitMs, LoginQueueStats.LastWaitMs);
+		++NumStarted;
+
+		const APlayerState* PlayerState = Player->GetPlayerState<APlayerState>();
+		CUSTOMSESSION_EVENT(Players, Verbose, "LoginStarted", {TEXT("Player"), IsValid(PlayerState) ? PlayerState->GetPlayerName() : FString()},
+			{TEXT("WaitMs"), LoginQueueStats.LastWaitMs}, {TEXT("QueueDepth"), LoginQueue.Num()});
+
+		Super::HandleStartingNewPlayer_Implementation(Player);
+	}
+
+	if (NumStarted > 0)
+	{
+		SendQueuePositions();
+	}
+
+	UpdateLoginQueueStats();
+	if (LoginQueue.IsEmpty())
+	{
+		CUSTOMSESSION_EVENT(Players, Log, "LoginQueueDrained", {TEXT("PeakDepth"), LoginQueueStats.PeakQueueDepth},
+			{TEXT("MaxWaitMs"), LoginQueueStats.MaxWaitMs}, {TEXT("Players"), GetNumPlayers()});
+		SetActorTickEnabled(false);
 	}
 }
 
-void AMenuSystemGameModeBase::Logout(AController* ExitingPlayer)
+void AMenuSystemGameModeBase::SendQueuePositions()
 {
-	if (GameState)
+	const double Now = FPlatformTime::Seconds();
+	if (Now < NextPositionUpdateTime)
+	{
+		return;
+	}
+
+	NextPositionUpdateTime = Now + QueuePositionUpdateInterval;
+	for (int32 Index = 0; Index < LoginQueue.Num(); ++Index)
 	{
-		const int32 NumPlayers = GameState->PlayerArray.Num();
-		const APlayerState* PlayerState = ExitingPlayer->GetPlayerState<APlayerState>();
-		if (GEngine)
+		FQueuedPlayer& Queued = LoginQueue[Index];
+		APlayerController* Player = Queued.Player.Get();
+		const int32 Position = Index + 1;
+		if (IsValid(Player) && Queued.ReportedPosition != Position)
 		{
-			GEngine->AddOnScreenDebugMessage(1, 60.0f, FColor::Purple, 
-				FString::Printf(TEXT("Players in game: %d"), NumPlayers));
-
-			if (IsValid(PlayerState))
-			{
-				GEngine->AddOnScreenDebugMessage(-1, 30.0f, FColor::Cyan, 
-					FString::Printf(TEXT("Player %s exited the game"), 
-						*PlayerState->GetPlayerName()));
-			}
+			Queued.ReportedPosition = Position;
+			Player->ClientMessage(FString::Printf(TEXT("Waiting to join, position %d of %d"), Position, LoginQueue.Num()));
 		}
 	}
+}
 
-	Super::Logout(ExitingPlayer);
+void AMenuSystemGameModeBase::UpdateLoginQueueStats()
+{
+	LoginQueueStats.QueueDepth = LoginQueue.Num();
+	LoginQueueStats.PeakQueueDepth = FMath::Max(LoginQueueStats.PeakQueueDepth, LoginQueueStats.QueueDepth);
 
+	SET_DWORD_STAT(STAT_MenuSystem_LoginQueueDepth, LoginQueueStats.QueueDepth);
+	SET_DWORD_STAT(STAT_MenuSystem_LoginQueuePeakDepth, LoginQueueStats.PeakQueueDepth);
+	SET_DWORD_STAT(STAT_MenuSystem_LoginsRejected, LoginQueueStats.RejectedLogins);
+	SET_FLOAT_STAT(STAT_MenuSystem_LoginQueueMaxWait, LoginQueueStats.MaxWaitMs);
 }
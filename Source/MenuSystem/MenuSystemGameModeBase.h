@@ -3,11 +3,42 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "CustomSessionReservation.h"
 #include "GameFramework/GameModeBase.h"
 #include "MenuSystemGameModeBase.generated.h"
 
+/** Login queue figures since the map started, for tuning MaxPlayersStartedPerFrame */
+USTRUCT(BlueprintType)
+struct FMenuSystemLoginQueueStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Login queue")
+	int32 QueueDepth = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Login queue")
+	int32 PeakQueueDepth = 0;
+
+	/** Players that had to wait for their turn */
+	UPROPERTY(BlueprintReadOnly, Category = "Login queue")
+	int32 QueuedPlayers = 0;
+
+	/** Logins turned away because the queue was full */
+	UPROPERTY(BlueprintReadOnly, Category = "Login queue")
+	int32 RejectedLogins = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Login queue")
+	float LastWaitMs = 0.0f;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Login queue")
+	float MaxWaitMs = 0.0f;
+};
+
 /**
- * 
+ * Registers players with the session and honours the slots clients reserve before travelling here,
+ * see UCustomSessionSubsystem::SetSlotReservationHandler.
+ * Players arriving in a burst are started a few per frame, so spawning their pawns and setting up their
+ * replication doesn't land in a single server frame; the rest wait as spectators and are told their position
  */
 UCLASS()
 class MENUSYSTEM_API AMenuSystemGameModeBase : public AGameModeBase
@@ -15,7 +46,82 @@ class MENUSYSTEM_API AMenuSystemGameModeBase : public AGameModeBase
 	GENERATED_BODY()
 	
 public:
+	AMenuSystemGameModeBase();
+
+	virtual void Tick(float DeltaSeconds) override;
+
+	virtual void InitGame(const FString& MapName, const FString& Options, FString& ErrorMessage) override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
+	/** Players without a reservation only get the slots nobody holds, nobody gets in while the login queue is full */
+	virtual void PreLogin(const FString& Options, const FString& Address, const FUniqueNetIdRepl& UniqueId, FString& ErrorMessage) override;
+
 	virtual void PostLogin(APlayerController* NewPlayer) override;
 
 	virtual void Logout(AController* Exiting) override;
+
+	virtual void HandleStartingNewPlayer_Implementation(APlayerController* NewPlayer) override;
+
+	UFUNCTION(BlueprintPure, Category = "Login queue")
+	const FMenuSystemLoginQueueStats& GetLoginQueueStats() const { return LoginQueueStats; }
+
+protected:
+	virtual FString InitNewPlayer(APlayerController* NewPlayerController, const FUniqueNetIdRepl& UniqueId, const FString& Options, const FString& Portal = TEXT("")) override;
+
+	/** Players the session takes, the host and reserved slots included */
+	int32 GetPlayerCapacity() const;
+
+	/** False while travelling away, a reservation would be honoured by nobody */
+	bool IsTakingPlayers() const;
+
+	/** Create the game session when a dedicated server starts, with GameSession MaxPlayers connections */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Dedicated server")
+	bool bHostSessionOnDedicatedServer = true;
+
+	/** Match type a dedicated server hosts unless started with ?MatchType= */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Dedicated server")
+	FString DedicatedServerMatchType = TEXT("FreeForAll");
+
+	/** Seconds reserved slots are held for clients to arrive */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Reservations")
+	float ReservationLifetime = 30.0f;
+
+	/** Players whose pawn is spawned in a single frame, the rest wait in the login queue */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Login queue")
+	int32 MaxPlayersStartedPerFrame = 2;
+
+	/** Players waiting to be started before new logins are turned away as busy, 0 never turns them away */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Login queue")
+	int32 MaxLoginQueueLength = 32;
+
+	/** Seconds between position updates sent to waiting players */
+	UPROPERTY(Config, EditDefaultsOnly, Category = "Login queue")
+	float QueuePositionUpdateInterval = 1.0f;
+
+private:
+	struct FQueuedPlayer
+	{
+		TWeakObjectPtr<APlayerController> Player;
+		double QueuedTime = 0.0;
+		int32 ReportedPosition = INDEX_NONE;
+	};
+
+	/** @return false if this frame already started MaxPlayersStartedPerFrame players */
+	bool TryStartPlayerThisFrame();
+	void StartQueuedPlayers();
+	void SendQueuePositions();
+	void UpdateLoginQueueStats();
+
+	ECustomSessionReservationResult ReserveSlots(const FGuid& Token, int32 NumSlots);
+	void ReleaseSlots(const FGuid& Token);
+
+	static FGuid ParseReservationToken(const FString& Options);
+
+	FCustomSessionSlotReservations SlotReservations;
+
+	TArray<FQueuedPlayer> LoginQueue;
+	uint64 StartFrame = 0;
+	int32 PlayersStartedThisFrame = 0;
+	double NextPositionUpdateTime = 0.0;
+	FMenuSystemLoginQueueStats LoginQueueStats;
 };